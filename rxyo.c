@@ -20,19 +20,133 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTI
 OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+// recvmmsg, see net_t
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+// Built with -DRXYO_LIBRARY only the functions of rxyo.h are exported. Everything else, this file's
+// own functions and miniaudio, has internal linkage so it can't clash with the program linked to.
+#if defined(RXYO_LIBRARY)
+#define RXYO_INTERNAL static __attribute__((unused)) // main would have used them
+#define MA_API static __attribute__((unused))
+#define DRWAV_API MA_API // The decoders it comes with
+#define DRWAV_PRIVATE static
+#define DRFLAC_API MA_API
+#define DRFLAC_PRIVATE static
+#define DRMP3_API MA_API
+#define DRMP3_PRIVATE static
+#else
+#define RXYO_INTERNAL
+#endif
+
+#if defined(RXYO_LIBRARY)
+// The only functions of miniaudio defined without MA_API, the implementation below sees them
+// declared static first.
+#include "miniaudio.h"
+static __attribute__((unused)) void ma_device__on_notification_started(ma_device *pDevice);
+static __attribute__((unused)) void ma_device__on_notification_stopped(ma_device *pDevice);
+static __attribute__((unused)) void ma_device__on_notification_rerouted(ma_device *pDevice);
+static __attribute__((unused)) void ma_device__on_notification_interruption_began(ma_device *pDevice);
+static __attribute__((unused)) void ma_device__on_notification_interruption_ended(ma_device *pDevice);
+#endif
+
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
 #include "raylib.h"
+#include "rlgl.h"
+#include "rxyo.h"
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#if defined(CHECK_ALLOCATIONS)
+#include <dlfcn.h>
+#endif
+
+// rlgl has no persistently mapped buffers, buffer textures or timer queries, the shader
+// backend and the benchmark use them straight from the system's GL library where it exports them.
+#if defined(__linux__)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#define STREAM_SAMPLES
+#define GPU_TIMERS
+#define NET_MMSG // Datagrams are received in batches with recvmmsg, one at a time elsewhere
+#define ASYNC_READBACK // --share reads frames back through pixel buffers with fences instead of waiting for them
+#define DIRECT_READBACK // rxyo_renderer_render_pixels reads into the caller's pixels, raylib would allocate its own
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Profiling zones around the hot paths. They compile to nothing unless built with -DPROFILE_ZONES,
+// which records them for --profile to write out as a chrome://tracing JSON file, or -DTRACY_ENABLE,
+// which hands them to the Tracy client linked in with TracyClient.cpp.
+#if defined(TRACY_ENABLE)
+#include "tracy/TracyC.h"
+#define ZONE_BEGIN(zone, name) TracyCZoneN(zone, name, 1)
+#define ZONE_END(zone) TracyCZoneEnd(zone)
+#define FRAME_MARK() TracyCFrameMark
+#elif defined(PROFILE_ZONES)
+#define ZONE_BEGIN(zone, name) zone_t zone = {name, zone_now()}
+#define ZONE_END(zone) zone_record((zone).name, (zone).start, zone_now())
+#define FRAME_MARK() zone_record("frame", zone_now(), 0)
+#else
+#define ZONE_BEGIN(zone, name)
+#define ZONE_END(zone)
+#define FRAME_MARK()
+#endif
+
+// Heap use where there must be none: in the audio callbacks, on the threads that feed and read
+// the ring and in the CPU work of handle_draw. It is only checked when built with
+// -DCHECK_ALLOCATIONS, which replaces the allocator of the whole process: every malloc, calloc,
+// realloc, free, posix_memalign and aligned_alloc between FORBID_ALLOCATIONS and
+// ALLOW_ALLOCATIONS on the same thread aborts, whether rxyo.c, raylib or libc made it. The GL
+// calls of the render thread stay outside, drivers allocate as they take commands (llvmpipe
+// frees in glClear). The buffers that grow to fit the biggest frame so far allow it while they grow.
+#if defined(CHECK_ALLOCATIONS)
+#define FORBID_ALLOCATIONS() (allocation_guard++)
+#define ALLOW_ALLOCATIONS() (allocation_guard--)
+#else
+#define FORBID_ALLOCATIONS()
+#define ALLOW_ALLOCATIONS()
+#endif
 
 #define FALSE 0
 #define TRUE 1
 
-#define BUF_SIZE 8192
+#define STRINGIFY(x) #x
+#define XSTRINGIFY(x) STRINGIFY(x) // Used to paste the value of a macro into shader sources
+
+#define RING_MAX_CHANNELS 32  // Devices with more channels than this are captured with only the ones drawn
+#define MAX_TRACES 8          // XY pairs drawn at once, see trace_map_t
+#define MAX_PLANES (3 * MAX_TRACES) // x, y and Z of every trace
+#define RING_STAMPS 256   // Capacity of the queue of period timestamps, has to be a power of two
 
 #define DEFAULT_SCREEN_WIDTH 800
 #define DEFAULT_SCREEN_HEIGHT 800
@@ -41,17 +155,867 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #define FOREGROUND_COLOR BLACK
 
 #define KEY_MENU KEY_M
+#define KEY_BACKEND KEY_B
+#define KEY_LESS_INTERPOLATION KEY_LEFT_BRACKET
+#define KEY_MORE_INTERPOLATION KEY_RIGHT_BRACKET
+#define KEY_PHOSPHOR KEY_P
+#define KEY_LAYOUT KEY_T
+#define KEY_STATS KEY_S
+#define KEY_PROFILE KEY_D
+#define KEY_LOD KEY_L
+#define KEY_TRIGGER KEY_R
+#define KEY_ANALYSIS KEY_A
+#define KEY_RESOLUTION KEY_V
+#define KEY_SEEK_BACK KEY_LEFT
+#define KEY_SEEK_FORWARD KEY_RIGHT
+#define KEY_ZOOM_OUT KEY_MINUS
+#define KEY_ZOOM_IN KEY_EQUAL
+
+#define DEFAULT_HALF_LIFE 0.04f // Seconds for the phosphor glow to fade to half its brightness
+#define DEFAULT_EXPOSURE 1.0f   // Scales the beam energy before tone mapping
+#define DEFAULT_LATENCY 0.03f   // Seconds the trace lags behind the capture, has to cover a period plus its jitter
+#define DEFAULT_CAPACITY 0.25f  // Seconds the ring holds on top of the latency and a refresh, see ring_seconds
+#define MIN_REFRESH_RATE 24     // Hz, the longest refresh interval the ring makes room for without a frame cap
+#define CLOCK_BANDWIDTH 0.5     // Hz, how quickly the frame clock follows the timestamps of the periods
+#define CLOCK_MAX_ERROR 0.1     // Seconds the timestamps may stray from the frame clock before it starts over
+#define BEAM_SIGMA 0.001f       // Width (standard deviation) of the beam, relative to the smaller screen side
+#define MIN_BEAM_SIGMA 0.5f     // Narrowest beam in pixels, anything thinner aliases
+#define BEAM_RADIUS 4.0         // Beam quads extend this many sigmas around their piece of the trace
+
+#define DEFAULT_INTERPOLATION 8   // Straight pieces each segment between two samples is split into
+#define MAX_INTERPOLATION 64
+#define TRACE_VERTICES_PER_QUAD 6 // Every straight piece is a thick-line quad made of two triangles
+
+#define SOFTWARE_TILE 64          // Side of the squares the software backend splits the screen into
+#define SOFTWARE_MAX_THREADS 63   // Helper threads of the software backend, besides the drawing thread
+
+#define SAMPLE_TEXTURE_WIDTH 4096 // Width of the texture the raw samples are uploaded to
+#define WINDOW_HISTORY 3          // Samples carried over from the previous frame so the curve joins up
+#define STREAM_REGIONS 3 // Sample windows the GPU may still be drawing from while the next one is written
+
+#define DEFAULT_LOD_BUDGET 0.008f // Seconds the trace may take to draw per frame when l turns the level of detail on
+#define LOD_TOLERANCE 0.25f       // Pixels the samples of a merged run may stray from the segment drawn instead
+#define LOD_GAIN 0.25             // How quickly the samples drawn per frame follow the measured cost
+#define TRIGGER_SIZE 4096            // Samples the period is estimated from, periods up to half of it lock
+#define TRIGGER_MIN_PERIOD 8         // Samples, shorter periods are drawn as they come
+#define TRIGGER_MIN_CORRELATION 0.9  // How alike consecutive periods have to be to lock onto them
+#define TRIGGER_PEAK_RATIO 0.95      // The shortest lag this close to the best one is the period, not a multiple of it
+#define FFT_MAX_SIZE (2 * TRIGGER_SIZE) // Longest transform planned, see fft_t
+
+#define ANALYSIS_SIZE 4096              // Frames every spectrum is taken over, 85 ms at 48 kHz
+#define ANALYSIS_BANDS 96               // Log-spaced bands of the spectrum
+#define ANALYSIS_MIN_FREQUENCY 20.0     // Hz where the first band starts
+#define ANALYSIS_MAX_FREQUENCY 20000.0  // Hz where the last band ends, unless the Nyquist frequency is lower
+#define ANALYSIS_FLOOR_DB -90.0f        // Bottom of the spectrum, relative to a full scale sine
+#define ANALYSIS_FALL_DB 60.0f          // dB per second the bands fall back at, they rise at once
+#define ANALYSIS_POINTS 1024            // Newest frames on the goniometer
+#define ANALYSIS_IDLE_SECONDS 0.008     // How often the analysis thread looks for new frames
+#define ANALYSIS_PANEL 128              // Pixels, height of the panels along the bottom of the screen
+#define ANALYSIS_METER 12               // Pixels, width of the correlation meter
+#define ANALYSIS_FRESH 4                // Set in analysis_t.middle until the render thread takes that slot
+
+#define DEFAULT_RESOLUTION_BUDGET 0.008f // Seconds the trace may take to draw per frame when v turns dynamic resolution on
+#define MIN_RESOLUTION_SCALE 0.25f       // Dynamic resolution never draws coarser than this, relative to the window
+#define MAX_RESOLUTION_SCALE 2.0f
+#define RESOLUTION_STEP 0.0625f          // Scales dynamic resolution picks from, so the targets are only reallocated now and then
+#define RESOLUTION_HEADROOM 0.7          // Dynamic resolution only goes up if that is predicted to take less than this much of the budget
+#define RESOLUTION_HOLD 30               // Frames between two changes of the dynamic resolution
+#define RESOLUTION_GAIN 0.1              // How quickly the cost it goes by follows the measured one
+#define RESOLUTION_MIN_SAVING 0.1        // Dynamic resolution stops going down once a step saves less than this much
+
+#define LOD_QUERIES 4             // Frames of GPU timestamps in flight, they are read this many frames late
+
+#define MAX_DEVICES 32             // Capture devices listed in the menu, only 0-9 can be selected
+#define MENU_LINE_SIZE 256
+#define DEVICE_LINE_SIZE (MA_MAX_DEVICE_NAME_LENGTH + 16) // Room for "N - " in front of a whole device name
+#define MENU_STATUS_SECONDS 0.1   // How often the menu lines that change on their own are formatted
+#define DEVICE_REFRESH_SECONDS 2  // How often the device list is enumerated in the background
+
+#define STATS_SECONDS 1.0 // Statistics are averaged over windows of this length
+#define STATS_LINES 6
+
+#define PLAY_CHUNK 1024      // Frames of the file decoded at a time with --play
+#define PLAY_IDLE_SECONDS 0.002 // How long the decoder sleeps once the ring is full
+#define PLAY_NO_SEEK UINT64_MAX // playback_t.seek when there is nowhere to jump to
+#define SEEK_SECONDS 5.0        // How far the arrow keys seek in a mapped file
+#define SEEK_READAHEAD_SECONDS 2.0 // How much of a mapped file is read in ahead of a seek
+
+#define OVERVIEW_BINS 64            // Histogram bins across each axis of a trace
+#define OVERVIEW_BLOCK_SECONDS 2.0  // Length of the file binned into one histogram
+#define OVERVIEW_MIN_SECONDS 16.0   // Shortest overview, zooming in further draws every sample
+#define OVERVIEW_LEVELS 32
+#define OVERVIEW_CHUNK 4096         // Frames converted at a time while binning
+#define OVERVIEW_MAGIC "RXYOVW01"
+#define MAX_OVERVIEW_THREADS 64
+
+#define NET_BATCH 32                // Datagrams taken off the socket at once
+#define NET_PACKET_SIZE 9216        // Bytes of a datagram received in full, a jumbo frame
+#define NET_SOCKET_BUFFER (1 << 20) // Bytes the kernel queues for the socket before it drops packets
+#define NET_IDLE_SECONDS 0.1        // How long the receiver waits for a packet before it checks whether to stop
+#define NET_RESYNC_SECONDS 1.0      // RTP timestamps jumping further than this start the jitter buffer over
+#define DEFAULT_JITTER 0.005f       // Seconds RTP packets wait for the ones before them, see net_t
+
+#define SHARE_SLOTS 3          // Frames in the --share segment, readers have two frame times to copy the newest one
+#define SHARE_READBACKS 3      // Frames read back from the GPU at once, more are skipped
+#define SHARE_HEADER_SIZE 4096 // Bytes before the pixels of the first slot, see share_header_t
+#define SHARE_MAGIC "RXYOSHM1"
+
+#define RENDER_SEGMENT_SECONDS 2 // Length of the pieces a file is split into between the render workers
+#define WARMUP_HALF_LIVES 10     // Each piece starts this early so the phosphor has the right glow, 2^-10 is invisible
+#define MAX_JOBS 256
+
+#define BENCH_FRAMES 600    // Frames measured by --bench unless --frames says otherwise
+#define BENCH_WARMUP 30     // Frames drawn before measuring, so the caches and the driver settle
+#define BENCH_QUERIES 8     // GPU timer queries in flight, their results are read this many frames late
+#define BENCH_FREQUENCY 110.0 // Hz of the first channel of the Lissajous figure
+
+#define PROFILE_EVENTS 16384 // Zones kept per thread, the oldest are overwritten, has to be a power of two
+#define PROFILE_MARGIN 256   // Newest zones left out when writing while the thread keeps recording
 
 #define LOG_LEVEL LOG_DEBUG
 
+// When a period was captured: every frame before `frame` (a value of head)
+// was in the ring at `time` seconds of monotonic_seconds.
+typedef struct
+{
+    ma_uint64 frame;
+    double time;
+    int seek; // The stream jumped to frame, however close it was to where it would have been
+} period_stamp_t;
+
+// How the frames in the ring are laid out. Set before the capture starts and never
+// changed after that, every device is opened with the same format.
+typedef struct
+{
+    ma_format format; // Any miniaudio format, converted to float when the frames are read
+    ma_uint32 channels;
+    ma_uint32 sample_rate;
+    ma_uint32 frame_bytes;
+} ring_format_t;
+
+typedef enum
+{
+    LAYOUT_OVERLAY, // Every trace over the whole screen
+    LAYOUT_SPLIT,   // Every trace in its own cell of a grid, left to right and top to bottom
+} layout_t;
+
+// Which channels of the capture are drawn against each other. The planes of sample_window_t
+// hold channels[plane]: trace t draws plane 2 t on x and plane 2 t + 1 on y, the Z channels
+// of the traces that have one follow in the planes after those. Z is the beam brightness like
+// the Z input of a real scope, 0 or less blanks the beam and 1 or more is full brightness.
+// Channels past the last one of the device repeat its last one, so mono still draws the one
+// channel against itself.
+typedef struct
+{
+    int count;
+    int planes;
+    int channels[MAX_PLANES];
+    int z_planes[MAX_TRACES]; // Plane of the Z channel of every trace, -1 for none
+    layout_t layout;
+    Rectangle viewports[MAX_TRACES]; // Pixels of xytexture each trace is scaled to, see layout_traces
+} trace_map_t;
+
+// Single-producer/single-consumer ring of interleaved frames in `format`.
+// The audio callback is the only writer of `head` and the render thread
+// the only writer of `tail`. Both are monotonic frame counters, the slot
+// of a frame is its counter modulo `capacity`, so they never wrap in
+// practice and `head - tail` is always the number of readable frames.
+// `capacity` is `seconds` of audio at the rate of `format`, `buf` is
+// allocated for exactly that many frames whenever the format is set.
+// Every period written is also stamped in `stamps`, a second ring that
+// works the same way. With --play the decoder thread is the writer and the
+// playback callback a second reader with its own counter `played`, a slot
+// is only free again once both readers are past it, see playback_t. Readers
+// that only look, like analysis_t, peek at frames before `tail` and check
+// afterwards that the writer didn't get to them: before it copies anything
+// the writer moves `writing` to where head will be, see buffer_store_peek.
+// A WAV file played with --play may instead be attached as a whole: `buf`
+// is then the mapping of the file, `capacity` its length and `head` is
+// already at the end, nothing is ever written.
 typedef struct
 {
-    float buf[2][BUF_SIZE];
+    unsigned char *buf;
+    int attached;       // TRUE if buf is a file mapped by someone else, see buffer_store_attach
+    ma_uint32 capacity; // In frames
+    float seconds;
+    ring_format_t format;
+
+    _Atomic ma_uint64 head; // Total frames written by the audio callback
+    _Atomic ma_uint64 writing; // What head will be once the frames being copied are in
+    _Atomic ma_uint64 tail; // Total frames consumed by the render thread
+    _Atomic ma_uint64 played; // Total frames consumed by the playback callback
+    int playing;              // TRUE if the writer has to wait for `played` as well
+    _Atomic ma_uint64 overruns; // Frames the audio callback had no room for
 
-    int ptr; // Pointer to buffer 1 or 2
-    int idx; // Pointer to position in buffer
+    period_stamp_t stamps[RING_STAMPS];
+    _Atomic ma_uint64 stamp_head;
+    _Atomic ma_uint64 stamp_tail;
 } buffer_store_t;
 
+// Maps time to frames of the ring, so the render thread can draw exactly the frames
+// captured between two screen refreshes no matter how they were split into periods.
+// The timestamps of the periods jitter with the scheduling of the audio callback, so
+// they steer a second-order delay-locked loop instead of being used directly.
+// Only touched by the render thread.
+typedef struct
+{
+    int locked;          // FALSE until the first timestamp arrives
+    double origin_time;  // Seconds
+    double origin_frame; // Estimated frame of the ring captured at origin_time
+    double rate;         // Estimated frames per second
+    double nominal_rate; // Frames per second the device was opened with
+} frame_clock_t;
+
+// How the beam deposits energy, shared by every backend. A piece of the trace
+// from a to b that the beam spends dt seconds on receives dt of energy spread
+// evenly along its length, with a Gaussian profile of `sigma` across it.
+// Energy is measured per unit of normalized area (the smaller screen side
+// squared) so the picture looks the same at any resolution and sample rate.
+typedef struct
+{
+    int width;
+    int height;
+    float sigma;  // In pixels
+    float scale;  // Pixels per unit of normalized length
+    float energy; // Energy of one sample, i.e. its duration in seconds
+} beam_t;
+
+// One vertex of the trace. All 6 vertices of a piece carry both of its end
+// points in pixels of xytexture, the vertex shader places them around it.
+typedef struct
+{
+    float ax, ay, bx, by;
+    float corner; // 0-5, see emit_beam in the shaders
+    float energy;
+} trace_vertex_t;
+
+// The whole trace of a frame is built into `vertices` on the CPU and then
+// uploaded to `vbo` and drawn with a single draw call.
+typedef struct
+{
+    unsigned int vao;
+    unsigned int vbo;
+    Shader shader;
+    int resolution_loc;
+    int sigma_loc;
+    int scale_loc;
+
+    trace_vertex_t *vertices;
+    int capacity; // Size of `vertices` and `vbo` in vertices
+    int count;    // Vertices pushed since the last draw
+} trace_batch_t;
+
+// Lets the vertex shader expand every segment between two samples into `interpolation`
+// interpolated pieces, only the raw samples reach the GPU.
+// Where the GL has persistent mappings (4.4 or ARB_buffer_storage) the samples are streamed:
+// `stream` is a mapping of STREAM_REGIONS sample windows in a buffer the shader reads as a buffer
+// texture. The ring is converted straight into one region, which the GPU draws from without any
+// further copy, while the next frame goes into the next region. `fences` tell when the GPU is
+// done with a region. Otherwise the window is uploaded to `sample_texture` on every frame.
+typedef struct
+{
+    unsigned int vao; // Empty, all vertices are generated from gl_VertexID
+    unsigned int sample_texture;
+    unsigned int stream_buffer;
+    unsigned int stream_texture;
+    float *stream; // NULL if the samples are uploaded instead
+#if defined(STREAM_SAMPLES)
+    GLsync fences[STREAM_REGIONS];
+#endif
+    int region; // Region the next window goes into
+    int planes;     // Of the sample windows drawn, see sample_window_t
+    int plane_size;
+    Shader shader;
+    int samples_loc;
+    int base_loc;
+    int plane_size_loc;
+    int segments_loc;
+    int viewports_loc;
+    int z_planes_loc;
+    int interpolation_loc;
+    int energy_loc;
+    int resolution_loc;
+    int sigma_loc;
+    int scale_loc;
+} trace_shader_t;
+
+// Planar copy of the frames to draw, in the planes of trace_map_t, plane_size samples apart.
+// They point at `storage`, or at a region of trace_shader_t.stream when the shader backend
+// streams the samples. The first WINDOW_HISTORY samples are the last ones of the previous frame.
+typedef struct
+{
+    float *storage;
+    float *plane[MAX_PLANES];
+    int traces; // The x and y planes of the traces come first
+    int planes;
+    int plane_size; // Whole rows of the sample texture
+    int capacity;   // Samples that fit after the history
+    int count;      // Samples in each plane, including the history
+    int merged;     // Captured samples each of them stands for, see lod_decimate
+    float repeats;  // Periods folded onto each of them, see trigger_fold
+} sample_window_t;
+
+// How long one frame took to draw, see lod_t.
+typedef struct
+{
+    int drawn;   // Samples of the window drawn
+    int merged;  // Captured samples each of them stood for
+    double cpu;  // Seconds render_trace took on the CPU
+    int pending; // TRUE until its GPU timestamps have been read
+} lod_frame_t;
+
+// Adaptive level of detail. When a frame brings far more samples than the screen can tell
+// apart, e.g. 768 kHz in an 800x800 window, most segments are shorter than a pixel and drawing
+// them is wasted. Runs of `factor` consecutive samples are then merged into one that receives
+// the energy of the whole run, with the factor picked from how long the last frames took so
+// that drawing stays within `budget` whatever the sample rate. Runs are only as long as their
+// samples stay within LOD_TOLERANCE of the straight segment drawn through them, so smooth
+// figures merge well and noise, where every sample lands somewhere else, is drawn in full.
+typedef struct
+{
+    int enabled;
+    float budget;  // Seconds per frame render_trace may take on the CPU and on the GPU
+    double target; // Samples that can be drawn within the budget, 0 while it is not exceeded
+    double widest; // Most samples the last frame could have merged within LOD_TOLERANCE, 0 for any
+    int factor;    // Samples merged into one on the next frame
+    int run;       // Samples of the unfinished run that went into earlier windows
+    float carry[MAX_PLANES]; // Their sum in every Z plane, see lod_decimate
+    int timed;      // TRUE to time the frames even while not merging, for resolution_t
+    double seconds; // How long the newest frame timed took on the CPU or the GPU, whichever took longer
+    lod_frame_t frames[LOD_QUERIES];
+    ma_uint64 frame; // Frames timed so far, frame % LOD_QUERIES is the one being drawn
+    double start;    // monotonic_seconds when it started
+#if defined(GPU_TIMERS)
+    GLuint queries[2 * LOD_QUERIES]; // Timestamps before and after every frame
+    int gpu_timed;                   // -1 until the queries are made on the first frame
+#endif
+} lod_t;
+
+// Preplanned radix-2 FFT of `size` complex values, kept as separate real and imaginary arrays
+// so the butterflies of a stage run along contiguous values, 8 at a time with AVX2 and FMA,
+// 4 with SSE2 or NEON. The twiddles of the stage that joins halves of length h are the h
+// values from h - 1 on, in the order the butterflies use them.
+typedef struct
+{
+    int size;
+    int reverse[FFT_MAX_SIZE];      // Where every value goes before the first stage
+    float twiddle_re[FFT_MAX_SIZE];
+    float twiddle_im[FFT_MAX_SIZE]; // Of the forward transform, the inverse one conjugates them
+} fft_t;
+
+// Resolution the trace is drawn at, independent of the window. xytexture, the phosphor targets
+// and the software pixels are `current` times the size of the window and stretched over it with
+// bilinear filtering, the menu, the statistics and the panels are drawn on top at the window's own
+// resolution. With `dynamic` the scale follows how long drawing the trace takes, as timed by lod_t:
+// the decay, the beam and the tone mapping all grow with the pixels, so the scale moves by the
+// square root of budget over cost. Whatever doesn't, like the samples, is left to lod_t: once a step
+// down hardly saved anything it goes no further. Every change reallocates the targets and starts the
+// glow over, so the scale only moves in steps of RESOLUTION_STEP and at most every RESOLUTION_HOLD frames.
+typedef struct
+{
+    float scale;   // From --scale, dynamic resolution never goes above it
+    int dynamic;
+    float budget;  // Seconds per frame render_trace may take on the CPU and on the GPU with dynamic
+    float current; // Scale the targets are at
+    double cost;   // Seconds render_trace takes at current, smoothed
+    double before; // What it took before the last step down, 0 after a step up
+    int held;      // Frames since current changed
+} resolution_t;
+
+// Trigger for repeating figures. Drawing whatever arrived since the last swap paints a steady
+// Lissajous figure as a different set of overlapping partial cycles on every frame, so it drifts
+// and shimmers. The period of the first trace is estimated from the autocorrelation of its last
+// TRIGGER_SIZE samples, computed with an FFT: x + iy is transformed once, and the real part of
+// the inverse transform of its power spectrum is the sum of the autocorrelations of x and y.
+// The whole periods of the frame are then averaged into a single closed cycle, which is drawn
+// with the energy of all of them. Figures that don't repeat closely enough are drawn as they come.
+typedef struct
+{
+    int enabled;
+    double period;                 // Samples, 0 while nothing repeats
+    float recent[2][TRIGGER_SIZE]; // The last x and y samples of the first trace, oldest first
+    int filled;
+    float re[2 * TRIGGER_SIZE];    // Zero padded so the correlation doesn't wrap around
+    float im[2 * TRIGGER_SIZE];
+    fft_t fft;                     // Of 2 TRIGGER_SIZE
+    float cycle[MAX_PLANES][TRIGGER_SIZE / 2];
+} trigger_t;
+
+// What the analysis panels show, published by the analysis thread all at once, see analysis_t.
+typedef struct
+{
+    float bands[ANALYSIS_BANDS]; // dB of the loudest bin in every band, x and y averaged
+    float correlation;           // Of x and y, from -1 (out of phase) through 0 to 1 (mono)
+    float mid[ANALYSIS_POINTS];  // (x + y) / 2 of the newest frames, the goniometer's vertical axis
+    float side[ANALYSIS_POINTS]; // (x - y) / 2, its horizontal axis
+} analysis_result_t;
+
+// Stereo analysis of the first trace next to the XY view: a log-frequency spectrum, a
+// goniometer (the XY view turned by 45 degrees, so mono is vertical) and a correlation meter.
+// `thread` takes the ANALYSIS_SIZE frames before the ring's tail, the ones that were just drawn,
+// with buffer_store_peek, so it never holds back the writer or the render thread. The results go
+// through a triple buffer: the thread fills `back` and swaps it with `middle`, the render thread
+// swaps `front` with `middle` whenever ANALYSIS_FRESH is set in it, neither ever waits.
+typedef struct
+{
+    buffer_store_t *buffer_store;
+    trace_map_t map;     // The first trace of the traces drawn
+    _Atomic int enabled; // The thread only analyses while the panels are shown
+    fft_t fft;
+    float window[ANALYSIS_SIZE]; // Hann
+    float scale;                 // 1 / (sum of window)^2, a full scale sine is then 0 dB
+    float x[ANALYSIS_SIZE];
+    float y[ANALYSIS_SIZE];
+    float re[ANALYSIS_SIZE];
+    float im[ANALYSIS_SIZE];
+    int first_bin[ANALYSIS_BANDS]; // Bins of every band, the last one included
+    int last_bin[ANALYSIS_BANDS];
+    double max_frequency;          // Hz where the last band ends
+    float levels[ANALYSIS_BANDS];  // dB, falling back at ANALYSIS_FALL_DB
+    ma_uint64 end;                 // Tail of the ring when the frames were analysed last
+    double time;                   // monotonic_seconds then
+
+    analysis_result_t slots[3];
+    int back;  // Only touched by the thread
+    int front; // Only touched by the render thread
+    _Atomic int middle;
+
+    pthread_t thread;
+    int started;
+    _Atomic int running; // Cleared to stop the thread
+} analysis_t;
+
+// Beam persistence. The trace is accumulated as beam energy into one of two float
+// targets, on every frame the previous target is decayed into the current one and
+// the new trace is added on top. The energy is then tone mapped to colors into xytexture.
+typedef struct
+{
+    RenderTexture2D accumulation[2];
+    int current; // Target the current frame accumulates into
+
+    Shader decay_shader;
+    int decay_loc;
+    Shader display_shader;
+    int exposure_loc;
+    int background_loc;
+    int foreground_loc;
+} phosphor_t;
+
+// One straight piece of the trace queued for the software backend, in pixels of xytexture.
+typedef struct
+{
+    float ax, ay, bx, by;
+    float energy;
+} software_piece_t;
+
+// Everything about a piece that beam_fragment_shader works out per pixel, worked out once.
+typedef struct
+{
+    float ax, ay;
+    float ux, uy; // Direction of the piece
+    float length;
+    float falloff; // 1 / (2 sigma^2)
+    float inverse; // 1 / (sqrt(2) sigma)
+    float weight;  // Energy per pixel before the exponentials
+    int line;      // FALSE if the piece is so short it is drawn as a point
+} software_splat_t;
+
+// Draws the trace on the CPU, for machines without a GPU. It works exactly like the GPU backends:
+// the energy decays, the pieces add the beam profile of beam_fragment_shader on top and the result
+// is tone mapped like display_fragment_shader into `pixels`, which has the layout of xytexture.
+// The screen is split into tiles of SOFTWARE_TILE pixels and every piece is sorted into the tiles
+// its quad overlaps. The thread calling draw_software and the helper threads then take tiles off
+// `next_tile` until none are left, no two threads ever write to the same pixel.
+typedef struct
+{
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    float *energy;         // Row k holds the pixels centred at y = k + 0.5
+    unsigned char *pixels; // RGBA, the top row shows the last row of energy
+
+    software_piece_t *pieces;
+    int piece_count;
+    int piece_capacity;
+    int *tile_start;  // Tile t draws tile_pieces[tile_start[t]] up to tile_pieces[tile_start[t + 1]]
+    int *tile_cursor; // Used while sorting
+    int *tile_pieces; // Indices into pieces
+    int tile_piece_capacity;
+
+    // The frame being drawn, only read by the threads
+    beam_t beam;
+    float decay;
+    float exposure;
+    Color background;
+    Color foreground;
+    atomic_int next_tile;
+
+    pthread_t threads[SOFTWARE_MAX_THREADS];
+    int thread_count;
+    int initialized; // TRUE once the lock and the conditions exist
+    pthread_mutex_t lock;
+    pthread_cond_t start; // Signalled when generation changes or quit is set
+    pthread_cond_t done;  // Signalled when busy drops to 0
+    int generation;       // Frames handed out so far
+    int busy;             // Helper threads still drawing the current frame
+    int quit;
+} software_t;
+
+typedef enum
+{
+    BACKEND_SHADER,   // Interpolation on the GPU, see trace_shader_t
+    BACKEND_BATCHED,  // Interpolation on the CPU, see trace_batch_t
+    BACKEND_SOFTWARE, // Everything on the CPU, see software_t
+    BACKEND_COUNT
+} backend_t;
+
+// Capture devices along with the menu entry of each one, formatted once.
+typedef struct
+{
+    ma_device_info infos[MAX_DEVICES];
+    char lines[MAX_DEVICES][DEVICE_LINE_SIZE];
+    ma_uint32 count;
+} device_list_t;
+
+// Enumerating devices is a blocking round-trip to the backend, so it happens on a
+// background thread every DEVICE_REFRESH_SECONDS. The render thread only ever copies
+// `shared` into `snapshot` when `generation` changed, and never waits for the lock.
+// miniaudio has no notification for devices being added or removed, hence the timer.
+typedef struct
+{
+    ma_context *context;
+    pthread_t thread;
+    pthread_mutex_t lock; // Guards shared, generation and running
+    pthread_cond_t wake;  // Signalled to stop the thread early
+
+    device_list_t shared;
+    unsigned int generation;
+    int running;
+
+    // Only touched by the render thread
+    device_list_t snapshot;
+    unsigned int snapshot_generation;
+} device_cache_t;
+
+typedef enum
+{
+    SYNC_FIXED,    // Capped at opt_t.fps
+    SYNC_VSYNC,    // Waits for the display, which also follows a variable refresh rate
+    SYNC_UNCAPPED, // As fast as it goes
+} sync_t;
+
+typedef enum
+{
+    CAPTURE_RUNNING,   // The last requested device is the one writing to the ring
+    CAPTURE_SWITCHING, // A new device is being opened, the previous one keeps running
+    CAPTURE_FAILED,    // The last requested device could not be opened, the previous one kept running
+} capture_status_t;
+
+// Owns the capture devices. Opening a device can take hundreds of milliseconds, so switching
+// happens on a worker thread: the new device is opened and started in the spare slot while the
+// old one keeps feeding the ring, then `active` is swapped and the old device is closed.
+// Only the slot in `active` may write to the ring, which keeps it single-producer.
+typedef struct
+{
+    ma_context *context;
+    ma_device_config config;
+    buffer_store_t *buffer_store;
+
+    ma_device devices[2];
+    int initialized[2];         // Only touched by the thread owning the devices
+    ma_device_id device_ids[2]; // The capture.pDeviceID of each slot points here, not into a device list
+    _Atomic int active;         // Slot the ring accepts frames from, -1 while swapping
+    _Atomic int busy[2];        // Set while the data callback of a slot is running
+    _Atomic int status;         // capture_status_t
+
+    _Atomic ma_uint64 callback_ns;     // Time spent in data_callback, for stats_t
+    _Atomic ma_uint64 dropped_periods; // Periods that did not fit in the ring, in full or in part
+
+    pthread_t thread;
+    pthread_mutex_t lock; // Guards running, pending and pending_id
+    pthread_cond_t wake;
+    int running;
+    int pending;
+    ma_device_id pending_id;
+} capture_t;
+
+// What the stats overlay and the CSV file show. Every STATS_SECONDS the measurements
+// of the window that just ended are turned into `lines` and a row of `csv`.
+// Only touched by the render thread.
+typedef struct
+{
+    int shown;
+    FILE *csv;
+
+    double window_start; // monotonic_seconds
+    int frames;          // Loop iterations
+    ma_uint64 samples;
+    int samples_min;
+    int samples_max;
+    int merged_max; // Most captured samples merged into one, see lod_t
+    double latency_sum; // Seconds from the data callback that captured a frame to its buffer swap
+    double latency_max;
+    int latency_count;
+    double draw_cpu;             // Seconds of CPU time spent in handle_draw
+    ma_uint64 callback_ns_start; // capture_t.callback_ns when the window started
+    ma_uint64 dropped_start;     // capture_t.dropped_periods when the window started
+    ma_uint64 overruns_start;    // buffer_store_t.overruns when the window started
+
+    double pending_capture_time; // Newest frame in xytexture that has not been swapped to the screen yet, 0 if none
+
+    char lines[STATS_LINES][MENU_LINE_SIZE];
+} stats_t;
+
+// Plays a file back with --play while it is drawn. The file is decoded only once, by `thread`,
+// into the ring. The playback callback copies the frames at buffer_store_t.played to the device
+// and stamps them with when they will be heard, and the render thread draws the frames heard at
+// the next buffer swap from the same ring, so the picture follows the sound and not a loopback.
+// PCM and float WAV files (RF64 as well, for recordings past 4 GB) are memory-mapped instead and
+// the whole mapping becomes the ring, so there is no decoder and seeking is only moving
+// buffer_store_t.played: the callback jumps to `seek` when it is set and marks the next stamp, and
+// the render thread follows as soon as the frame clock sees it, see handle_draw.
+typedef struct
+{
+    ma_decoder decoder;
+    ma_device device;
+    buffer_store_t *buffer_store;
+    void *mapping;       // The whole file when it is mapped, NULL when it is decoded
+    size_t mapping_size;
+    _Atomic ma_uint64 seek; // Frame the callback jumps to next, PLAY_NO_SEEK for none
+    int seeked;             // Jumped without a stamp saying so yet, only the callback touches it
+    float *frames;  // PLAY_CHUNK frames of the file, decoded before they go into the ring
+    double latency; // Seconds from the callback until the frames it copied are heard, as the device reports it
+
+    pthread_t thread;
+    int started;
+    _Atomic int running; // Cleared to stop the thread
+    _Atomic int decoded; // Set by the thread once the whole file is in the ring
+
+    _Atomic ma_uint64 callback_ns; // Time spent in playback_callback, for stats_t
+    _Atomic ma_uint64 underruns;   // Periods the ring could not fill before the end of the file
+} playback_t;
+
+// What an overview cache file next to the audio file starts with. The cache is only used if
+// all of it matches, then the level 0 histograms follow.
+typedef struct
+{
+    char magic[8];       // OVERVIEW_MAGIC
+    ma_uint64 file_size; // Of the audio file
+    ma_int64 file_mtime;
+    ma_uint32 block_frames;
+    ma_uint32 blocks;
+    ma_uint32 bins;
+    ma_uint32 traces;
+    ma_int32 channels[MAX_PLANES]; // trace_map_t.channels and z_planes it was binned with
+    ma_int32 z_planes[MAX_TRACES];
+} overview_header_t;
+
+// Zoomed out view of a mapped file, minutes of it up to all of it as one picture, without
+// touching its samples on every frame. Every block of OVERVIEW_BLOCK_SECONDS gets a 2D histogram
+// of where the beam spent its time on every trace, weighted by Z. Level l of the pyramid sums
+// 2^l blocks, so any range of blocks adds up from at most two nodes per level, like a
+// segment tree. `thread` loads level 0 from a cache next to the file or bins it with one
+// worker per core, builds the levels above and sets `ready`, the render thread never waits.
+// Only mapped files have one, see playback_t.
+typedef struct
+{
+    buffer_store_t *buffer_store; // Whose attached buffer is the file
+    const trace_map_t *map;
+    ma_uint32 block_frames;
+    int blocks;
+    int levels;
+    size_t level_nodes[OVERVIEW_LEVELS]; // First node of every level
+    size_t node_size;                    // Bins of all traces, OVERVIEW_BINS^2 for each
+    float *nodes;
+
+    overview_header_t header;
+    char cache_path[PATH_MAX];
+
+    pthread_t thread;
+    int started;
+    pthread_t workers[MAX_OVERVIEW_THREADS];
+    int worker_count;
+    _Atomic int next_block; // Next block a worker takes
+    _Atomic int done_blocks;
+    _Atomic int running;    // Cleared to stop the threads
+    _Atomic int ready;      // Set once the whole pyramid is there
+
+    // Only touched by the render thread.
+    double seconds;           // Length shown at once, 0 draws every sample instead
+    float *sum;               // The range shown, in the layout of a node
+    unsigned char *pixels;    // Tone mapped bins of one trace
+    Texture2D textures[MAX_TRACES];
+} overview_t;
+
+// What --udp receives, from the options.
+typedef struct
+{
+    const char *address;  // [ADDRESS:]PORT, a multicast address is joined, NULL to capture instead
+    int rtp;              // TRUE for RTP with big-endian L16 or L24 payloads, FALSE for raw PCM in `format`
+    ring_format_t format; // Of the stream, and of the ring
+    float jitter;         // Seconds, see net_t
+} net_config_t;
+
+// Receives the frames to draw over UDP with --udp instead of capturing them, so one sender on
+// a multicast group can feed any number of renderers. `thread` takes the datagrams off the
+// socket in batches and is the only writer of the ring, like the audio callback. Raw PCM has
+// no timestamps and goes straight into the ring. RTP, as AES67 sends it, goes through a jitter
+// buffer first: the payload of every packet is put into `frames` where its timestamp says, so
+// reordered packets still land in place, and frames are only released into the ring in order
+// once `jitter` seconds of newer ones have arrived, the ones that never did as silence. The
+// timestamps are unwrapped to 64 bits, `next` is the first frame not released yet and `newest`
+// the end of the newest packet, both in those.
+typedef struct
+{
+    buffer_store_t *buffer_store;
+    net_config_t config;
+    int socket;
+    unsigned char *packet; // NET_BATCH datagrams of NET_PACKET_SIZE bytes
+#if defined(NET_MMSG)
+    struct mmsghdr messages[NET_BATCH];
+    struct iovec vectors[NET_BATCH];
+#endif
+
+    // Only touched by `thread`.
+    unsigned char *frames;   // `capacity` frames in the format of the ring
+    unsigned char *filled;   // TRUE for every frame of `frames` a packet has put there
+    ma_uint32 capacity;      // In frames, a power of two
+    ma_uint32 jitter_frames;
+    int locked;              // FALSE until the first RTP packet arrives
+    ma_uint32 ssrc;          // Source followed, the packets of others are ignored
+    double source_time;      // monotonic_seconds of its newest packet
+    ma_uint64 next;
+    ma_uint64 newest;
+
+    pthread_t thread;
+    int started;
+    _Atomic int running; // Cleared to stop the thread
+
+    _Atomic ma_uint64 callback_ns;     // Time spent on the packets, for stats_t
+    _Atomic ma_uint64 dropped_periods; // Batches that did not fit in the ring, in full or in part
+    _Atomic ma_uint64 packets;         // Received, shown in the menu with the three below
+    _Atomic ma_uint64 lost;            // Frames released as silence because no packet brought them
+    _Atomic ma_uint64 late;            // Packets that arrived after their frames had been released
+    _Atomic ma_uint64 ignored;         // Packets of other sources, or too short to hold a frame
+} net_t;
+
+// One frame of a --share segment, see share_header_t.
+typedef struct
+{
+    _Atomic ma_uint64 frame; // Number of the frame in the slot, 0 while it is being written
+    ma_uint32 width;
+    ma_uint32 height;
+    double time; // CLOCK_MONOTONIC seconds when it was drawn
+} share_slot_t;
+
+// What the shared memory segment of --share starts with, the pixels of slot i follow at
+// pixels_offset + i * slot_size as RGBA with 8 bits each, the top row first. `frame` counts the
+// frames published, the newest is in slot (frame - 1) % slot_count. A reader copies it out and
+// then checks that the `frame` of the slot is still the same, like a seqlock, the writer only
+// comes back to the slot SHARE_SLOTS - 1 frames later. Once `closed` is set the writer is gone,
+// or has moved on to a new segment of the same name for bigger frames, and it has to be mapped
+// again.
+typedef struct
+{
+    char magic[8]; // SHARE_MAGIC
+    ma_uint32 slot_count;
+    ma_uint32 slot_size;
+    ma_uint32 pixels_offset;
+    _Atomic int closed;
+    _Atomic ma_uint64 frame;
+    share_slot_t slots[SHARE_SLOTS];
+} share_header_t;
+
+// Publishes every frame drawn into xytexture to other processes with --share, so live video
+// tools can composite the trace without capturing the window. Frames are read back from the
+// GPU asynchronously: glReadPixels goes into one of SHARE_READBACKS pixel buffers followed by
+// a fence, and the buffer is copied to the segment on a later frame once the fence has passed.
+// The software backend has the frame in memory already. Only touched by the render thread.
+typedef struct
+{
+    char path[PATH_MAX]; // Name of the segment, /dev/shm/ + it on Linux
+    share_header_t *header; // The mapped segment, NULL when not sharing
+    size_t size;
+    size_t slot_size;
+#if defined(ASYNC_READBACK)
+    GLuint buffers[SHARE_READBACKS];
+    GLsync fences[SHARE_READBACKS];
+    GLsizeiptr buffer_sizes[SHARE_READBACKS];
+#endif
+    int widths[SHARE_READBACKS]; // Of the frames in flight, from `oldest` on
+    int heights[SHARE_READBACKS];
+    double times[SHARE_READBACKS];
+    int oldest;
+    int pending;
+    ma_uint64 published;
+    ma_uint64 skipped; // Frames drawn while every readback was in flight
+} share_t;
+
+// Everything needed to render a file in one process, see render_file.
+typedef struct
+{
+    ma_decoder decoder;
+    ma_uint32 sample_rate;
+    ma_uint64 length; // In frames of audio, 0 if the decoder doesn't know
+    ring_format_t format; // Of the decoded samples
+    float *frames;    // Decoded samples of one frame of video
+    unsigned char *planes; // One frame of video in Y4M
+} render_t;
+
+typedef enum
+{
+    BENCH_OFF,       // Capture from a device instead
+    BENCH_LISSAJOUS, // Every channel a sine, a 3:2 figure for stereo
+    BENCH_NOISE,     // Every channel white noise, the worst case for the beam
+} bench_signal_t;
+
+// A render worker, a forked process with its own GL context. It renders the segments
+// the parent sends down `commands` into their own files and answers on `results`.
+typedef struct
+{
+    pid_t pid;
+    int commands; // Written by the parent
+    int results;  // Read by the parent
+    ma_int64 segment; // Being rendered, -1 if idle
+} render_worker_t;
+
+#if defined(PROFILE_ZONES)
+// A zone that has been entered but not left yet, see ZONE_BEGIN.
+typedef struct
+{
+    const char *name;
+    ma_uint64 start; // zone_now
+} zone_t;
+
+// One zone that was left.
+typedef struct
+{
+    const char *name;
+    ma_uint64 start;
+    ma_uint64 duration; // 0 for a point in time such as FRAME_MARK
+} zone_event_t;
+
+// The zones of one thread. Only that thread writes `events` and `count`, so recording never
+// takes a lock, not even in the audio callback. Whoever writes the profile reads them without
+// stopping the thread, leaving out the newest few which may be overwritten meanwhile.
+typedef struct zone_thread
+{
+    zone_event_t events[PROFILE_EVENTS];
+    _Atomic ma_uint64 count; // Zones recorded so far, the slot of a zone is its number modulo PROFILE_EVENTS
+    int id;
+    struct zone_thread *next;
+} zone_thread_t;
+
+// Every thread that recorded a zone. Threads only add themselves once and are never removed.
+typedef struct
+{
+    pthread_mutex_t lock; // Guards threads and next_id
+    zone_thread_t *threads;
+    int next_id;
+} profiler_t;
+#endif
+
 // We keep all those parameters as a struct in order to
 // pass it to different functions in the game loop, such as
 // handle_keyboard, and handle_draw.
@@ -59,40 +1023,385 @@ typedef struct
 {
     int screen_width;
     int screen_height;
+    int render_width;  // Of xytexture and the targets behind it, see resolution_t
+    int render_height;
+    resolution_t resolution;
     int fps;
+    sync_t sync;
     int default_device;
+    backend_t backend;
+    int interpolation;
+    int persistence; // TRUE to let the trace fade out instead of redrawing it from scratch
+    float half_life; // Seconds, see DEFAULT_HALF_LIFE
+    float exposure;
+    float latency;   // Seconds, see DEFAULT_LATENCY
+    float capacity;  // Seconds, see DEFAULT_CAPACITY
+    trace_map_t traces;
 
     ma_context context;
-    ma_device device;
-    ma_device_config config;
+    capture_t capture;
+    device_cache_t device_cache;
     buffer_store_t buffer_store;
+    frame_clock_t frame_clock;
     RenderTexture2D xytexture;
+    trace_batch_t trace_batch;
+    trace_shader_t trace_shader;
+    phosphor_t phosphor;
+    software_t software;
+    stats_t stats;
+    const char *stats_path; // CSV file for the statistics, NULL for none
+    int native;             // TRUE to capture in the format and rate of the device
+    const char *render_path; // Audio file to render offline instead of capturing, NULL for none
+    const char *play_path;   // Audio file to play back and draw instead of capturing, NULL for none
+    playback_t playback;
+    ma_uint64 playback_scrub; // Frame the mouse last scrubbed to, see handle_keyboard
+    overview_t overview;
+    net_config_t net_config;
+    net_t net;
+    const char *share_name; // Shared memory segment the frames are published to, NULL for none
+    share_t share;
+    int headless;           // TRUE to keep the window hidden, e.g. while sharing the frames
+    const char *output_path; // Where the offline render goes as Y4M, "-" for stdout
+    int jobs;                // Processes rendering in parallel
+    bench_signal_t bench;    // Signal --bench draws, BENCH_OFF to capture
+    int bench_rate;          // Sample rate of the signal
+    int bench_frames;        // Frames measured
+    const char *profile_path; // Where the profiling zones are written as JSON on exit and on KEY_PROFILE, NULL for none
+
+    // The frames captured since the previous call to handle_draw, and a few before
+    sample_window_t window;
+    double swap_time; // monotonic_seconds right after the previous buffer swap
+    lod_t lod;
+    trigger_t trigger;
+    analysis_t analysis;
+    int analysis_shown; // TRUE to show the panels of analysis_t
 
     int menu_shown;
+    char menu_backend[MENU_LINE_SIZE];       // Menu entries that depend on the options,
+    char menu_interpolation[MENU_LINE_SIZE]; // see update_menu_text
+    char menu_phosphor[MENU_LINE_SIZE];
+    char menu_layout[MENU_LINE_SIZE];
+    char menu_lod[MENU_LINE_SIZE];
+    char menu_trigger[MENU_LINE_SIZE];
+    char menu_analysis[MENU_LINE_SIZE];
+    char menu_resolution[MENU_LINE_SIZE];
+    char menu_sync[MENU_LINE_SIZE];
+    char menu_net[MENU_LINE_SIZE];       // What --udp receives
+    char menu_status[2][MENU_LINE_SIZE]; // Menu entries that change on their own, see update_menu_status
+    double menu_status_time;             // monotonic_seconds when they were formatted last
     int should_exit;
     int error_code;
 } opt_t;
 
+// The parts of a scope of rxyo.h. The ring is the one main captures into.
+struct rxyo_ring
+{
+    buffer_store_t buffer_store;
+};
+
+// What handle_draw takes the new frames of the ring through. `generation` counts the calls to
+// rxyo_chain_process, so renderers know whether they drew the window already.
+struct rxyo_chain
+{
+    trace_map_t traces;
+    sample_window_t window;
+    trigger_t trigger;
+    lod_t lod;
+    int drawn;             // Samples of the window left after the trigger and the level of detail
+    ma_uint32 sample_rate; // Of the ring the window was taken from
+    ma_uint64 generation;
+};
+
+// The parts of opt_t render_trace draws with, and the window of which chain it drew last.
+struct rxyo_renderer
+{
+    opt_t opt;
+    int plane_size; // Of the windows the trace shader was made for
+    const rxyo_chain_t *chain;
+    ma_uint64 generation;
+};
+
+// One of each, as main has them.
+struct rxyo_scope
+{
+    rxyo_ring_t *ring;
+    rxyo_chain_t *chain;
+    rxyo_renderer_t *renderer;
+};
+
+// A capture device of rxyo.h, with a miniaudio context of its own.
+struct rxyo_source
+{
+    ma_context context;
+    capture_t capture;
+};
+
 /*
     Those functions are implemented at the bottom.
 */
 
 // You probably only need to touch those functions if only you change the buffer_store_t above
-void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount);
-void initialize_buffer_store(buffer_store_t *buffer_store);
+RXYO_INTERNAL void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount);
+RXYO_INTERNAL int init_buffer_store(buffer_store_t *buffer_store, float seconds, ma_uint32 channels);
+RXYO_INTERNAL void uninit_buffer_store(buffer_store_t *buffer_store);
+RXYO_INTERNAL int buffer_store_set_format(buffer_store_t *buffer_store, ma_format format, ma_uint32 channels, ma_uint32 sampleRate);
+RXYO_INTERNAL float ring_seconds(const opt_t *opt);
+RXYO_INTERNAL ma_uint32 buffer_store_space(buffer_store_t *buffer_store);
+RXYO_INTERNAL ma_uint32 buffer_store_write(buffer_store_t *buffer_store, const void *frames, ma_uint32 frameCount);
+RXYO_INTERNAL ma_uint32 buffer_store_play(buffer_store_t *buffer_store, void *frames, ma_uint32 frameCount);
+RXYO_INTERNAL void buffer_store_attach(buffer_store_t *buffer_store, void *frames, ma_uint32 frameCount, const ring_format_t *format);
+RXYO_INTERNAL ma_uint32 buffer_store_read(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint32 maxFrames);
+RXYO_INTERNAL ma_uint32 buffer_store_read_until(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint64 until, ma_uint32 maxFrames);
+RXYO_INTERNAL int buffer_store_peek(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint64 end, ma_uint32 frameCount);
+RXYO_INTERNAL void buffer_store_stamp(buffer_store_t *buffer_store, double time);
+RXYO_INTERNAL int buffer_store_stamp_frame(buffer_store_t *buffer_store, ma_uint64 frame, double time, int seek);
+RXYO_INTERNAL int buffer_store_read_stamp(buffer_store_t *buffer_store, period_stamp_t *stamp);
+
+// Frame clock functions, see frame_clock_t
+RXYO_INTERNAL void init_frame_clock(frame_clock_t *clock, ma_uint32 sampleRate);
+RXYO_INTERNAL int frame_clock_update(frame_clock_t *clock, const period_stamp_t *stamp);
+RXYO_INTERNAL double frame_clock_frame_at(const frame_clock_t *clock, double time);
+RXYO_INTERNAL double frame_clock_time_of(const frame_clock_t *clock, ma_uint64 frame);
+
+// Conversion of captured frames into the planes of the traces, see ring_format_t
+RXYO_INTERNAL void convert_frames(const ring_format_t *format, const void *frames, ma_uint32 frameCount, const trace_map_t *map, float *const *planes);
+RXYO_INTERNAL void convert_s16_stereo(const ma_int16 *frames, ma_uint32 frameCount, float *xs, float *ys);
+RXYO_INTERNAL void convert_s32_stereo(const ma_int32 *frames, ma_uint32 frameCount, float *xs, float *ys);
+RXYO_INTERNAL void convert_f32_stereo(const float *frames, ma_uint32 frameCount, float *xs, float *ys);
+RXYO_INTERNAL float convert_sample(ma_format format, const unsigned char *sample);
+
+// Capture device functions, see capture_t
+RXYO_INTERNAL int init_capture(capture_t *capture, ma_context *context, buffer_store_t *buffer_store, int native, ma_uint32 channels);
+RXYO_INTERNAL void uninit_capture(capture_t *capture);
+RXYO_INTERNAL void capture_request_device(capture_t *capture, const ma_device_id *id);
+RXYO_INTERNAL ma_uint32 capture_sample_rate(capture_t *capture);
+RXYO_INTERNAL int capture_open(capture_t *capture, int slot, const ma_device_id *id);
+RXYO_INTERNAL void capture_swap(capture_t *capture, int slot);
+RXYO_INTERNAL void *capture_thread(void *arg);
+
+// Command line
+RXYO_INTERNAL int parse_args(opt_t *opt, int argc, char const *argv[]);
+RXYO_INTERNAL void print_usage(const char *program);
+
+// Trace map functions, see trace_map_t
+RXYO_INTERNAL void init_trace_map(trace_map_t *map);
+RXYO_INTERNAL int parse_trace_map(trace_map_t *map, const char *value);
+RXYO_INTERNAL ma_uint32 trace_map_channels(const trace_map_t *map);
+RXYO_INTERNAL void layout_traces(trace_map_t *map, int width, int height);
 
 // Those are the two main functions you might want to use.
-void handle_keyboard(opt_t *opt);
-void handle_draw(opt_t *opt, buffer_store_t *buffer_store, RenderTexture2D *xytexture);
+RXYO_INTERNAL void handle_keyboard(opt_t *opt);
+RXYO_INTERNAL void handle_draw(opt_t *opt, buffer_store_t *buffer_store, RenderTexture2D *xytexture);
+RXYO_INTERNAL void render_trace(opt_t *opt, const sample_window_t *window, RenderTexture2D *xytexture, int frameCount, ma_uint32 sampleRate, float frameTime);
+
+// Offline rendering functions, see render_t
+RXYO_INTERNAL int render_file(opt_t *opt);
+RXYO_INTERNAL int render_file_parallel(opt_t *opt, FILE *output, ma_uint32 sampleRate, ma_uint64 length);
+RXYO_INTERNAL int open_render(opt_t *opt, render_t *render);
+RXYO_INTERNAL void close_render(opt_t *opt, render_t *render);
+RXYO_INTERNAL int render_segment(opt_t *opt, render_t *render, FILE *output, ma_uint64 firstFrame, ma_uint64 endFrame);
+RXYO_INTERNAL void render_worker(opt_t *opt, int commands, int results, const char *directory);
+RXYO_INTERNAL int copy_segment(const char *directory, ma_uint64 segment, FILE *output);
+RXYO_INTERNAL void write_y4m_header(FILE *file, int width, int height, int fps);
+RXYO_INTERNAL void write_y4m_frame(FILE *file, const unsigned char *rgba, int width, int height, unsigned char *planes);
+RXYO_INTERNAL void log_to_stderr(int logLevel, const char *text, va_list args);
+
+// Playback functions, see playback_t
+RXYO_INTERNAL int play_file(opt_t *opt);
+RXYO_INTERNAL int init_playback(playback_t *playback, buffer_store_t *buffer_store, const char *path);
+RXYO_INTERNAL int playback_map_wav(playback_t *playback, const char *path, ring_format_t *format, unsigned char **frames, ma_uint64 *frameCount);
+RXYO_INTERNAL void playback_seek(playback_t *playback, ma_uint64 frame);
+RXYO_INTERNAL void uninit_playback(playback_t *playback);
+RXYO_INTERNAL int start_playback(playback_t *playback);
+RXYO_INTERNAL int playback_finished(playback_t *playback);
+RXYO_INTERNAL int playback_decode(playback_t *playback);
+RXYO_INTERNAL void *playback_thread(void *arg);
+RXYO_INTERNAL void playback_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount);
+
+// Overview functions, see overview_t
+RXYO_INTERNAL int init_overview(overview_t *overview, buffer_store_t *buffer_store, const trace_map_t *map, const char *path);
+RXYO_INTERNAL void uninit_overview(overview_t *overview);
+RXYO_INTERNAL void *overview_thread(void *arg);
+RXYO_INTERNAL void *overview_worker(void *arg);
+RXYO_INTERNAL void overview_bin_block(overview_t *overview, int block);
+RXYO_INTERNAL void overview_build_levels(overview_t *overview);
+RXYO_INTERNAL int overview_load(overview_t *overview);
+RXYO_INTERNAL int overview_save(overview_t *overview);
+RXYO_INTERNAL float *overview_node(overview_t *overview, int level, size_t index);
+RXYO_INTERNAL void overview_zoom(overview_t *overview, int out);
+RXYO_INTERNAL void draw_overview(overview_t *overview, RenderTexture2D *xytexture, ma_uint64 frame, float frameTime, float exposure,
+                                 int width, int height, Color background, Color foreground);
+
+// Network input functions, see net_t
+RXYO_INTERNAL int listen_network(opt_t *opt);
+RXYO_INTERNAL int parse_net_format(net_config_t *config, const char *value);
+RXYO_INTERNAL int init_net(net_t *net, buffer_store_t *buffer_store, const net_config_t *config);
+RXYO_INTERNAL void uninit_net(net_t *net);
+RXYO_INTERNAL int start_net(net_t *net);
+RXYO_INTERNAL void *net_thread(void *arg);
+RXYO_INTERNAL void net_receive(net_t *net, const unsigned char *packet, int size, double now);
+RXYO_INTERNAL void net_release(net_t *net, ma_uint64 until, double now);
+RXYO_INTERNAL void net_resync(net_t *net, ma_uint32 ssrc, ma_uint32 timestamp);
+
+// Frame sharing functions, see share_t
+RXYO_INTERNAL int init_share(share_t *share, const char *name, int width, int height);
+RXYO_INTERNAL void uninit_share(share_t *share);
+RXYO_INTERNAL int share_open(share_t *share, size_t slotSize);
+RXYO_INTERNAL void share_close(share_t *share);
+RXYO_INTERNAL void share_publish(share_t *share, const RenderTexture2D *xytexture, const unsigned char *pixels);
+RXYO_INTERNAL void share_collect(share_t *share);
+RXYO_INTERNAL void share_write(share_t *share, const unsigned char *pixels, int width, int height, double time);
+RXYO_INTERNAL void share_stop(int signal);
+
+static volatile sig_atomic_t stop_requested = FALSE; // Set by share_stop, see handle_keyboard
+
+// Benchmark functions, see bench_signal_t
+RXYO_INTERNAL int run_bench(opt_t *opt);
+RXYO_INTERNAL void bench_signal(bench_signal_t signal, ma_uint64 first, ma_uint32 frameCount, ma_uint32 channels, ma_uint32 sampleRate, float *frames);
+RXYO_INTERNAL void print_bench_times(const char *name, double *times, int count);
+RXYO_INTERNAL int compare_doubles(const void *a, const void *b);
 
 // UI functions
-void draw_menu(opt_t *opt);
+RXYO_INTERNAL void draw_menu(opt_t *opt);
+RXYO_INTERNAL void update_menu_text(opt_t *opt);
+RXYO_INTERNAL void update_menu_status(opt_t *opt, double now);
+
+// Profiling functions, see zone_thread_t. The zones themselves are macros, see ZONE_BEGIN.
+RXYO_INTERNAL int write_profile(const char *path);
+#if defined(PROFILE_ZONES)
+RXYO_INTERNAL ma_uint64 zone_now(void);
+RXYO_INTERNAL void zone_record(const char *name, ma_uint64 start, ma_uint64 end);
+RXYO_INTERNAL zone_thread_t *zone_thread(void);
+#endif
+
+// Statistics functions, see stats_t
+RXYO_INTERNAL int init_stats(stats_t *stats, const char *path);
+RXYO_INTERNAL void uninit_stats(stats_t *stats);
+RXYO_INTERNAL void stats_presented(stats_t *stats, double now);
+RXYO_INTERNAL void stats_drawn(stats_t *stats, int samples, int merged, double captureTime);
+RXYO_INTERNAL void stats_update(stats_t *stats, buffer_store_t *buffer_store, ma_uint64 callbackNs, ma_uint64 droppedPeriods, double now);
+RXYO_INTERNAL void draw_stats(opt_t *opt);
+
+// Device enumeration functions, see device_cache_t
+RXYO_INTERNAL int init_device_cache(device_cache_t *cache, ma_context *context);
+RXYO_INTERNAL void uninit_device_cache(device_cache_t *cache);
+RXYO_INTERNAL const device_list_t *device_cache_snapshot(device_cache_t *cache);
+RXYO_INTERNAL void *device_cache_thread(void *arg);
+RXYO_INTERNAL int enumerate_devices(ma_context *context, device_list_t *list);
+
+// Trace batching functions, see trace_batch_t
+RXYO_INTERNAL int init_trace_batch(trace_batch_t *batch);
+RXYO_INTERNAL void unload_trace_batch(trace_batch_t *batch);
+RXYO_INTERNAL void trace_batch_reserve(trace_batch_t *batch, int vertexCount);
+RXYO_INTERNAL void trace_batch_push_line(trace_batch_t *batch, Vector2 a, Vector2 b, float energy);
+RXYO_INTERNAL void trace_batch_push_bezier(trace_batch_t *batch, Vector2 start, Vector2 end, Vector2 startControl, Vector2 endControl, int divisions, float energy);
+RXYO_INTERNAL void draw_trace_batch(trace_batch_t *batch, const beam_t *beam);
+
+// Shader interpolation functions, see trace_shader_t
+RXYO_INTERNAL int init_trace_shader(trace_shader_t *trace, int planes, int planeSize);
+RXYO_INTERNAL void unload_trace_shader(trace_shader_t *trace);
+RXYO_INTERNAL void draw_trace_shader(trace_shader_t *trace, const sample_window_t *window, const trace_map_t *map, int interpolation, const beam_t *beam);
+RXYO_INTERNAL int init_sample_stream(trace_shader_t *trace);
+RXYO_INTERNAL float *trace_shader_stream(trace_shader_t *trace);
+
+// Software rasterizer functions, see software_t
+RXYO_INTERNAL int init_software(software_t *software, int width, int height, int threads);
+RXYO_INTERNAL int resize_software(software_t *software, int width, int height);
+RXYO_INTERNAL void unload_software(software_t *software);
+RXYO_INTERNAL void reset_software(software_t *software);
+RXYO_INTERNAL void software_push_piece(software_t *software, Vector2 a, Vector2 b, float energy);
+RXYO_INTERNAL int software_bin(software_t *software);
+RXYO_INTERNAL void draw_software(software_t *software, const sample_window_t *window, const trace_map_t *map, int interpolation,
+                                 const beam_t *beam, float decay, float exposure, Color background, Color foreground);
+RXYO_INTERNAL void software_run(software_t *software);
+RXYO_INTERNAL void *software_thread(void *arg);
+RXYO_INTERNAL void software_tile(software_t *software, int tile);
+RXYO_INTERNAL int software_span(const software_splat_t *splat, float py, float radius, int x0, int x1, int *start, int *end);
+RXYO_INTERNAL void software_splat_span(float *row, int x0, int x1, float py, const software_splat_t *splat);
+RXYO_INTERNAL float software_erf(float x);
+#if defined(__AVX2__) && defined(__FMA__)
+RXYO_INTERNAL __m256 software_exp8(__m256 x);
+RXYO_INTERNAL __m256 software_erf8(__m256 x);
+#endif
+
+// Beam functions, see beam_t
+RXYO_INTERNAL beam_t beam_for(int width, int height, ma_uint32 sampleRate);
+
+// Phosphor functions, see phosphor_t
+RXYO_INTERNAL int init_phosphor(phosphor_t *phosphor, int width, int height);
+RXYO_INTERNAL int resize_phosphor(phosphor_t *phosphor, int width, int height);
+RXYO_INTERNAL void unload_phosphor(phosphor_t *phosphor);
+RXYO_INTERNAL RenderTexture2D load_float_render_texture(int width, int height);
+RXYO_INTERNAL void reset_phosphor(phosphor_t *phosphor);
+RXYO_INTERNAL void begin_phosphor(phosphor_t *phosphor, float decay);
+RXYO_INTERNAL void end_phosphor(phosphor_t *phosphor, RenderTexture2D *xytexture, float exposure, Color background, Color foreground);
+
+// Sample window functions, see sample_window_t
+RXYO_INTERNAL int init_sample_window(sample_window_t *window, int traces, int planes, int capacity);
+RXYO_INTERNAL void unload_sample_window(sample_window_t *window);
+RXYO_INTERNAL void begin_sample_window(sample_window_t *window, float *planes);
+RXYO_INTERNAL void end_sample_window(sample_window_t *window, int frameCount);
+
+// Resolution functions, see resolution_t
+RXYO_INTERNAL void init_resolution(resolution_t *resolution);
+RXYO_INTERNAL void render_size(const opt_t *opt, float scale, int *width, int *height);
+RXYO_INTERNAL int init_render_targets(opt_t *opt);
+RXYO_INTERNAL int resize_render_targets(opt_t *opt, float scale);
+RXYO_INTERNAL float resolution_update(resolution_t *resolution, double seconds);
+
+// Trigger functions, see trigger_t
+RXYO_INTERNAL void init_trigger(trigger_t *trigger);
+RXYO_INTERNAL double trigger_update(trigger_t *trigger, const sample_window_t *window, int frameCount);
+RXYO_INTERNAL int trigger_fold(trigger_t *trigger, sample_window_t *window, int frameCount);
+
+// FFT functions, see fft_t
+RXYO_INTERNAL void init_fft(fft_t *fft, int size);
+RXYO_INTERNAL void fft_transform(const fft_t *fft, float *re, float *im, int inverse);
+
+// Analysis functions, see analysis_t
+RXYO_INTERNAL int init_analysis(analysis_t *analysis, buffer_store_t *buffer_store, const trace_map_t *traces, int enabled);
+RXYO_INTERNAL void uninit_analysis(analysis_t *analysis);
+RXYO_INTERNAL void *analysis_thread(void *arg);
+RXYO_INTERNAL int analysis_update(analysis_t *analysis);
+RXYO_INTERNAL const analysis_result_t *analysis_latest(analysis_t *analysis);
+RXYO_INTERNAL void draw_analysis(analysis_t *analysis, int screen_width, int screen_height);
+
+// Level of detail functions, see lod_t
+RXYO_INTERNAL void init_lod(lod_t *lod);
+RXYO_INTERNAL void uninit_lod(lod_t *lod);
+RXYO_INTERNAL int lod_decimate(lod_t *lod, sample_window_t *window, const trace_map_t *map, int frameCount);
+RXYO_INTERNAL void lod_begin(lod_t *lod);
+RXYO_INTERNAL void lod_end(lod_t *lod, int frameCount, int drawn);
+RXYO_INTERNAL int lod_collect(lod_t *lod, int slot, int wait);
 
 // Utility functions
-float clamp(float x, const float min_x, const float max_x);
-int min(int x, int y);
-float length(float x0, float y0, float x1, float y1);
+RXYO_INTERNAL float clamp(float x, const float min_x, const float max_x);
+RXYO_INTERNAL double monotonic_seconds(void);
+RXYO_INTERNAL double thread_cpu_seconds(void);
+RXYO_INTERNAL ma_uint64 read_le(const unsigned char *bytes, int size);
+RXYO_INTERNAL ma_uint64 read_be(const unsigned char *bytes, int size);
 
+// Allocation checks, see FORBID_ALLOCATIONS. malloc, calloc, realloc, free, posix_memalign and
+// aligned_alloc are defined as well, in front of the ones dlsym finds next.
+#if defined(CHECK_ALLOCATIONS)
+static _Thread_local volatile int allocation_guard = 0; // Above 0 where allocations are forbidden, volatile as the compiler takes realloc for not reading it
+static void *(*next_malloc)(size_t);
+static void *(*next_calloc)(size_t, size_t);
+static void *(*next_realloc)(void *, size_t);
+static void (*next_free)(void *);
+static int (*next_posix_memalign)(void **, size_t, size_t);
+static void *(*next_aligned_alloc)(size_t, size_t);
+static int resolving_allocator = FALSE;
+static unsigned char bootstrap_heap[4096] __attribute__((aligned(16))); // What dlsym allocates, see resolve_allocator
+static size_t bootstrap_used = 0;
+RXYO_INTERNAL void resolve_allocator(void);
+RXYO_INTERNAL void *bootstrap_allocate(size_t size);
+RXYO_INTERNAL int is_bootstrap_allocation(const void *ptr);
+RXYO_INTERNAL void check_allocation(const char *function, size_t size, void *caller);
+#endif
+
+// Built with -DRXYO_LIBRARY only the functions of rxyo.h are meant to be called from outside.
+#if !defined(RXYO_LIBRARY)
 int main(int argc, char const *argv[])
 {
     static opt_t opt;
@@ -102,13 +1411,58 @@ int main(int argc, char const *argv[])
     opt.screen_width = DEFAULT_SCREEN_WIDTH;
     opt.screen_height = DEFAULT_SCREEN_HEIGHT;
     opt.fps = DEFAULT_FPS;
+    opt.sync = SYNC_FIXED;
     opt.default_device = 0;
+    opt.backend = BACKEND_SHADER;
+    opt.interpolation = DEFAULT_INTERPOLATION;
+    opt.persistence = FALSE;
+    opt.half_life = DEFAULT_HALF_LIFE;
+    opt.exposure = DEFAULT_EXPOSURE;
+    opt.latency = DEFAULT_LATENCY;
+    opt.capacity = DEFAULT_CAPACITY;
+    init_trace_map(&opt.traces);
+    init_lod(&opt.lod);
+    init_resolution(&opt.resolution);
+    init_trigger(&opt.trigger);
+    opt.jobs = 1;
+    opt.bench_rate = 48000;
+    opt.bench_frames = BENCH_FRAMES;
+    parse_net_format(&opt.net_config, "L24:2:48000");
+    opt.net_config.jitter = DEFAULT_JITTER;
 
     // Set up logging
     SetTraceLogLevel(LOG_LEVEL);
 
-    // Initialize buffer store to 0s
-    initialize_buffer_store(&opt.buffer_store);
+    if (parse_args(&opt, argc, argv) != 0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    // A rendered video is exactly the size asked for.
+    if (opt.render_path != NULL)
+    {
+        opt.resolution.scale = 1.0f;
+        opt.resolution.dynamic = FALSE;
+    }
+    opt.resolution.current = opt.resolution.scale;
+    render_size(&opt, opt.resolution.scale, &opt.render_width, &opt.render_height);
+    layout_traces(&opt.traces, opt.render_width, opt.render_height);
+
+    // Rendering, playing a file, receiving over the network or benchmarking needs none of
+    // the audio set up below.
+    if (opt.render_path != NULL || opt.play_path != NULL || opt.net_config.address != NULL || opt.bench != BENCH_OFF)
+    {
+        int result = opt.render_path != NULL          ? render_file(&opt)
+                     : opt.play_path != NULL          ? play_file(&opt)
+                     : opt.net_config.address != NULL ? listen_network(&opt)
+                                                      : run_bench(&opt);
+        write_profile(opt.profile_path);
+        return result;
+    }
+
+    // The ring is sized for the format it ends up capturing in, see ring_seconds.
+    if (init_buffer_store(&opt.buffer_store, ring_seconds(&opt), trace_map_channels(&opt.traces)) != 0)
+        return -1;
 
     // Audio set up
     // Use a default capture device, use numbers 1->9 to choose an input device afterwards
@@ -116,258 +1470,7157 @@ int main(int argc, char const *argv[])
     // We pass this to the opt_t struct since we will use it to change devices on the fly.
     if (ma_context_init(NULL, 0, NULL, &opt.context) != MA_SUCCESS)
     {
+        uninit_buffer_store(&opt.buffer_store);
+        return -1;
+    }
+
+    // Lists the capture devices for the menu in the background from now on.
+    if (init_device_cache(&opt.device_cache, &opt.context) != 0)
+    {
+        ma_context_uninit(&opt.context);
+        uninit_buffer_store(&opt.buffer_store);
+        return -1;
+    }
+
+    // Opens the default capture device, switching to another one happens on a worker thread.
+    if (init_capture(&opt.capture, &opt.context, &opt.buffer_store, opt.native, trace_map_channels(&opt.traces)) != 0)
+    {
+        uninit_device_cache(&opt.device_cache);
+        ma_context_uninit(&opt.context);
+        uninit_buffer_store(&opt.buffer_store);
         return -1;
     }
+    init_frame_clock(&opt.frame_clock, capture_sample_rate(&opt.capture));
 
-    opt.config = ma_device_config_init(ma_device_type_capture);
-    opt.config.capture.format = ma_format_f32; // Set to ma_format_unknown to use the device's native format.
-    opt.config.capture.channels = 2;           // Set to 0 to use the device's native channel count.
-    opt.config.sampleRate = 48000;             // Set to 0 to use the device's native sample rate.
-    opt.config.dataCallback = data_callback;   // This function will be called when miniaudio needs more data.
-    opt.config.pUserData = &opt.buffer_store;  // Can be accessed from the device object (device.pUserData).
-    if (ma_device_init(NULL, &opt.config, &opt.device) != MA_SUCCESS)
+    // A frame can take everything in the ring.
+    if (init_sample_window(&opt.window, opt.traces.count, opt.traces.planes, opt.buffer_store.capacity) != 0)
     {
+        uninit_capture(&opt.capture);
+        uninit_device_cache(&opt.device_cache);
+        ma_context_uninit(&opt.context);
+        uninit_buffer_store(&opt.buffer_store);
         return -1;
     }
-    ma_device_start(&opt.device); // The device is sleeping by default so you'll need to start it manually.
 
     // Graphics set up
+    if (opt.sync == SYNC_VSYNC)
+        SetConfigFlags(FLAG_VSYNC_HINT);
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    if (opt.headless)
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
     InitWindow(opt.screen_width, opt.screen_height, "Simple XY");
 
-    // Between frames, we draw on this texture, then we show it on screen all at once.
-    opt.xytexture = LoadRenderTexture(opt.screen_width, opt.screen_height);
+    // Between frames, we draw on xytexture at the render resolution, then we show it on screen
+    // all at once. The trace is drawn with one draw call per frame, this needs its own shader
+    // and buffers. It is accumulated as beam energy into float targets before being shown in
+    // xytexture. The software backend is set up as well so b can switch to it.
+    if (init_trace_batch(&opt.trace_batch) != 0 || init_render_targets(&opt) != 0)
+    {
+        unload_trace_batch(&opt.trace_batch);
+        CloseWindow();
+        unload_sample_window(&opt.window);
+        uninit_capture(&opt.capture);
+        uninit_device_cache(&opt.device_cache);
+        ma_context_uninit(&opt.context);
+        uninit_buffer_store(&opt.buffer_store);
+        return -1;
+    }
+
+    // Interpolating on the GPU needs texelFetch and gl_VertexID, fall back to the CPU if we can't.
+    if (init_trace_shader(&opt.trace_shader, opt.window.planes, opt.window.plane_size) != 0 && opt.backend == BACKEND_SHADER)
+    {
+        TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+        opt.backend = BACKEND_BATCHED;
+    }
+
+    // Statistics still show on screen if the CSV file can't be written.
+    if (init_stats(&opt.stats, opt.stats_path) != 0)
+        TraceLog(LOG_WARNING, "Could not open %s for the statistics", opt.stats_path);
+
+    // Other processes take the frames from shared memory instead of capturing the window.
+    if (opt.share_name != NULL && init_share(&opt.share, opt.share_name, opt.render_width, opt.render_height) != 0)
+        TraceLog(LOG_WARNING, "Not sharing the frames");
+
+    update_menu_text(&opt);
 
-    // main loop
-    SetTargetFPS(opt.fps);
+    // Looks at what was drawn on a thread of its own, the panels show whatever it published last.
+    if (init_analysis(&opt.analysis, &opt.buffer_store, &opt.traces, opt.analysis_shown) != 0)
+        TraceLog(LOG_WARNING, "No spectrum, goniometer and correlation");
+
+    // main loop, with vsync or uncapped raylib must not wait on its own
+    SetTargetFPS(opt.sync == SYNC_FIXED ? opt.fps : 0);
 
     while (!WindowShouldClose())
     {
         if (opt.should_exit == TRUE)
             break;
         handle_keyboard(&opt);
+
+        // CPU time rather than wall time, which would include waiting for the display. Reading
+        // that clock is a system call, so only while the statistics are shown or written.
+        int timed = opt.stats.shown || opt.stats.csv != NULL;
+        double cpu_start = timed ? thread_cpu_seconds() : 0.0;
         handle_draw(&opt, &opt.buffer_store, &opt.xytexture);
+        if (timed)
+            opt.stats.draw_cpu += thread_cpu_seconds() - cpu_start;
+
+        stats_update(&opt.stats, &opt.buffer_store, atomic_load_explicit(&opt.capture.callback_ns, memory_order_relaxed),
+                     atomic_load_explicit(&opt.capture.dropped_periods, memory_order_relaxed), monotonic_seconds());
     }
+    write_profile(opt.profile_path);
+    uninit_analysis(&opt.analysis);
+    uninit_stats(&opt.stats);
+    uninit_share(&opt.share);
+    uninit_lod(&opt.lod);
+    unload_software(&opt.software);
+    unload_phosphor(&opt.phosphor);
+    unload_trace_shader(&opt.trace_shader);
+    unload_trace_batch(&opt.trace_batch);
+    UnloadRenderTexture(opt.xytexture);
     CloseWindow();
-    ma_device_uninit(&opt.device);
+    unload_sample_window(&opt.window);
+    uninit_capture(&opt.capture);
+    uninit_device_cache(&opt.device_cache);
+    ma_context_uninit(&opt.context);
+    uninit_buffer_store(&opt.buffer_store);
 
     return 0;
 }
+#endif
 
 void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
 {
     /*
-     * This function simply writes to the buffer pointed by ptr and updates the buffer
-       index and nothing else.
+     * This function simply appends the captured period to the ring, stamps it and nothing else.
+     * It never allocates and reads no clock that takes a system call.
      */
-    buffer_store_t *buffer_store = (buffer_store_t *)pDevice->pUserData;
-    float *x = (float *)pInput;
+    FORBID_ALLOCATIONS();
+    double now = monotonic_seconds(); // As close to the end of the period as we get
+    capture_t *capture = (capture_t *)pDevice->pUserData;
+    int slot = pDevice == &capture->devices[0] ? 0 : 1;
+    ZONE_BEGIN(zone, "data_callback");
 
-    for (int i = 0; i < 2 * frameCount; i++)
+    // While switching devices both slots run, only the active one may write.
+    // busy is raised before checking active so capture_swap can wait for us.
+    atomic_store(&capture->busy[slot], TRUE);
+    if (atomic_load(&capture->active) == slot)
     {
-        buffer_store->buf[buffer_store->ptr][i] = x[i];
-
-        // Those are circular buffers, when the index goes to BUF_SIZE
-        // it starts pointing back to the beginning of the buffer.
-        // If we were dealing with an audio effect we should treat this as an issue
-        // but in this application it is not critical (might lead to some graphical
-        // glitches which might also be desirable ).
-        buffer_store->idx = (buffer_store->idx + 1) % BUF_SIZE;
+        // If the render thread has fallen more than the capacity behind the frames
+        // that do not fit are dropped instead of overwriting ones it may be reading.
+        // They are copied as they are, converting them is left to the render thread.
+        if (buffer_store_write(capture->buffer_store, pInput, frameCount) < frameCount)
+            atomic_fetch_add_explicit(&capture->dropped_periods, 1, memory_order_relaxed);
+        buffer_store_stamp(capture->buffer_store, now);
     }
+    atomic_store(&capture->busy[slot], FALSE);
+    ZONE_END(zone);
+
+    ma_uint64 ns = (ma_uint64)((monotonic_seconds() - now) * 1e9);
+    atomic_fetch_add_explicit(&capture->callback_ns, ns, memory_order_relaxed);
+    ALLOW_ALLOCATIONS();
 }
 
-void initialize_buffer_store(buffer_store_t *buffer_store)
+int init_buffer_store(buffer_store_t *buffer_store, float seconds, ma_uint32 channels)
 {
-    for (size_t i = 0; i < BUF_SIZE; i++)
-    {
-        buffer_store->buf[0][i] = 0.0;
-        buffer_store->buf[1][i] = 0.0;
-    }
+    /*
+    Sets up an empty ring that holds `seconds` of audio, in 48000 Hz float with the given
+    channels until buffer_store_set_format says otherwise. Returns 0 on success.
+    */
+    memset(buffer_store, 0, sizeof(*buffer_store));
+    buffer_store->seconds = seconds;
+
+    atomic_init(&buffer_store->head, 0);
+    atomic_init(&buffer_store->writing, 0);
+    atomic_init(&buffer_store->tail, 0);
+    atomic_init(&buffer_store->played, 0);
+    atomic_init(&buffer_store->overruns, 0);
+    atomic_init(&buffer_store->stamp_head, 0);
+    atomic_init(&buffer_store->stamp_tail, 0);
 
-    buffer_store->idx = 0;
-    buffer_store->ptr = 0;
+    return buffer_store_set_format(buffer_store, ma_format_f32, channels, 48000);
 }
 
-void handle_keyboard(opt_t *opt)
+void uninit_buffer_store(buffer_store_t *buffer_store)
 {
-    int key_pressed = GetKeyPressed();
-    if (key_pressed != 0)
+    if (!buffer_store->attached)
+        free(buffer_store->buf);
+    buffer_store->buf = NULL;
+    buffer_store->capacity = 0;
+}
+
+int buffer_store_set_format(buffer_store_t *buffer_store, ma_format format, ma_uint32 channels, ma_uint32 sampleRate)
+{
+    /*
+    Only while nothing is writing to or reading from the ring. Empties it, since the frames
+    already in it can't be read in the new format, and reallocates it for the new rate.
+    Returns 0 on success, the ring keeps its old format otherwise.
+    */
+    ma_uint32 frame_bytes = ma_get_bytes_per_frame(format, channels);
+    ma_uint32 capacity = (ma_uint32)ceilf(buffer_store->seconds * sampleRate);
+    if (capacity == 0)
+        capacity = 1;
+
+    // Cache line aligned for the SIMD conversions.
+    void *buf = NULL;
+    if (posix_memalign(&buf, 64, (size_t)capacity * frame_bytes) != 0)
     {
+        TraceLog(LOG_ERROR, "Could not allocate %u frames for the ring", capacity);
+        return -1;
+    }
+    if (!buffer_store->attached)
+        free(buffer_store->buf);
+    buffer_store->buf = buf;
+    buffer_store->attached = FALSE;
+    buffer_store->capacity = capacity;
 
-        TraceLog(LOG_DEBUG, "Pressed key: %d", key_pressed);
+    atomic_store(&buffer_store->head, 0);
+    atomic_store(&buffer_store->writing, 0);
+    atomic_store(&buffer_store->tail, 0);
+    atomic_store(&buffer_store->played, 0);
+    atomic_store(&buffer_store->stamp_head, 0);
+    atomic_store(&buffer_store->stamp_tail, 0);
 
-        if (key_pressed == KEY_MENU)
+    buffer_store->format.format = format;
+    buffer_store->format.channels = channels;
+    buffer_store->format.sample_rate = sampleRate;
+    buffer_store->format.frame_bytes = frame_bytes;
+
+    TraceLog(LOG_DEBUG, "Ring of %u frames (%zu bytes)", capacity, (size_t)capacity * frame_bytes);
+    return 0;
+}
+
+float ring_seconds(const opt_t *opt)
+{
+    /*
+    How much audio the ring has to hold: the frames are only drawn `latency` after they were
+    captured and one refresh after the previous ones were, on top of that it keeps `capacity`
+    for when the render thread falls behind.
+    */
+    float refresh = opt->sync == SYNC_FIXED ? 1.0f / opt->fps : 1.0f / MIN_REFRESH_RATE;
+    return opt->latency + refresh + opt->capacity;
+}
+
+ma_uint32 buffer_store_space(buffer_store_t *buffer_store)
+{
+    /*
+     * Producer side, the number of frames that can be written right now without dropping any.
+     */
+    ma_uint64 head = atomic_load_explicit(&buffer_store->head, memory_order_relaxed);
+    ma_uint64 tail = atomic_load_explicit(&buffer_store->tail, memory_order_acquire);
+    if (buffer_store->playing)
+    {
+        ma_uint64 played = atomic_load_explicit(&buffer_store->played, memory_order_acquire);
+        tail = played < tail ? played : tail;
+    }
+
+    return buffer_store->capacity - (ma_uint32)(head - tail);
+}
+
+ma_uint32 buffer_store_write(buffer_store_t *buffer_store, const void *frames, ma_uint32 frameCount)
+{
+    /*
+     * Producer side, only ever called from the audio callback, or from the decoder thread with
+     * --play. Returns the number of frames written.
+     */
+    ma_uint64 head = atomic_load_explicit(&buffer_store->head, memory_order_relaxed);
+
+    ma_uint32 capacity = buffer_store->capacity;
+    ma_uint32 space = buffer_store_space(buffer_store);
+    ma_uint32 count = frameCount < space ? frameCount : space;
+    ma_uint32 frame_bytes = buffer_store->format.frame_bytes;
+
+    if (count < frameCount)
+        atomic_fetch_add_explicit(&buffer_store->overruns, frameCount - count, memory_order_relaxed);
+
+    // Readers that peek have to see the slots are taken before any of them changes.
+    atomic_store_explicit(&buffer_store->writing, head + count, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Copy in at most two spans, the second one after wrapping around.
+    ma_uint32 start = (ma_uint32)(head % capacity);
+    ma_uint32 first = count < capacity - start ? count : capacity - start;
+    memcpy(buffer_store->buf + (size_t)start * frame_bytes, frames, (size_t)first * frame_bytes);
+    memcpy(buffer_store->buf, (const unsigned char *)frames + (size_t)first * frame_bytes, (size_t)(count - first) * frame_bytes);
+
+    // Publish the frames only after they have been copied.
+    atomic_store_explicit(&buffer_store->head, head + count, memory_order_release);
+
+    return count;
+}
+
+ma_uint32 buffer_store_read(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint32 maxFrames)
+{
+    /*
+     * Consumer side, only ever called from the render thread. Converts every frame published
+     * since the last call (up to maxFrames) into the planes of map and returns how many were converted.
+     */
+    return buffer_store_read_until(buffer_store, map, planes, UINT64_MAX, maxFrames);
+}
+
+ma_uint32 buffer_store_read_until(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint64 until, ma_uint32 maxFrames)
+{
+    /*
+     * Same as buffer_store_read but stops before frame `until` of the ring, which may
+     * not have been captured yet.
+     */
+    ma_uint64 tail = atomic_load_explicit(&buffer_store->tail, memory_order_relaxed);
+    ma_uint64 head = atomic_load_explicit(&buffer_store->head, memory_order_acquire);
+
+    if (until < head)
+        head = until < tail ? tail : until;
+
+    ma_uint32 available = (ma_uint32)(head - tail);
+    ma_uint32 count = available < maxFrames ? available : maxFrames;
+    ma_uint32 frame_bytes = buffer_store->format.frame_bytes;
+
+    // Straight from the ring into the planes, without copying the frames anywhere first.
+    ma_uint32 capacity = buffer_store->capacity;
+    ma_uint32 start = (ma_uint32)(tail % capacity);
+    ma_uint32 first = count < capacity - start ? count : capacity - start;
+    float *rest[MAX_PLANES];
+    for (int plane = 0; plane < map->planes; plane++)
+        rest[plane] = planes[plane] + first;
+    convert_frames(&buffer_store->format, buffer_store->buf + (size_t)start * frame_bytes, first, map, planes);
+    convert_frames(&buffer_store->format, buffer_store->buf, count - first, map, rest);
+
+    // Hand the slots back to the producer only after we are done converting them.
+    atomic_store_explicit(&buffer_store->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+int buffer_store_peek(buffer_store_t *buffer_store, const trace_map_t *map, float *const *planes, ma_uint64 end, ma_uint32 frameCount)
+{
+    /*
+     * For readers that only look at frames the render thread already consumed, without a
+     * counter of their own for the writer to wait for. Converts the frameCount frames before
+     * `end`, which must not be past the tail, into planes. Returns FALSE if the writer may have
+     * written over some of them meanwhile, planes are garbage then.
+     */
+    ma_uint64 first_frame = end - frameCount;
+    ma_uint32 frame_bytes = buffer_store->format.frame_bytes;
+    ma_uint32 capacity = buffer_store->capacity;
+    ma_uint32 start = (ma_uint32)(first_frame % capacity);
+    ma_uint32 first = frameCount < capacity - start ? frameCount : capacity - start;
+    float *rest[MAX_PLANES];
+    for (int plane = 0; plane < map->planes; plane++)
+        rest[plane] = planes[plane] + first;
+    convert_frames(&buffer_store->format, buffer_store->buf + (size_t)start * frame_bytes, first, map, planes);
+    convert_frames(&buffer_store->format, buffer_store->buf, frameCount - first, map, rest);
+
+    // The writer moves `writing` before it reuses the slot of a frame, which it only does once
+    // it is a whole capacity past it. The fence keeps the frames from being read after it.
+    atomic_thread_fence(memory_order_acquire);
+    ma_uint64 writing = atomic_load_explicit(&buffer_store->writing, memory_order_relaxed);
+    return writing - first_frame <= capacity;
+}
+
+ma_uint32 buffer_store_play(buffer_store_t *buffer_store, void *frames, ma_uint32 frameCount)
+{
+    /*
+     * Second consumer with --play, only ever called from the playback callback. Copies up to
+     * frameCount frames from `played` on into frames, as they are, and returns how many.
+     */
+    ma_uint64 played = atomic_load_explicit(&buffer_store->played, memory_order_relaxed);
+    ma_uint64 head = atomic_load_explicit(&buffer_store->head, memory_order_acquire);
+
+    ma_uint32 available = (ma_uint32)(head - played);
+    ma_uint32 count = available < frameCount ? available : frameCount;
+    ma_uint32 frame_bytes = buffer_store->format.frame_bytes;
+
+    ma_uint32 capacity = buffer_store->capacity;
+    ma_uint32 start = (ma_uint32)(played % capacity);
+    ma_uint32 first = count < capacity - start ? count : capacity - start;
+    memcpy(frames, buffer_store->buf + (size_t)start * frame_bytes, (size_t)first * frame_bytes);
+    memcpy((unsigned char *)frames + (size_t)first * frame_bytes, buffer_store->buf, (size_t)(count - first) * frame_bytes);
+
+    atomic_store_explicit(&buffer_store->played, played + count, memory_order_release);
+
+    return count;
+}
+
+void buffer_store_attach(buffer_store_t *buffer_store, void *frames, ma_uint32 frameCount, const ring_format_t *format)
+{
+    /*
+    Only while nothing is writing to or reading from the ring. Makes frameCount frames in format
+    the whole ring, all of them already written, instead of the ring's own buffer. frames stays
+    owned by the caller and has to outlive the ring.
+    */
+    if (!buffer_store->attached)
+        free(buffer_store->buf);
+    buffer_store->buf = frames;
+    buffer_store->attached = TRUE;
+    buffer_store->capacity = frameCount;
+    buffer_store->format = *format;
+
+    atomic_store(&buffer_store->head, frameCount);
+    atomic_store(&buffer_store->writing, frameCount);
+    atomic_store(&buffer_store->tail, 0);
+    atomic_store(&buffer_store->played, 0);
+    atomic_store(&buffer_store->stamp_head, 0);
+    atomic_store(&buffer_store->stamp_tail, 0);
+}
+
+void buffer_store_stamp(buffer_store_t *buffer_store, double time)
+{
+    /*
+     * Producer side, called from the audio callback right after buffer_store_write.
+     */
+    buffer_store_stamp_frame(buffer_store, atomic_load_explicit(&buffer_store->head, memory_order_relaxed), time, FALSE);
+}
+
+int buffer_store_stamp_frame(buffer_store_t *buffer_store, ma_uint64 frame, double time, int seek)
+{
+    /*
+     * Stamps `frame` with `time`, from the one thread that stamps: the audio callback, or the
+     * playback callback with --play. seek marks a jump to `frame`. Stamps are dropped while the
+     * queue is full, the frame clock does fine without a few. Returns FALSE if this one was.
+     */
+    ma_uint64 stamp_head = atomic_load_explicit(&buffer_store->stamp_head, memory_order_relaxed);
+    ma_uint64 stamp_tail = atomic_load_explicit(&buffer_store->stamp_tail, memory_order_acquire);
+
+    if (stamp_head - stamp_tail >= RING_STAMPS)
+        return FALSE;
+
+    period_stamp_t *stamp = &buffer_store->stamps[stamp_head & (RING_STAMPS - 1)];
+    stamp->frame = frame;
+    stamp->time = time;
+    stamp->seek = seek;
+
+    atomic_store_explicit(&buffer_store->stamp_head, stamp_head + 1, memory_order_release);
+    return TRUE;
+}
+
+int buffer_store_read_stamp(buffer_store_t *buffer_store, period_stamp_t *stamp)
+{
+    /*
+     * Consumer side, pops the oldest stamp into `stamp`. Returns FALSE when there is none.
+     */
+    ma_uint64 stamp_tail = atomic_load_explicit(&buffer_store->stamp_tail, memory_order_relaxed);
+    ma_uint64 stamp_head = atomic_load_explicit(&buffer_store->stamp_head, memory_order_acquire);
+
+    if (stamp_tail == stamp_head)
+        return FALSE;
+
+    *stamp = buffer_store->stamps[stamp_tail & (RING_STAMPS - 1)];
+    atomic_store_explicit(&buffer_store->stamp_tail, stamp_tail + 1, memory_order_release);
+
+    return TRUE;
+}
+
+// Conversion
+void convert_frames(const ring_format_t *format, const void *frames, ma_uint32 frameCount, const trace_map_t *map, float *const *planes)
+{
+    /*
+    Converts interleaved frames into the planes of map as floats in [-1, 1). A single trace of
+    the two channels of stereo s16, s32 and f32 has SIMD kernels, f32 is picked out of the frames
+    channel by channel and everything else goes through convert_sample one sample at a time.
+    */
+    int stereo = format->channels == 2 && map->planes == 2 && map->channels[0] == 0 && map->channels[1] == 1;
+    if (stereo && format->format == ma_format_s16)
+    {
+        convert_s16_stereo((const ma_int16 *)frames, frameCount, planes[0], planes[1]);
+        return;
+    }
+    if (stereo && format->format == ma_format_s32)
+    {
+        convert_s32_stereo((const ma_int32 *)frames, frameCount, planes[0], planes[1]);
+        return;
+    }
+    if (stereo && format->format == ma_format_f32)
+    {
+        convert_f32_stereo((const float *)frames, frameCount, planes[0], planes[1]);
+        return;
+    }
+
+    ma_uint32 sample_bytes = ma_get_bytes_per_sample(format->format);
+
+    for (int plane = 0; plane < map->planes; plane++)
+    {
+        ma_uint32 channel = (ma_uint32)map->channels[plane] < format->channels ? (ma_uint32)map->channels[plane] : format->channels - 1;
+        float *out = planes[plane];
+
+        if (format->format == ma_format_f32)
         {
-            if (opt->menu_shown == TRUE)
+            const float *in = (const float *)frames + channel;
+            for (ma_uint32 i = 0; i < frameCount; i++)
+                out[i] = in[i * format->channels];
+            continue;
+        }
+
+        const unsigned char *frame = (const unsigned char *)frames + channel * sample_bytes;
+        for (ma_uint32 i = 0; i < frameCount; i++)
+        {
+            out[i] = convert_sample(format->format, frame);
+            frame += format->frame_bytes;
+        }
+    }
+}
+
+void convert_s16_stereo(const ma_int16 *frames, ma_uint32 frameCount, float *xs, float *ys)
+{
+    const float scale = 1.0f / 32768.0f;
+    ma_uint32 i = 0;
+
+#if defined(__SSE2__)
+    // Every 32 bit lane holds one frame, y in the high half and x in the low one.
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= frameCount; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(frames + 2 * i));
+        __m128i x = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        __m128i y = _mm_srai_epi32(v, 16);
+        _mm_storeu_ps(xs + i, _mm_mul_ps(_mm_cvtepi32_ps(x), vscale));
+        _mm_storeu_ps(ys + i, _mm_mul_ps(_mm_cvtepi32_ps(y), vscale));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= frameCount; i += 8)
+    {
+        int16x8x2_t v = vld2q_s16(frames + 2 * i);
+        vst1q_f32(xs + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), scale));
+        vst1q_f32(xs + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), scale));
+        vst1q_f32(ys + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), scale));
+        vst1q_f32(ys + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), scale));
+    }
+#endif
+
+    for (; i < frameCount; i++)
+    {
+        xs[i] = frames[2 * i] * scale;
+        ys[i] = frames[2 * i + 1] * scale;
+    }
+}
+
+void convert_s32_stereo(const ma_int32 *frames, ma_uint32 frameCount, float *xs, float *ys)
+{
+    const float scale = 1.0f / 2147483648.0f;
+    ma_uint32 i = 0;
+
+#if defined(__SSE2__)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= frameCount; i += 4)
+    {
+        __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(frames + 2 * i)));
+        __m128 b = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(frames + 2 * i + 4)));
+        _mm_storeu_ps(xs + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), vscale));
+        _mm_storeu_ps(ys + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), vscale));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= frameCount; i += 4)
+    {
+        // Fixed point with 31 fractional bits, which is the scale above.
+        int32x4x2_t v = vld2q_s32(frames + 2 * i);
+        vst1q_f32(xs + i, vcvtq_n_f32_s32(v.val[0], 31));
+        vst1q_f32(ys + i, vcvtq_n_f32_s32(v.val[1], 31));
+    }
+#endif
+
+    for (; i < frameCount; i++)
+    {
+        xs[i] = frames[2 * i] * scale;
+        ys[i] = frames[2 * i + 1] * scale;
+    }
+}
+
+void convert_f32_stereo(const float *frames, ma_uint32 frameCount, float *xs, float *ys)
+{
+    ma_uint32 i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= frameCount; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(frames + 2 * i);
+        __m128 b = _mm_loadu_ps(frames + 2 * i + 4);
+        _mm_storeu_ps(xs + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(ys + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= frameCount; i += 4)
+    {
+        float32x4x2_t v = vld2q_f32(frames + 2 * i);
+        vst1q_f32(xs + i, v.val[0]);
+        vst1q_f32(ys + i, v.val[1]);
+    }
+#endif
+
+    for (; i < frameCount; i++)
+    {
+        xs[i] = frames[2 * i];
+        ys[i] = frames[2 * i + 1];
+    }
+}
+
+float convert_sample(ma_format format, const unsigned char *sample)
+{
+    /*
+    One sample of any format miniaudio captures in, little endian like miniaudio itself.
+    */
+    switch (format)
+    {
+    case ma_format_u8:
+        return (sample[0] - 128) / 128.0f;
+    case ma_format_s16:
+        return (ma_int16)(sample[0] | sample[1] << 8) / 32768.0f;
+    case ma_format_s24:
+        // Into the top three bytes, so the sign ends up in the right place.
+        return (ma_int32)((ma_uint32)sample[0] << 8 | (ma_uint32)sample[1] << 16 | (ma_uint32)sample[2] << 24) / 2147483648.0f;
+    case ma_format_s32:
+        return (ma_int32)((ma_uint32)sample[0] | (ma_uint32)sample[1] << 8 | (ma_uint32)sample[2] << 16 | (ma_uint32)sample[3] << 24) / 2147483648.0f;
+    case ma_format_f32:
+    {
+        float value;
+        memcpy(&value, sample, sizeof(value));
+        return value;
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+// Frame clock
+void init_frame_clock(frame_clock_t *clock, ma_uint32 sampleRate)
+{
+    memset(clock, 0, sizeof(*clock));
+
+    clock->nominal_rate = (double)sampleRate;
+    clock->rate = clock->nominal_rate;
+}
+
+int frame_clock_update(frame_clock_t *clock, const period_stamp_t *stamp)
+{
+    /*
+    Steers the clock towards a new timestamp. The loop filter follows
+    Adriaensen, "Using a DLL to filter time": the phase error corrects the position
+    right away and, integrated, the rate. Returns TRUE if the clock started over at the stamp.
+    */
+    double elapsed = stamp->time - clock->origin_time;
+    double error = (double)stamp->frame - frame_clock_frame_at(clock, stamp->time);
+
+    // Start over on the first stamp, on a seek however short, and whenever the stream jumped:
+    // switching devices, dropped frames or a callback that stalled.
+    if (!clock->locked || stamp->seek || elapsed <= 0.0 || fabs(error) > CLOCK_MAX_ERROR * clock->nominal_rate)
+    {
+        clock->locked = TRUE;
+        clock->origin_time = stamp->time;
+        clock->origin_frame = (double)stamp->frame;
+        clock->rate = clock->nominal_rate;
+        return TRUE;
+    }
+
+    double omega = 2.0 * M_PI * CLOCK_BANDWIDTH * elapsed;
+    double position_gain = fmin(M_SQRT2 * omega, 1.0);
+    double rate_gain = omega * omega / elapsed;
+
+    clock->origin_frame += clock->rate * elapsed + position_gain * error;
+    clock->origin_time = stamp->time;
+    clock->rate += rate_gain * error;
+    return FALSE;
+}
+
+double frame_clock_frame_at(const frame_clock_t *clock, double time)
+{
+    /*
+    Frame of the ring captured at `time`, a fraction if it falls between two frames.
+    */
+    return clock->origin_frame + (time - clock->origin_time) * clock->rate;
+}
+
+double frame_clock_time_of(const frame_clock_t *clock, ma_uint64 frame)
+{
+    /*
+    The inverse of frame_clock_frame_at.
+    */
+    return clock->origin_time + ((double)frame - clock->origin_frame) / clock->rate;
+}
+
+int parse_args(opt_t *opt, int argc, char const *argv[])
+{
+    /*
+    Overrides the defaults in opt with the command line options. Returns 0 on success.
+    */
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "-b") == 0 || strcmp(arg, "--backend") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            if (strcmp(value, "shader") == 0)
+                opt->backend = BACKEND_SHADER;
+            else if (strcmp(value, "batched") == 0)
+                opt->backend = BACKEND_BATCHED;
+            else if (strcmp(value, "software") == 0)
+                opt->backend = BACKEND_SOFTWARE;
+            else
+                return -1;
+            i++;
+        }
+        else if (strcmp(arg, "-i") == 0 || strcmp(arg, "--interpolation") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->interpolation = (int)clamp(atoi(value), 1, MAX_INTERPOLATION);
+            i++;
+        }
+        else if (strcmp(arg, "-p") == 0 || strcmp(arg, "--phosphor") == 0)
+        {
+            if (value == NULL || atof(value) <= 0.0)
+                return -1;
+            opt->persistence = TRUE;
+            opt->half_life = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-T") == 0 || strcmp(arg, "--trigger") == 0)
+        {
+            opt->trigger.enabled = TRUE;
+        }
+        else if (strcmp(arg, "-A") == 0 || strcmp(arg, "--analysis") == 0)
+        {
+            opt->analysis_shown = TRUE;
+        }
+        else if (strcmp(arg, "-L") == 0 || strcmp(arg, "--lod") == 0)
+        {
+            if (value == NULL || atof(value) <= 0.0)
+                return -1;
+            opt->lod.enabled = TRUE;
+            opt->lod.budget = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-e") == 0 || strcmp(arg, "--exposure") == 0)
+        {
+            if (value == NULL || atof(value) <= 0.0)
+                return -1;
+            opt->exposure = atof(value);
+            i++;
+        }
+        else if (strcmp(arg, "-f") == 0 || strcmp(arg, "--fps") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            if (strcmp(value, "vsync") == 0)
+                opt->sync = SYNC_VSYNC;
+            else if (strcmp(value, "uncapped") == 0)
+                opt->sync = SYNC_UNCAPPED;
+            else if (atoi(value) > 0)
             {
-                opt->menu_shown = FALSE;
+                opt->sync = SYNC_FIXED;
+                opt->fps = atoi(value);
             }
             else
+                return -1;
+            i++;
+        }
+        else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--stats") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->stats_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "-r") == 0 || strcmp(arg, "--render") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->render_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "-F") == 0 || strcmp(arg, "--play") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->play_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "-U") == 0 || strcmp(arg, "--udp") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->net_config.address = value;
+            i++;
+        }
+        else if (strcmp(arg, "-u") == 0 || strcmp(arg, "--udp-format") == 0)
+        {
+            if (value == NULL || parse_net_format(&opt->net_config, value) != 0)
+                return -1;
+            i++;
+        }
+        else if (strcmp(arg, "-J") == 0 || strcmp(arg, "--jitter") == 0)
+        {
+            if (value == NULL || atof(value) < 0.0)
+                return -1;
+            opt->net_config.jitter = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-O") == 0 || strcmp(arg, "--share") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->share_name = value;
+            i++;
+        }
+        else if (strcmp(arg, "-H") == 0 || strcmp(arg, "--headless") == 0)
+        {
+            opt->headless = TRUE;
+            opt->menu_shown = FALSE;
+        }
+        else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->output_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0)
+        {
+            if (value == NULL || atoi(value) < 1)
+                return -1;
+            opt->jobs = atoi(value) < MAX_JOBS ? atoi(value) : MAX_JOBS;
+            i++;
+        }
+        else if (strcmp(arg, "-n") == 0 || strcmp(arg, "--native") == 0)
+        {
+            opt->native = TRUE;
+        }
+        else if (strcmp(arg, "-l") == 0 || strcmp(arg, "--latency") == 0)
+        {
+            if (value == NULL || atof(value) < 0.0)
+                return -1;
+            opt->latency = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--capacity") == 0)
+        {
+            if (value == NULL || atof(value) < 0.0)
+                return -1;
+            opt->capacity = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-S") == 0 || strcmp(arg, "--scale") == 0)
+        {
+            if (value == NULL || atof(value) <= 0.0 || atof(value) > MAX_RESOLUTION_SCALE)
+                return -1;
+            opt->resolution.scale = atof(value);
+            i++;
+        }
+        else if (strcmp(arg, "-D") == 0 || strcmp(arg, "--dynamic") == 0)
+        {
+            if (value == NULL || atof(value) <= 0.0)
+                return -1;
+            opt->resolution.dynamic = TRUE;
+            opt->resolution.budget = atof(value) / 1000.0f;
+            i++;
+        }
+        else if (strcmp(arg, "-w") == 0 || strcmp(arg, "--size") == 0)
+        {
+            int width = 0, height = 0;
+            if (value == NULL || sscanf(value, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                return -1;
+            opt->screen_width = width;
+            opt->screen_height = height;
+            i++;
+        }
+        else if (strcmp(arg, "-B") == 0 || strcmp(arg, "--bench") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            if (strcmp(value, "lissajous") == 0)
+                opt->bench = BENCH_LISSAJOUS;
+            else if (strcmp(value, "noise") == 0)
+                opt->bench = BENCH_NOISE;
+            else
+                return -1;
+            i++;
+        }
+        else if (strcmp(arg, "-R") == 0 || strcmp(arg, "--rate") == 0)
+        {
+            if (value == NULL || atoi(value) <= 0)
+                return -1;
+            opt->bench_rate = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "-N") == 0 || strcmp(arg, "--frames") == 0)
+        {
+            if (value == NULL || atoi(value) <= 0)
+                return -1;
+            opt->bench_frames = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "-P") == 0 || strcmp(arg, "--profile") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            opt->profile_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "-t") == 0 || strcmp(arg, "--traces") == 0)
+        {
+            if (value == NULL || parse_trace_map(&opt->traces, value) != 0)
+                return -1;
+            i++;
+        }
+        else if (strcmp(arg, "-a") == 0 || strcmp(arg, "--layout") == 0)
+        {
+            if (value == NULL)
+                return -1;
+            if (strcmp(value, "overlay") == 0)
+                opt->traces.layout = LAYOUT_OVERLAY;
+            else if (strcmp(value, "split") == 0)
+                opt->traces.layout = LAYOUT_SPLIT;
+            else
+                return -1;
+            i++;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  -b, --backend shader|batched|software\n");
+    printf("                                Interpolate on the GPU (default) or the CPU, or draw everything on the CPU\n");
+    printf("  -i, --interpolation N         Pieces every segment between two samples is split into (1-%d, default %d)\n", MAX_INTERPOLATION, DEFAULT_INTERPOLATION);
+    printf("  -p, --phosphor MS             Let the trace fade out with the given half-life in milliseconds\n");
+    printf("  -T, --trigger                 Lock repeating figures by drawing whole periods of them, averaged\n");
+    printf("  -A, --analysis                Show the spectrum, a goniometer and the correlation of the first trace\n");
+    printf("  -L, --lod MS                  Merge samples that fall on the same pixels to draw the trace within MS per frame\n");
+    printf("  -e, --exposure X              Brightness of the beam (default %.1f)\n", DEFAULT_EXPOSURE);
+    printf("  -l, --latency MS              How far the trace lags behind the capture (default %.0f)\n", DEFAULT_LATENCY * 1000.0f);
+    printf("  -c, --capacity MS             How far drawing may fall behind before frames are dropped (default %.0f)\n", DEFAULT_CAPACITY * 1000.0f);
+    printf("  -t, --traces X:Y[:Z][,...]    Channels drawn against each other and optionally the brightness, up to %d traces (default 0:1)\n", MAX_TRACES);
+    printf("  -a, --layout overlay|split    Draw every trace over the whole screen (default) or each in its own cell\n");
+    printf("  -f, --fps N|vsync|uncapped    Cap the frame rate at N (default %d), follow the display or don't wait at all\n", DEFAULT_FPS);
+    printf("  -s, --stats FILE              Append the statistics to a CSV file every second\n");
+    printf("  -r, --render FILE             Render an audio file to Y4M video at the -f frame rate as fast as possible\n");
+    printf("  -F, --play FILE               Play an audio file on the default output and draw it in sync instead of capturing,\n");
+    printf("                                WAV files are mapped and can be sought with the arrow keys or by dragging\n");
+    printf("  -U, --udp [ADDRESS:]PORT      Draw what arrives over UDP instead of capturing, joining ADDRESS if it is a multicast group\n");
+    printf("  -u, --udp-format F:CHANNELS:HZ\n");
+    printf("                                RTP with L16 or L24 payloads, or raw s16, s24, s32 or f32 PCM (default L24:2:48000)\n");
+    printf("  -J, --jitter MS               How long RTP packets wait for late ones before them (default %.0f)\n", DEFAULT_JITTER * 1000.0f);
+    printf("  -O, --share NAME              Publish every frame drawn to the shared memory segment NAME for other processes\n");
+    printf("  -H, --headless                Keep the window hidden, stop on SIGINT or SIGTERM with --share\n");
+    printf("  -o, --output FILE             Where --render writes the video, - for stdout (default)\n");
+    printf("  -j, --jobs N                  Split --render between N processes\n");
+    printf("  -n, --native                  Capture in the format and sample rate of the device instead of converting to 48000 Hz float\n");
+    printf("  -S, --scale X                 Draw at X times the size of the window and stretch it over it (0-%.0f, default 1)\n", MAX_RESOLUTION_SCALE);
+    printf("  -D, --dynamic MS              Lower the resolution down to %.2f of the scale as needed to draw the trace within MS per frame\n", MIN_RESOLUTION_SCALE);
+    printf("  -w, --size WxH                Size of the window and of the video (default %dx%d)\n", DEFAULT_SCREEN_WIDTH, DEFAULT_SCREEN_HEIGHT);
+    printf("  -B, --bench lissajous|noise   Time the draw path on a synthetic signal and print the results as JSON\n");
+    printf("  -R, --rate HZ                 Sample rate of --bench (default 48000)\n");
+    printf("  -N, --frames N                Frames --bench measures (default %d)\n", BENCH_FRAMES);
+    printf("  -P, --profile FILE            Write the profiling zones as chrome://tracing JSON on exit and on d, needs -DPROFILE_ZONES\n");
+}
+
+// Trace map
+void init_trace_map(trace_map_t *map)
+{
+    /*
+    The left channel against the right one, without Z.
+    */
+    memset(map, 0, sizeof(*map));
+    map->count = 1;
+    map->planes = 2;
+    map->channels[0] = 0;
+    map->channels[1] = 1;
+    map->z_planes[0] = -1;
+}
+
+int parse_trace_map(trace_map_t *map, const char *value)
+{
+    /*
+    Reads comma separated X:Y or X:Y:Z channels, e.g. 0:1,2:3 for two stereo pairs or
+    0:1:2 for a stereo pair with the brightness in the third channel.
+    Returns 0 on success, map is left as it was otherwise.
+    */
+    int channels[MAX_TRACES][3];
+    int count = 0;
+
+    const char *cursor = value;
+    for (;;)
+    {
+        if (count == MAX_TRACES)
+            return -1;
+
+        // Z is the only optional one.
+        int axis = 0;
+        for (; axis < 3; axis++)
+        {
+            char *end;
+            long channel = strtol(cursor, &end, 10);
+            if (end == cursor || channel < 0 || channel >= RING_MAX_CHANNELS)
+                return -1;
+            channels[count][axis] = (int)channel;
+            cursor = end;
+            if (*cursor != ':' || axis == 2)
+                break;
+            cursor++;
+        }
+        if (axis == 0)
+            return -1;
+        if (axis == 1)
+            channels[count][2] = -1;
+        count++;
+
+        if (*cursor == '\0')
+            break;
+        if (*cursor != ',')
+            return -1;
+        cursor++;
+    }
+
+    trace_map_t parsed = *map;
+    parsed.count = count;
+    parsed.planes = 2 * count;
+    for (int trace = 0; trace < count; trace++)
+    {
+        parsed.channels[2 * trace] = channels[trace][0];
+        parsed.channels[2 * trace + 1] = channels[trace][1];
+        parsed.z_planes[trace] = channels[trace][2] < 0 ? -1 : parsed.planes;
+        if (channels[trace][2] >= 0)
+            parsed.channels[parsed.planes++] = channels[trace][2];
+    }
+
+    *map = parsed;
+    return 0;
+}
+
+ma_uint32 trace_map_channels(const trace_map_t *map)
+{
+    /*
+    Channels that have to be captured for every trace of map to be drawn.
+    */
+    int channels = 1;
+    for (int plane = 0; plane < map->planes; plane++)
+    {
+        if (map->channels[plane] + 1 > channels)
+            channels = map->channels[plane] + 1;
+    }
+    return (ma_uint32)channels;
+}
+
+void layout_traces(trace_map_t *map, int width, int height)
+{
+    /*
+    Works out the viewports of map on a width x height screen. Split in as many columns as rows,
+    or one more column, with the first trace in the top left. y grows upwards in xytexture.
+    */
+    int columns = 1;
+    while (columns * columns < map->count)
+        columns++;
+    int rows = (map->count + columns - 1) / columns;
+
+    for (int trace = 0; trace < map->count; trace++)
+    {
+        Rectangle *viewport = &map->viewports[trace];
+        if (map->layout == LAYOUT_OVERLAY)
+        {
+            *viewport = (Rectangle){0.0f, 0.0f, (float)width, (float)height};
+            continue;
+        }
+
+        int column = trace % columns;
+        int row = trace / columns;
+        viewport->width = (float)width / columns;
+        viewport->height = (float)height / rows;
+        viewport->x = column * viewport->width;
+        viewport->y = (rows - 1 - row) * viewport->height;
+    }
+}
+
+void handle_keyboard(opt_t *opt)
+{
+    // Hidden windows get no Esc, --share stops on signals instead.
+    if (stop_requested)
+        opt->should_exit = TRUE;
+
+    int key_pressed = GetKeyPressed();
+    if (key_pressed != 0)
+    {
+
+        TraceLog(LOG_DEBUG, "Pressed key: %d", key_pressed);
+
+        if (key_pressed == KEY_MENU)
+        {
+            if (opt->menu_shown == TRUE)
+            {
+                opt->menu_shown = FALSE;
+            }
+            else
+            {
+                opt->menu_shown = TRUE;
+            }
+        }
+        else if (key_pressed == KEY_BACKEND)
+        {
+            opt->backend = (opt->backend + 1) % BACKEND_COUNT;
+            if (opt->backend == BACKEND_SHADER && opt->trace_shader.shader.id == 0)
+                opt->backend = BACKEND_BATCHED;
+            // Each backend keeps its own glow, don't bring back what it had when it was left.
+            if (opt->backend == BACKEND_SOFTWARE)
+                reset_software(&opt->software);
+            else
+                reset_phosphor(&opt->phosphor);
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_LESS_INTERPOLATION)
+        {
+            opt->interpolation = opt->interpolation > 1 ? opt->interpolation / 2 : 1;
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_MORE_INTERPOLATION)
+        {
+            opt->interpolation = opt->interpolation < MAX_INTERPOLATION ? opt->interpolation * 2 : MAX_INTERPOLATION;
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_PHOSPHOR)
+        {
+            opt->persistence = !opt->persistence;
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_LAYOUT)
+        {
+            opt->traces.layout = opt->traces.layout == LAYOUT_SPLIT ? LAYOUT_OVERLAY : LAYOUT_SPLIT;
+            layout_traces(&opt->traces, opt->render_width, opt->render_height);
+            // The glow of the old layout would be left behind in the wrong place.
+            if (opt->backend == BACKEND_SOFTWARE)
+                reset_software(&opt->software);
+            else
+                reset_phosphor(&opt->phosphor);
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_TRIGGER)
+        {
+            opt->trigger.enabled = !opt->trigger.enabled;
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_RESOLUTION)
+        {
+            // Back to the scale asked for when turned off.
+            opt->resolution.dynamic = !opt->resolution.dynamic;
+            opt->resolution.held = 0;
+            opt->resolution.cost = 0.0;
+            opt->resolution.before = 0.0;
+            if (!opt->resolution.dynamic)
+                resize_render_targets(opt, opt->resolution.scale);
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_ANALYSIS)
+        {
+            opt->analysis_shown = !opt->analysis_shown;
+            atomic_store(&opt->analysis.enabled, opt->analysis_shown);
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_LOD)
+        {
+            opt->lod.enabled = !opt->lod.enabled;
+            update_menu_text(opt);
+        }
+        else if (key_pressed == KEY_STATS)
+        {
+            opt->stats.shown = !opt->stats.shown;
+        }
+        else if (key_pressed == KEY_PROFILE && opt->profile_path != NULL)
+        {
+            // Right after a hitch, before the zones of it are overwritten.
+            write_profile(opt->profile_path);
+        }
+        else if ((key_pressed == KEY_SEEK_BACK || key_pressed == KEY_SEEK_FORWARD) && opt->play_path != NULL)
+        {
+            // From what is being heard, which the picture follows.
+            double offset = (key_pressed == KEY_SEEK_BACK ? -SEEK_SECONDS : SEEK_SECONDS) * opt->buffer_store.format.sample_rate;
+            double frame = (double)atomic_load_explicit(&opt->buffer_store.played, memory_order_relaxed) + offset;
+            playback_seek(&opt->playback, frame > 0.0 ? (ma_uint64)frame : 0);
+        }
+        else if ((key_pressed == KEY_ZOOM_OUT || key_pressed == KEY_ZOOM_IN) && opt->overview.nodes != NULL)
+        {
+            int was_shown = opt->overview.seconds > 0.0;
+            overview_zoom(&opt->overview, key_pressed == KEY_ZOOM_OUT);
+            // Back to every sample, without the glow from before zooming out.
+            if (was_shown && opt->overview.seconds == 0.0)
+            {
+                if (opt->backend == BACKEND_SOFTWARE)
+                    reset_software(&opt->software);
+                else
+                    reset_phosphor(&opt->phosphor);
+            }
+        }
+        else if (48 <= key_pressed  && key_pressed <= 57 && opt->play_path == NULL && opt->net_config.address == NULL) // 0->9 numerical keys
+        {
+            // Use the same list the menu shows, so the number matches what the user sees.
+            const device_list_t *devices = device_cache_snapshot(&opt->device_cache);
+
+            // Convert a key press to a number between 0 and 9
+            ma_uint32 device_idx = key_pressed - 48;
+
+            // Returns immediately, the current device keeps running until the new one has started.
+            if (device_idx < devices->count)
+                capture_request_device(&opt->capture, &devices->infos[device_idx].id);
+        }
+    }
+
+    // Dragging across the window scrubs through a mapped file, the left edge is the start.
+    if (opt->play_path != NULL && opt->playback.mapping != NULL && IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+    {
+        float position = clamp((float)GetMouseX() / opt->screen_width, 0.0f, 1.0f);
+        ma_uint64 frame = (ma_uint64)(position * opt->buffer_store.capacity);
+        if (frame != opt->playback_scrub)
+            playback_seek(&opt->playback, frame);
+        opt->playback_scrub = frame;
+    }
+    else
+        opt->playback_scrub = PLAY_NO_SEEK;
+}
+
+void handle_draw(opt_t *opt, buffer_store_t *buffer_store, RenderTexture2D *xytexture)
+{
+    // The render targets follow the window at the same scale, the picture so far stretches meanwhile.
+    if (IsWindowResized())
+    {
+        opt->screen_width = GetScreenWidth();
+        opt->screen_height = GetScreenHeight();
+        resize_render_targets(opt, opt->resolution.current);
+    }
+
+    BeginDrawing();
+    ClearBackground(BACKGROUND_COLOR);
+
+    // We update  xytexture on the bottom of this function, at the render resolution.
+    DrawTexturePro(xytexture->texture, (Rectangle){0, 0, (float)xytexture->texture.width, (float)xytexture->texture.height},
+                   (Rectangle){0, 0, (float)opt->screen_width, (float)opt->screen_height}, (Vector2){0, 0}, 0.0f, WHITE);
+
+    // Whatever the analysis thread published last, this never waits for it.
+    if (opt->analysis_shown && opt->analysis.started)
+    {
+        ZONE_BEGIN(analysis_zone, "draw_analysis");
+        draw_analysis(&opt->analysis, opt->screen_width, opt->screen_height);
+        ZONE_END(analysis_zone);
+    }
+
+    // UI has to be drawn last since we overlay it over the xy curve
+    if (opt->menu_shown == TRUE)
+    {
+        FORBID_ALLOCATIONS();
+        update_menu_status(opt, monotonic_seconds());
+        ALLOW_ALLOCATIONS();
+        draw_menu(opt);
+    }
+    if (opt->stats.shown == TRUE)
+    {
+        draw_stats(opt);
+    }
+
+    // Includes waiting for the GPU to catch up and, with vsync, for the display.
+    ZONE_BEGIN(swap_zone, "EndDrawing");
+    EndDrawing();
+    ZONE_END(swap_zone);
+
+    // We come back from EndDrawing right after the buffers were swapped.
+    double now = monotonic_seconds();
+    stats_presented(&opt->stats, now);
+
+    // A mapped file jumps wherever it was sought to, and the picture jumps along with it.
+    period_stamp_t stamp;
+    while (buffer_store_read_stamp(buffer_store, &stamp))
+        if (frame_clock_update(&opt->frame_clock, &stamp) && buffer_store->attached)
+            atomic_store_explicit(&buffer_store->tail, stamp.frame, memory_order_relaxed);
+
+    // When this function is called do the following:
+    // -> Take a snapshot of every frame captured up to `latency` seconds ago, which
+    //    picks up exactly where the previous call left off. This way the number of
+    //    frames follows the time between refreshes and not how the audio periods
+    //    happened to line up with them. It also frees their slots in the ring.
+    // -> Draw the snapshot to the screen as xy coordinates.
+    // Until the first period arrives there is nothing to go by, so just take everything.
+    // Played frames are stamped with when they are heard and are in the ring long before
+    // that, so take the ones heard up to the next swap, when this frame is shown, and none
+    // before the first of them is heard.
+    ma_uint64 until = opt->play_path != NULL ? atomic_load_explicit(&buffer_store->tail, memory_order_relaxed) : UINT64_MAX;
+    double refresh = opt->swap_time > 0.0 ? now - opt->swap_time : 0.0;
+    double shown = opt->play_path != NULL ? now + refresh : now - opt->latency;
+    opt->swap_time = now;
+    if (opt->frame_clock.locked)
+        until = (ma_uint64)fmax(frame_clock_frame_at(&opt->frame_clock, shown), 0.0);
+    // The shader backend has the ring converted straight into the buffer it draws from.
+    ZONE_BEGIN(read_zone, "read_ring");
+    float *stream = opt->backend == BACKEND_SHADER ? trace_shader_stream(&opt->trace_shader) : NULL;
+    FORBID_ALLOCATIONS();
+    begin_sample_window(&opt->window, stream);
+    float *planes[MAX_PLANES];
+    for (int plane = 0; plane < opt->window.planes; plane++)
+        planes[plane] = opt->window.plane[plane] + WINDOW_HISTORY;
+    int frameCount = (int)buffer_store_read_until(buffer_store, &opt->traces, planes, until, opt->window.capacity);
+    end_sample_window(&opt->window, frameCount);
+    int drawn = trigger_fold(&opt->trigger, &opt->window, frameCount);
+    // A folded cycle doesn't carry on from the previous window, and neither does a run left from it.
+    if (opt->window.repeats > 1.0f)
+        opt->lod.run = 0;
+    drawn = lod_decimate(&opt->lod, &opt->window, &opt->traces, drawn);
+    ZONE_END(read_zone);
+
+    // The newest frame drawn now reaches the screen on the next swap.
+    double capture_time = 0.0;
+    if (opt->frame_clock.locked && frameCount > 0)
+        capture_time = frame_clock_time_of(&opt->frame_clock, atomic_load_explicit(&buffer_store->tail, memory_order_relaxed) - 1);
+    stats_drawn(&opt->stats, frameCount, opt->window.merged, capture_time);
+    ALLOW_ALLOCATIONS();
+
+    // Zoomed out the frames are still taken from the ring, the overview around them is shown instead.
+    if (opt->overview.seconds > 0.0 && atomic_load_explicit(&opt->overview.ready, memory_order_acquire))
+    {
+        ZONE_BEGIN(overview_zone, "draw_overview");
+        draw_overview(&opt->overview, xytexture, atomic_load_explicit(&buffer_store->tail, memory_order_relaxed), GetFrameTime(),
+                      opt->exposure, opt->render_width, opt->render_height, BACKGROUND_COLOR, FOREGROUND_COLOR);
+        ZONE_END(overview_zone);
+        share_publish(&opt->share, xytexture, NULL);
+        FRAME_MARK();
+        return;
+    }
+
+    ZONE_BEGIN(render_zone, "render_trace");
+    opt->lod.timed = opt->resolution.dynamic;
+    lod_begin(&opt->lod);
+    render_trace(opt, &opt->window, xytexture, drawn, buffer_store->format.sample_rate, GetFrameTime());
+    lod_end(&opt->lod, frameCount, drawn);
+    ZONE_END(render_zone);
+
+    // Before the targets are resized, the frame just drawn is in them.
+    share_publish(&opt->share, xytexture, opt->backend == BACKEND_SOFTWARE ? opt->software.pixels : NULL);
+
+    // Takes effect on the next frame, which starts on the new targets.
+    float scale = resolution_update(&opt->resolution, opt->lod.seconds);
+    if (scale != opt->resolution.current)
+    {
+        resize_render_targets(opt, scale);
+        update_menu_text(opt);
+    }
+    FRAME_MARK();
+}
+
+void render_trace(opt_t *opt, const sample_window_t *window, RenderTexture2D *xytexture, int frameCount, ma_uint32 sampleRate, float frameTime)
+{
+    /*
+    Draws the frameCount new samples of window into xytexture. frameTime is how long
+    the previous picture was on screen, the phosphor fades out over it. With the software
+    backend xytexture may be NULL, the picture is in opt->software.pixels either way.
+    */
+
+    // Without persistence the trace is redrawn from scratch. Only do that when there
+    // are more than 0 frames to paint pixels/lines on. If we don't check for frameCount,
+    // `handle_draw` will not paint anything at this frame and this will look like
+    // "flickering". With persistence the old trace simply keeps fading out.
+    if (frameCount == 0 && !opt->persistence)
+        return;
+
+    // Fraction of the energy left after this frame, 0 clears the trace.
+    float decay = opt->persistence ? exp2f(-frameTime / opt->half_life) : 0.0f;
+
+    // Merged samples carry the energy of every sample they stand for, folded ones of every period.
+    beam_t beam = beam_for(opt->render_width, opt->render_height, sampleRate);
+    beam.energy *= window->merged * window->repeats;
+
+    if (opt->backend == BACKEND_SOFTWARE)
+    {
+        // No GL at all, offline there is no xytexture and the pixels are written out as they are.
+        FORBID_ALLOCATIONS();
+        draw_software(&opt->software, window, &opt->traces, opt->interpolation, &beam, decay, opt->exposure, BACKGROUND_COLOR, FOREGROUND_COLOR);
+        ALLOW_ALLOCATIONS();
+        if (xytexture != NULL)
+            UpdateTexture(xytexture->texture, opt->software.pixels);
+        return;
+    }
+
+    // Draw the points on buffer.
+    begin_phosphor(&opt->phosphor, decay);
+
+    if (opt->backend == BACKEND_SHADER)
+    {
+        // Only the raw samples are uploaded, interpolation happens in the vertex shader.
+        draw_trace_shader(&opt->trace_shader, window, &opt->traces, opt->interpolation, &beam);
+    }
+    else
+    {
+        // Every frame can add up to `interpolation` quads to the batch for every trace
+        trace_batch_reserve(&opt->trace_batch, opt->traces.count * frameCount * opt->interpolation * TRACE_VERTICES_PER_QUAD);
+
+        // All the traces go into the same batch, so it is still drawn with one draw call.
+        FORBID_ALLOCATIONS();
+        for (int trace = 0; trace < opt->traces.count; trace++)
+        {
+            const float *xs = window->plane[2 * trace];
+            const float *ys = window->plane[2 * trace + 1];
+            int z_plane = opt->traces.z_planes[trace];
+            const float *zs = z_plane >= 0 ? window->plane[z_plane] : NULL;
+            Rectangle viewport = opt->traces.viewports[trace];
+
+            Vector2 p0 = {0}, p1 = {0}, p2 = {0}, p3 = {0}; // positions at times n, n-1, n-2 and n-3
+
+            for (int i = 0; i < window->count; i++)
+            {
+                p3 = p2;
+                p2 = p1;
+                p1 = p0;
+
+                p0.x = viewport.x + clamp((xs[i] + 1.0f) / 2.0f, 0.0f, 1.0f) * viewport.width;
+                p0.y = viewport.y + clamp((ys[i] + 1.0f) / 2.0f, 0.0f, 1.0f) * viewport.height;
+
+                // The history samples were already drawn by the previous frame,
+                // they are only here to fill in p1..p3.
+                if (i < WINDOW_HISTORY)
+                    continue;
+
+                // The curve is drawn as bright as the middle of it, blanked curves not at all.
+                float brightness = 1.0f;
+                if (zs != NULL)
+                    brightness = clamp((zs[i - 2] + zs[i - 1]) / 2.0f, 0.0f, 1.0f);
+                if (brightness <= 0.0f)
+                    continue;
+
+                // Only the end points of the pieces are generated here, how much of the
+                // energy lands on which pixel is worked out on the GPU.
+                trace_batch_push_bezier(&opt->trace_batch, p3, p0, p1, p2, opt->interpolation, beam.energy * brightness);
+            }
+        }
+        ALLOW_ALLOCATIONS();
+
+        draw_trace_batch(&opt->trace_batch, &beam);
+    }
+
+    end_phosphor(&opt->phosphor, xytexture, opt->exposure, BACKGROUND_COLOR, FOREGROUND_COLOR);
+}
+
+// User interface
+void draw_menu(opt_t *opt)
+{
+    int x = (10 * opt->screen_width) / 100;
+    int y = (10 * opt->screen_height) / 100;
+    int w = (80 * opt->screen_width) / 100;
+    int last_text_y = 0;
+    ZONE_BEGIN(zone, "draw_menu");
+
+    DrawText("Shortcuts (Press m to toggle)", x + 10, y + 10, 10, FOREGROUND_COLOR);
+    DrawLine(x, y + 30, x + w, y + 30, FOREGROUND_COLOR);
+    DrawText(opt->play_path != NULL ? "Playing" : opt->net_config.address != NULL ? "Receiving" : "Select input", x + 10, y + 40, 10, FOREGROUND_COLOR);
+    DrawLine(x + 10, y + 55, x + w - 10, y + 55, FOREGROUND_COLOR);
+
+    if (opt->net_config.address != NULL)
+    {
+        // There are no inputs to choose from either, only how the stream is doing.
+        DrawText(opt->menu_net, x + 10, y + 65, 9, FOREGROUND_COLOR);
+        DrawText(opt->menu_status[0], x + 10, y + 80, 9, FOREGROUND_COLOR);
+        last_text_y = y + 80;
+    }
+    else if (opt->play_path != NULL)
+    {
+        // There are no inputs to choose from while playing a file.
+        DrawText(opt->play_path, x + 10, y + 65, 9, FOREGROUND_COLOR);
+        last_text_y = y + 65;
+
+        if (opt->playback.mapping != NULL)
+        {
+            // Where the playback is in the file, as a bar across the menu as well that follows it
+            // on every frame.
+            double position = (double)atomic_load_explicit(&opt->buffer_store.played, memory_order_relaxed) / opt->buffer_store.capacity;
+            DrawText(opt->menu_status[0], x + 10, y + 80, 10, FOREGROUND_COLOR);
+            DrawLine(x + 10, y + 95, x + 10 + (int)((w - 20) * position), y + 95, FOREGROUND_COLOR);
+            last_text_y = y + 85;
+        }
+        if (opt->overview.nodes != NULL)
+        {
+            DrawText(opt->menu_status[1], x + 10, y + 100, 10, FOREGROUND_COLOR);
+            last_text_y = y + 100;
+        }
+    }
+    else
+    {
+        // Never enumerates devices itself, that happens on the device cache thread.
+        const device_list_t *devices = device_cache_snapshot(&opt->device_cache);
+
+        for (ma_uint32 iDevice = 0; iDevice < devices->count; iDevice += 1)
+        {
+            DrawText(devices->lines[iDevice], x + 10, y + 65 + iDevice * 15, 9, FOREGROUND_COLOR);
+            last_text_y = y + 65 + iDevice * 15;
+        }
+    }
+
+    DrawLine(x + 10, last_text_y + 20, x + w - 10, last_text_y + 20, FOREGROUND_COLOR);
+    DrawText(opt->menu_backend, x + 10, last_text_y + 25, 10, FOREGROUND_COLOR);
+    DrawText(opt->menu_interpolation, x + 10, last_text_y + 40, 10, FOREGROUND_COLOR);
+    DrawText(opt->menu_phosphor, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_layout, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_lod, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_trigger, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_analysis, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_resolution, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText(opt->menu_sync, x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    last_text_y += 15;
+    DrawText("Esc - Exit", x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+
+    int status = atomic_load(&opt->capture.status);
+    if (status != CAPTURE_RUNNING)
+    {
+        last_text_y += 15;
+        DrawText(status == CAPTURE_SWITCHING ? "Opening input..." : "Could not open that input",
+                 x + 10, last_text_y + 55, 10, FOREGROUND_COLOR);
+    }
+
+    int h = last_text_y + 70 - y;
+
+    /* Draw a rectangle from 0.1->0.9 of screen */
+    DrawRectangleLines(x, y, w, h, FOREGROUND_COLOR);
+    ZONE_END(zone);
+}
+
+void update_menu_text(opt_t *opt)
+{
+    /*
+    Formats the menu entries that depend on the options. Call it whenever one of them changes
+    instead of formatting them on every frame.
+    */
+    if (opt->backend == BACKEND_SOFTWARE)
+        snprintf(opt->menu_backend, MENU_LINE_SIZE, "b - Draw in software on the CPU");
+    else
+        snprintf(opt->menu_backend, MENU_LINE_SIZE, "b - Interpolate on the %s", opt->backend == BACKEND_SHADER ? "GPU" : "CPU");
+    snprintf(opt->menu_interpolation, MENU_LINE_SIZE, "[ ] - Interpolation (%d)", opt->interpolation);
+    if (opt->persistence)
+        snprintf(opt->menu_phosphor, MENU_LINE_SIZE, "p - Phosphor persistence (%.0f ms half-life)", opt->half_life * 1000.0f);
+    else
+        snprintf(opt->menu_phosphor, MENU_LINE_SIZE, "p - Phosphor persistence (off)");
+    snprintf(opt->menu_layout, MENU_LINE_SIZE, "t - %s (%d traces)",
+             opt->traces.layout == LAYOUT_SPLIT ? "Traces side by side" : "Traces on top of each other", opt->traces.count);
+    if (opt->lod.enabled)
+        snprintf(opt->menu_lod, MENU_LINE_SIZE, "l - Level of detail (within %.1f ms)", opt->lod.budget * 1000.0f);
+    else
+        snprintf(opt->menu_lod, MENU_LINE_SIZE, "l - Level of detail (off)");
+    snprintf(opt->menu_trigger, MENU_LINE_SIZE, "r - Lock repeating figures (%s)", opt->trigger.enabled ? "on" : "off");
+    snprintf(opt->menu_analysis, MENU_LINE_SIZE, "a - Spectrum, goniometer and correlation (%s)", opt->analysis_shown ? "on" : "off");
+    if (opt->resolution.dynamic)
+        snprintf(opt->menu_resolution, MENU_LINE_SIZE, "v - Dynamic resolution (%dx%d, within %.1f ms)",
+                 opt->render_width, opt->render_height, opt->resolution.budget * 1000.0f);
+    else
+        snprintf(opt->menu_resolution, MENU_LINE_SIZE, "v - Dynamic resolution (off, %dx%d)", opt->render_width, opt->render_height);
+    if (opt->sync == SYNC_FIXED)
+        snprintf(opt->menu_sync, MENU_LINE_SIZE, "s - Statistics (capped at %d fps)", opt->fps);
+    else
+        snprintf(opt->menu_sync, MENU_LINE_SIZE, "s - Statistics (%s)", opt->sync == SYNC_VSYNC ? "vsync" : "uncapped");
+
+    const net_config_t *config = &opt->net_config;
+    if (config->address != NULL && config->rtp)
+        snprintf(opt->menu_net, MENU_LINE_SIZE, "udp://%s, RTP %s, %u channels at %u Hz, %.0f ms jitter buffer", config->address,
+                 config->format.format == ma_format_s16 ? "L16" : "L24", config->format.channels, config->format.sample_rate, config->jitter * 1000.0f);
+    else if (config->address != NULL)
+        snprintf(opt->menu_net, MENU_LINE_SIZE, "udp://%s, raw %s, %u channels at %u Hz", config->address,
+                 ma_get_format_name(config->format.format), config->format.channels, config->format.sample_rate);
+
+    // The entries that change on their own follow the options right away as well.
+    opt->menu_status_time = 0.0;
+}
+
+void update_menu_status(opt_t *opt, double now)
+{
+    /*
+    Formats the menu entries that change while nothing is pressed: the packet counters of
+    --udp, the position in the file and how far the overview is. At most every
+    MENU_STATUS_SECONDS, which is as often as anyone can read them, so draw_menu never formats.
+    */
+    if (now - opt->menu_status_time < MENU_STATUS_SECONDS)
+        return;
+    opt->menu_status_time = now;
+
+    if (opt->net_config.address != NULL)
+    {
+        snprintf(opt->menu_status[0], MENU_LINE_SIZE, "%llu packets, %llu frames lost, %llu late, %llu ignored",
+                 (unsigned long long)atomic_load_explicit(&opt->net.packets, memory_order_relaxed),
+                 (unsigned long long)atomic_load_explicit(&opt->net.lost, memory_order_relaxed),
+                 (unsigned long long)atomic_load_explicit(&opt->net.late, memory_order_relaxed),
+                 (unsigned long long)atomic_load_explicit(&opt->net.ignored, memory_order_relaxed));
+        return;
+    }
+    if (opt->play_path == NULL)
+        return;
+
+    if (opt->playback.mapping != NULL)
+    {
+        double rate = opt->buffer_store.format.sample_rate;
+        double position = atomic_load_explicit(&opt->buffer_store.played, memory_order_relaxed) / rate;
+        double total = opt->buffer_store.capacity / rate;
+        snprintf(opt->menu_status[0], MENU_LINE_SIZE, "%d:%04.1f / %d:%04.1f - Left/Right to seek %.0f s, drag to scrub",
+                 (int)(position / 60), fmod(position, 60.0), (int)(total / 60), fmod(total, 60.0), SEEK_SECONDS);
+    }
+    if (opt->overview.nodes != NULL)
+    {
+        if (!atomic_load(&opt->overview.ready))
+            snprintf(opt->menu_status[1], MENU_LINE_SIZE, "- = - Zoom out and in (building the overview, %d%%)",
+                     100 * atomic_load(&opt->overview.done_blocks) / opt->overview.blocks);
+        else if (opt->overview.seconds > 0.0)
+            snprintf(opt->menu_status[1], MENU_LINE_SIZE, "- = - Zoom out and in (%.0f s at once)", opt->overview.seconds);
+        else
+            snprintf(opt->menu_status[1], MENU_LINE_SIZE, "- = - Zoom out and in (every sample)");
+    }
+}
+
+// Offline rendering
+int render_file(opt_t *opt)
+{
+    /*
+    Decodes opt->render_path and draws it exactly like a capture, with opt->fps worth of
+    samples per frame, into a hidden window. Every frame is read back and written to
+    opt->output_path as Y4M, which ffmpeg reads from a pipe:
+
+        ./rxyo -r rxyo.wav | ffmpeg -i - rxyo.mp4
+
+    With more than one job the file is split between worker processes, see
+    render_file_parallel. Returns 0 on success.
+    */
+    int to_stdout = opt->output_path == NULL || strcmp(opt->output_path, "-") == 0;
+    FILE *output = to_stdout ? stdout : fopen(opt->output_path, "wb");
+    if (output == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not open %s", opt->output_path);
+        return -1;
+    }
+    // raylib logs to stdout, which is taken by the video now.
+    if (to_stdout)
+        SetTraceLogCallback(log_to_stderr);
+
+    int result = -1;
+    render_t render;
+    if (opt->jobs > 1)
+    {
+        // The parent only needs the length of the file, it never opens a window.
+        ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32, trace_map_channels(&opt->traces), 0);
+        if (ma_decoder_init_file(opt->render_path, &decoder_config, &render.decoder) != MA_SUCCESS)
+        {
+            TraceLog(LOG_ERROR, "Could not decode %s", opt->render_path);
+            goto done;
+        }
+        ma_uint32 sample_rate = render.decoder.outputSampleRate;
+        ma_uint64 length = 0;
+        ma_decoder_get_length_in_pcm_frames(&render.decoder, &length);
+        ma_decoder_uninit(&render.decoder);
+
+        if (length > 0)
+        {
+            result = render_file_parallel(opt, output, sample_rate, length);
+            goto done;
+        }
+        TraceLog(LOG_WARNING, "The length of %s is unknown, rendering it in one go", opt->render_path);
+    }
+
+    if (open_render(opt, &render) == 0)
+    {
+        write_y4m_header(output, opt->screen_width, opt->screen_height, opt->fps);
+        if (render_segment(opt, &render, output, 0, UINT64_MAX) >= 0)
+            result = ferror(output) ? -1 : 0;
+        close_render(opt, &render);
+    }
+
+done:
+    if (to_stdout)
+        fflush(output);
+    else
+        fclose(output);
+
+    return result;
+}
+
+int render_file_parallel(opt_t *opt, FILE *output, ma_uint32 sampleRate, ma_uint64 length)
+{
+    /*
+    Splits the video into segments of RENDER_SEGMENT_SECONDS and deals them out to opt->jobs
+    forked workers, which write each one to its own file in a temporary directory. The
+    segments are copied to the output in order as soon as they are done, and deleted. Workers
+    are kept at most a couple of rounds ahead of the output, which bounds the disk space used.
+    Returns 0 on success.
+    */
+    ma_uint64 video_frames = (length * opt->fps + sampleRate - 1) / sampleRate;
+    ma_uint64 segment_frames = (ma_uint64)RENDER_SEGMENT_SECONDS * opt->fps;
+    ma_uint64 segments = (video_frames + segment_frames - 1) / segment_frames;
+    int jobs = (ma_uint64)opt->jobs < segments ? opt->jobs : (int)segments;
+
+    char directory[256];
+    const char *tmp = getenv("TMPDIR");
+    snprintf(directory, sizeof(directory), "%s/rxyo-XXXXXX", tmp != NULL ? tmp : "/tmp");
+    if (mkdtemp(directory) == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not create a temporary directory");
+        return -1;
+    }
+
+    unsigned char *done = calloc(segments, 1);
+    render_worker_t workers[MAX_JOBS];
+    int started = 0;
+    int result = -1;
+
+    if (done == NULL)
+        goto cleanup;
+
+    // Nothing buffered may be written twice by the children. A worker that died must
+    // show up as a failed write to its pipe, not kill us.
+    fflush(stdout);
+    fflush(stderr);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (; started < jobs; started++)
+    {
+        int commands[2], results[2];
+        if (pipe(commands) != 0)
+            goto cleanup;
+        if (pipe(results) != 0)
+        {
+            close(commands[0]);
+            close(commands[1]);
+            goto cleanup;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // Only keep our own ends of our own pipes.
+            for (int i = 0; i < started; i++)
+            {
+                close(workers[i].commands);
+                close(workers[i].results);
+            }
+            close(commands[1]);
+            close(results[0]);
+            render_worker(opt, commands[0], results[1], directory);
+            _exit(0);
+        }
+
+        close(commands[0]);
+        close(results[1]);
+        if (pid < 0)
+        {
+            close(commands[1]);
+            close(results[0]);
+            goto cleanup;
+        }
+        workers[started] = (render_worker_t){pid, commands[1], results[0], -1};
+    }
+
+    write_y4m_header(output, opt->screen_width, opt->screen_height, opt->fps);
+
+    ma_uint64 next_segment = 0; // Next one to hand out
+    ma_uint64 next_output = 0;  // Next one to copy to the output
+    while (next_output < segments)
+    {
+        // Hand out work, but don't let the workers get too far ahead of the output.
+        for (int i = 0; i < jobs; i++)
+        {
+            if (workers[i].segment >= 0 || next_segment >= segments || next_segment >= next_output + 2 * jobs)
+                continue;
+            if (write(workers[i].commands, &next_segment, sizeof(next_segment)) != sizeof(next_segment))
+                goto cleanup;
+            workers[i].segment = (ma_int64)next_segment++;
+        }
+
+        struct pollfd fds[MAX_JOBS];
+        for (int i = 0; i < jobs; i++)
+            fds[i] = (struct pollfd){workers[i].results, POLLIN, 0};
+        if (poll(fds, jobs, -1) < 0)
+            goto cleanup;
+
+        for (int i = 0; i < jobs; i++)
+        {
+            if (fds[i].revents == 0)
+                continue;
+
+            // A worker that died closes its pipe, which reads as 0 bytes.
+            ma_int64 answer;
+            if (read(workers[i].results, &answer, sizeof(answer)) != sizeof(answer) || answer != workers[i].segment)
+            {
+                TraceLog(LOG_ERROR, "A render worker failed");
+                goto cleanup;
+            }
+            done[answer] = TRUE;
+            workers[i].segment = -1;
+        }
+
+        while (next_output < segments && done[next_output])
+        {
+            if (copy_segment(directory, next_output, output) != 0)
+                goto cleanup;
+            next_output++;
+        }
+        TraceLog(LOG_INFO, "Rendered %.0f%%", 100.0 * next_output / segments);
+    }
+    result = ferror(output) ? -1 : 0;
+
+cleanup:
+    // Closing the commands tells idle workers to exit, busy ones are stopped on failure.
+    for (int i = 0; i < started; i++)
+    {
+        close(workers[i].commands);
+        close(workers[i].results);
+        if (result != 0)
+            kill(workers[i].pid, SIGTERM);
+        waitpid(workers[i].pid, NULL, 0);
+    }
+    for (ma_uint64 i = 0; result != 0 && done != NULL && i < segments; i++)
+    {
+        char path[320];
+        snprintf(path, sizeof(path), "%s/%llu", directory, (unsigned long long)i);
+        unlink(path);
+    }
+    rmdir(directory);
+    free(done);
+
+    return result;
+}
+
+void render_worker(opt_t *opt, int commands, int results, const char *directory)
+{
+    /*
+    Body of a worker process: renders every segment it's told to until the parent closes
+    `commands`. Answers with the segment once it is complete, or not at all if it failed.
+    */
+    render_t render;
+    if (open_render(opt, &render) != 0)
+        return;
+
+    ma_uint64 segment;
+    ma_uint64 segment_frames = (ma_uint64)RENDER_SEGMENT_SECONDS * opt->fps;
+    while (read(commands, &segment, sizeof(segment)) == sizeof(segment))
+    {
+        char path[320];
+        snprintf(path, sizeof(path), "%s/%llu", directory, (unsigned long long)segment);
+        FILE *file = fopen(path, "wb");
+        if (file == NULL)
+            break;
+
+        int written = render_segment(opt, &render, file, segment * segment_frames, (segment + 1) * segment_frames);
+        if (fclose(file) != 0 || written < 0)
+            break;
+        if (write(results, &segment, sizeof(segment)) != sizeof(segment))
+            break;
+    }
+
+    close_render(opt, &render);
+}
+
+int copy_segment(const char *directory, ma_uint64 segment, FILE *output)
+{
+    /*
+    Appends a finished segment to the output and deletes it. Returns 0 on success.
+    */
+    char path[320];
+    snprintf(path, sizeof(path), "%s/%llu", directory, (unsigned long long)segment);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+
+    static char buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        fwrite(buffer, 1, count, output);
+
+    fclose(file);
+    unlink(path);
+    return ferror(output) ? -1 : 0;
+}
+
+int open_render(opt_t *opt, render_t *render)
+{
+    /*
+    Opens the decoder and a hidden window with everything render_trace draws with, or just
+    the software rasterizer. Returns 0 on success, nothing needs to be closed otherwise.
+    */
+    memset(render, 0, sizeof(*render));
+
+    // Float with the channels the traces need whatever the file is, at the rate of the file so
+    // nothing is resampled.
+    ma_uint32 channels = trace_map_channels(&opt->traces);
+    ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32, channels, 0);
+    if (ma_decoder_init_file(opt->render_path, &decoder_config, &render->decoder) != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not decode %s", opt->render_path);
+        return -1;
+    }
+    render->sample_rate = render->decoder.outputSampleRate;
+    render->format.format = ma_format_f32;
+    render->format.channels = channels;
+    render->format.sample_rate = render->sample_rate;
+    render->format.frame_bytes = ma_get_bytes_per_frame(ma_format_f32, channels);
+    ma_decoder_get_length_in_pcm_frames(&render->decoder, &render->length);
+
+    // Frames of video are cut at sample positions, so they hold one more sample at most.
+    int frame_samples = (int)(render->sample_rate / opt->fps + 1);
+    render->frames = malloc(frame_samples * render->format.frame_bytes);
+    render->planes = malloc(3 * opt->screen_width * opt->screen_height);
+
+    // The software backend needs no window, so it renders on machines without a GPU.
+    // The cores are shared between the jobs.
+    if (opt->backend == BACKEND_SOFTWARE)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        int threads = cores > opt->jobs ? (int)(cores / opt->jobs) : 1;
+        if (render->frames == NULL || render->planes == NULL ||
+            init_sample_window(&opt->window, opt->traces.count, opt->traces.planes, frame_samples) != 0 ||
+            init_software(&opt->software, opt->screen_width, opt->screen_height, threads) != 0)
+        {
+            close_render(opt, render);
+            return -1;
+        }
+        return 0;
+    }
+
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(opt->screen_width, opt->screen_height, "Simple XY");
+    opt->xytexture = LoadRenderTexture(opt->screen_width, opt->screen_height);
+
+    if (render->frames == NULL || render->planes == NULL ||
+        init_sample_window(&opt->window, opt->traces.count, opt->traces.planes, frame_samples) != 0 ||
+        init_trace_batch(&opt->trace_batch) != 0 ||
+        init_phosphor(&opt->phosphor, opt->screen_width, opt->screen_height) != 0)
+    {
+        close_render(opt, render);
+        return -1;
+    }
+    if (init_trace_shader(&opt->trace_shader, opt->window.planes, opt->window.plane_size) != 0 && opt->backend == BACKEND_SHADER)
+    {
+        TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+        opt->backend = BACKEND_BATCHED;
+    }
+
+    return 0;
+}
+
+void close_render(opt_t *opt, render_t *render)
+{
+    free(render->planes);
+    free(render->frames);
+    unload_sample_window(&opt->window);
+    if (opt->backend == BACKEND_SOFTWARE)
+    {
+        unload_software(&opt->software);
+    }
+    else
+    {
+        unload_phosphor(&opt->phosphor);
+        unload_trace_shader(&opt->trace_shader);
+        unload_trace_batch(&opt->trace_batch);
+        UnloadRenderTexture(opt->xytexture);
+        CloseWindow();
+    }
+    ma_decoder_uninit(&render->decoder);
+}
+
+int render_segment(opt_t *opt, render_t *render, FILE *output, ma_uint64 firstFrame, ma_uint64 endFrame)
+{
+    /*
+    Writes the frames of video from firstFrame up to endFrame (or the end of the file) to output.
+    Rendering starts a few frames early, without writing them, so the phosphor, the
+    sample window and the trigger look exactly as if everything before had been rendered too.
+    Returns the number of frames written, -1 on failure.
+    */
+    ma_uint64 warmup = 1; // The sample window carries samples over from the previous frame
+    if (opt->persistence)
+        warmup += (ma_uint64)ceilf(WARMUP_HALF_LIVES * opt->half_life * opt->fps);
+    if (opt->trigger.enabled)
+        warmup += (ma_uint64)ceil((double)TRIGGER_SIZE * opt->fps / render->sample_rate);
+    ma_uint64 start = firstFrame > warmup ? firstFrame - warmup : 0;
+
+    // Frames of video are cut at exact sample positions so no sample is drawn twice or skipped.
+    ma_uint64 position = start * render->sample_rate / opt->fps;
+    if (ma_decoder_seek_to_pcm_frame(&render->decoder, position) != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not seek in %s", opt->render_path);
+        return -1;
+    }
+    if (opt->backend == BACKEND_SOFTWARE)
+        reset_software(&opt->software);
+    else
+        reset_phosphor(&opt->phosphor);
+    opt->window.count = 0;
+    // Nor does the period, a worker may have rendered another segment before.
+    opt->trigger.filled = 0;
+    opt->trigger.period = 0.0;
+
+    int written = 0;
+    for (ma_uint64 video_frame = start; video_frame < endFrame; video_frame++)
+    {
+        ma_uint64 end = (video_frame + 1) * render->sample_rate / opt->fps;
+        ma_uint64 read = 0;
+        if (ma_decoder_read_pcm_frames(&render->decoder, render->frames, end - position, &read) != MA_SUCCESS || read == 0)
+            break;
+        position += read;
+
+        begin_sample_window(&opt->window, opt->backend == BACKEND_SHADER ? trace_shader_stream(&opt->trace_shader) : NULL);
+        float *planes[MAX_PLANES];
+        for (int plane = 0; plane < opt->window.planes; plane++)
+            planes[plane] = opt->window.plane[plane] + WINDOW_HISTORY;
+        convert_frames(&render->format, render->frames, (ma_uint32)read, &opt->traces, planes);
+        end_sample_window(&opt->window, (int)read);
+        int drawn = trigger_fold(&opt->trigger, &opt->window, (int)read);
+
+        if (opt->backend == BACKEND_SOFTWARE)
+        {
+            render_trace(opt, &opt->window, NULL, drawn, render->sample_rate, 1.0f / opt->fps);
+            if (video_frame < firstFrame)
+                continue;
+            write_y4m_frame(output, opt->software.pixels, opt->screen_width, opt->screen_height, render->planes);
+        }
+        else
+        {
+            render_trace(opt, &opt->window, &opt->xytexture, drawn, render->sample_rate, 1.0f / opt->fps);
+            if (video_frame < firstFrame)
+                continue;
+
+            ZONE_BEGIN(zone, "read_back");
+            Image image = LoadImageFromTexture(opt->xytexture.texture);
+            write_y4m_frame(output, image.data, image.width, image.height, render->planes);
+            UnloadImage(image);
+            ZONE_END(zone);
+        }
+        written++;
+
+        if (opt->jobs == 1 && render->length > 0 && video_frame % opt->fps == 0)
+            TraceLog(LOG_INFO, "Rendered %.0f%%", 100.0 * position / render->length);
+    }
+
+    return ferror(output) ? -1 : written;
+}
+
+void write_y4m_header(FILE *file, int width, int height, int fps)
+{
+    // 4:4:4 so the thin trace keeps its colors, ffmpeg subsamples it if asked to.
+    fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps);
+}
+
+void write_y4m_frame(FILE *file, const unsigned char *rgba, int width, int height, unsigned char *planes)
+{
+    /*
+    Converts one RGBA picture to limited range BT.601 Y'CbCr, which is what Y4M
+    readers assume, into `planes` (3 * width * height bytes) and writes it out.
+    */
+    int size = width * height;
+
+    for (int row = 0; row < height; row++)
+    {
+        // Same orientation as on screen, where xytexture is drawn without flipping it.
+        const unsigned char *pixel = rgba + (size_t)row * width * 4;
+        for (int column = 0; column < width; column++, pixel += 4)
+        {
+            int r = pixel[0], g = pixel[1], b = pixel[2];
+            int i = row * width + column;
+            planes[i] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            planes[size + i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            planes[2 * size + i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    fputs("FRAME\n", file);
+    fwrite(planes, 1, 3 * size, file);
+}
+
+void log_to_stderr(int logLevel, const char *text, va_list args)
+{
+    (void)logLevel;
+    vfprintf(stderr, text, args);
+    fputc('\n', stderr);
+}
+
+// Playback
+int play_file(opt_t *opt)
+{
+    /*
+    Plays opt->play_path on the default playback device and draws it in a window until the
+    file is over or the window is closed, a mapped file only until the window is closed since
+    it can still be sought back into. Returns 0 on success.
+    */
+    if (init_buffer_store(&opt->buffer_store, ring_seconds(opt), trace_map_channels(&opt->traces)) != 0)
+        return -1;
+    if (init_playback(&opt->playback, &opt->buffer_store, opt->play_path) != 0)
+    {
+        uninit_buffer_store(&opt->buffer_store);
+        return -1;
+    }
+    init_frame_clock(&opt->frame_clock, opt->buffer_store.format.sample_rate);
+    opt->playback_scrub = PLAY_NO_SEEK;
+
+    // A frame can take everything a decoded file has in the ring, a mapped one has all of
+    // the file in it but still only plays that far ahead.
+    ma_uint32 window = (ma_uint32)ceilf(opt->buffer_store.seconds * opt->buffer_store.format.sample_rate);
+    if (window > opt->buffer_store.capacity)
+        window = opt->buffer_store.capacity;
+    if (init_sample_window(&opt->window, opt->traces.count, opt->traces.planes, window) != 0)
+    {
+        uninit_playback(&opt->playback);
+        uninit_buffer_store(&opt->buffer_store);
+        return -1;
+    }
+
+    if (opt->sync == SYNC_VSYNC)
+        SetConfigFlags(FLAG_VSYNC_HINT);
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    if (opt->headless)
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(opt->screen_width, opt->screen_height, "Simple XY");
+
+    int result = -1;
+    if (init_trace_batch(&opt->trace_batch) != 0 || init_render_targets(opt) != 0)
+        goto done;
+    if (init_trace_shader(&opt->trace_shader, opt->window.planes, opt->window.plane_size) != 0 && opt->backend == BACKEND_SHADER)
+    {
+        TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+        opt->backend = BACKEND_BATCHED;
+    }
+    if (init_stats(&opt->stats, opt->stats_path) != 0)
+        TraceLog(LOG_WARNING, "Could not open %s for the statistics", opt->stats_path);
+    if (opt->share_name != NULL && init_share(&opt->share, opt->share_name, opt->render_width, opt->render_height) != 0)
+        TraceLog(LOG_WARNING, "Not sharing the frames");
+    update_menu_text(opt);
+    SetTargetFPS(opt->sync == SYNC_FIXED ? opt->fps : 0);
+
+    // Builds in the background, until then zooming out shows nothing new.
+    if (opt->playback.mapping != NULL && init_overview(&opt->overview, &opt->buffer_store, &opt->traces, opt->play_path) != 0)
+        TraceLog(LOG_WARNING, "No overview of %s", opt->play_path);
+    if (init_analysis(&opt->analysis, &opt->buffer_store, &opt->traces, opt->analysis_shown) != 0)
+        TraceLog(LOG_WARNING, "No spectrum, goniometer and correlation");
+
+    // Only now, so the sound starts with the picture.
+    if (start_playback(&opt->playback) != 0)
+        goto done;
+
+    while (!WindowShouldClose() && opt->should_exit != TRUE && !playback_finished(&opt->playback))
+    {
+        handle_keyboard(opt);
+
+        int timed = opt->stats.shown || opt->stats.csv != NULL;
+        double cpu_start = timed ? thread_cpu_seconds() : 0.0;
+        handle_draw(opt, &opt->buffer_store, &opt->xytexture);
+        if (timed)
+            opt->stats.draw_cpu += thread_cpu_seconds() - cpu_start;
+
+        stats_update(&opt->stats, &opt->buffer_store, atomic_load_explicit(&opt->playback.callback_ns, memory_order_relaxed),
+                     atomic_load_explicit(&opt->playback.underruns, memory_order_relaxed), monotonic_seconds());
+    }
+    result = 0;
+
+done:
+    // Nothing may read from the ring any more once it is freed.
+    uninit_overview(&opt->overview);
+    uninit_analysis(&opt->analysis);
+    uninit_playback(&opt->playback);
+    uninit_stats(&opt->stats);
+    uninit_share(&opt->share);
+    uninit_lod(&opt->lod);
+    unload_software(&opt->software);
+    unload_phosphor(&opt->phosphor);
+    unload_trace_shader(&opt->trace_shader);
+    unload_trace_batch(&opt->trace_batch);
+    UnloadRenderTexture(opt->xytexture);
+    CloseWindow();
+    unload_sample_window(&opt->window);
+    uninit_buffer_store(&opt->buffer_store);
+
+    return result;
+}
+
+int init_playback(playback_t *playback, buffer_store_t *buffer_store, const char *path)
+{
+    /*
+    Opens the file and the default playback device in the format of the file, sizes the ring
+    for the latency of the device and decodes as much of the file as fits, or maps all of it
+    into the ring when it is a WAV file in a format the ring can hold. Nothing plays until
+    start_playback. Returns 0 on success, nothing needs to be uninitialized otherwise.
+    */
+    memset(playback, 0, sizeof(*playback));
+    playback->buffer_store = buffer_store;
+    atomic_init(&playback->running, FALSE);
+    atomic_init(&playback->decoded, FALSE);
+    atomic_init(&playback->seek, PLAY_NO_SEEK);
+    atomic_init(&playback->callback_ns, 0);
+    atomic_init(&playback->underruns, 0);
+
+    // Every channel of the file is played, the traces pick theirs out of them.
+    ring_format_t format;
+    unsigned char *mapped_frames = NULL;
+    ma_uint64 mapped_count = 0;
+    if (playback_map_wav(playback, path, &format, &mapped_frames, &mapped_count) != 0)
+    {
+        ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32, 0, 0);
+        if (ma_decoder_init_file(path, &decoder_config, &playback->decoder) != MA_SUCCESS)
+        {
+            TraceLog(LOG_ERROR, "Could not decode %s", path);
+            return -1;
+        }
+        format.format = ma_format_f32;
+        format.channels = playback->decoder.outputChannels;
+        format.sample_rate = playback->decoder.outputSampleRate;
+        format.frame_bytes = ma_get_bytes_per_frame(format.format, format.channels);
+    }
+    ma_uint32 channels = format.channels;
+    ma_uint32 sample_rate = format.sample_rate;
+
+    // The ring holds frames in the format of the device, it gets them just as they are.
+    ma_device_config config = ma_device_config_init(ma_device_type_playback);
+    config.playback.format = format.format;
+    config.playback.channels = channels;
+    config.sampleRate = sample_rate;
+    config.dataCallback = playback_callback;
+    config.pUserData = playback;
+    if (ma_device_init(NULL, &config, &playback->device) != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not open the playback device");
+        if (playback->mapping != NULL)
+            munmap(playback->mapping, playback->mapping_size);
+        else
+            ma_decoder_uninit(&playback->decoder);
+        return -1;
+    }
+
+    // Whatever the device buffers is still to be heard when the callback returns.
+    playback->latency = (double)playback->device.playback.internalPeriodSizeInFrames * playback->device.playback.internalPeriods /
+                        playback->device.playback.internalSampleRate;
+    TraceLog(LOG_INFO, "Playing %s, %u channels at %u Hz, %.1f ms of device latency", path, channels, sample_rate, playback->latency * 1000.0);
+    buffer_store->seconds += (float)playback->latency;
+
+    if (playback->mapping != NULL)
+    {
+        // Nothing to decode, the whole file is already in the ring.
+        buffer_store_attach(buffer_store, mapped_frames, (ma_uint32)mapped_count, &format);
+        buffer_store->playing = TRUE;
+        atomic_store(&playback->decoded, TRUE);
+        return 0;
+    }
+
+    // The frames still in the device are long gone from the ring, but the decoder keeps
+    // that far ahead of the playback on top of what the ring holds otherwise.
+    playback->frames = malloc((size_t)PLAY_CHUNK * ma_get_bytes_per_frame(ma_format_f32, channels));
+    if (playback->frames == NULL || buffer_store_set_format(buffer_store, ma_format_f32, channels, sample_rate) != 0)
+    {
+        free(playback->frames);
+        ma_device_uninit(&playback->device);
+        ma_decoder_uninit(&playback->decoder);
+        return -1;
+    }
+    buffer_store->playing = TRUE;
+
+    if (!playback_decode(playback))
+        atomic_store(&playback->decoded, TRUE);
+
+    return 0;
+}
+
+void uninit_playback(playback_t *playback)
+{
+    /*
+    Stops the device and the decoder thread, or unmaps the file. Nothing may read from the
+    ring after that.
+    */
+    ma_device_uninit(&playback->device);
+    if (playback->started)
+    {
+        atomic_store(&playback->running, FALSE);
+        pthread_join(playback->thread, NULL);
+        playback->started = FALSE;
+    }
+    if (playback->mapping != NULL)
+        munmap(playback->mapping, playback->mapping_size);
+    else
+        ma_decoder_uninit(&playback->decoder);
+    playback->mapping = NULL;
+    free(playback->frames);
+    playback->frames = NULL;
+}
+
+int playback_map_wav(playback_t *playback, const char *path, ring_format_t *format, unsigned char **frames, ma_uint64 *frameCount)
+{
+    /*
+    Maps path into playback->mapping if it is a RIFF or RF64 WAV file of 8, 16, 24 or 32 bit
+    integer or 32 bit float samples, and points frames at the first of its frameCount frames.
+    Returns 0 on success, -1 for any file that has to go through the decoder instead.
+    */
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12)
+    {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return -1;
+    const unsigned char *bytes = mapping;
+
+    int rf64 = memcmp(bytes, "RF64", 4) == 0 || memcmp(bytes, "BW64", 4) == 0;
+    if ((memcmp(bytes, "RIFF", 4) != 0 && !rf64) || memcmp(bytes + 8, "WAVE", 4) != 0)
+    {
+        munmap(mapping, size);
+        return -1;
+    }
+
+    // Walk the chunks up to the samples. RF64 keeps the 64 bit size of the data chunk in ds64.
+    int tag = 0, channels = 0, bits = 0, block_align = 0;
+    ma_uint32 sample_rate = 0;
+    ma_uint64 data_size64 = 0, data_offset = 0, data_size = 0;
+    size_t offset = 12;
+    while (offset + 8 <= size)
+    {
+        const unsigned char *chunk = bytes + offset;
+        ma_uint64 chunk_size = read_le(chunk + 4, 4);
+        size_t body = offset + 8;
+
+        if (memcmp(chunk, "ds64", 4) == 0 && chunk_size >= 16 && body + 16 <= size)
+            data_size64 = read_le(bytes + body + 8, 8);
+        else if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && body + 16 <= size)
+        {
+            tag = (int)read_le(bytes + body, 2);
+            channels = (int)read_le(bytes + body + 2, 2);
+            sample_rate = (ma_uint32)read_le(bytes + body + 4, 4);
+            block_align = (int)read_le(bytes + body + 12, 2);
+            bits = (int)read_le(bytes + body + 14, 2);
+            // WAVE_FORMAT_EXTENSIBLE, the real tag starts the sub-format GUID.
+            if (tag == 0xFFFE && chunk_size >= 40 && body + 40 <= size)
+                tag = (int)read_le(bytes + body + 24, 2);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            data_offset = body;
+            data_size = rf64 && chunk_size == 0xFFFFFFFF ? data_size64 : chunk_size;
+            break;
+        }
+        offset = body + chunk_size + (chunk_size & 1);
+    }
+
+    ma_format sample_format = ma_format_unknown;
+    if (tag == 1 && bits == 8)
+        sample_format = ma_format_u8;
+    else if (tag == 1 && bits == 16)
+        sample_format = ma_format_s16;
+    else if (tag == 1 && bits == 24)
+        sample_format = ma_format_s24;
+    else if (tag == 1 && bits == 32)
+        sample_format = ma_format_s32;
+    else if (tag == 3 && bits == 32)
+        sample_format = ma_format_f32;
+
+    // A recording still being written may say it has more than is there.
+    if (data_offset > 0 && data_size > size - data_offset)
+        data_size = size - data_offset;
+    ma_uint64 count = block_align > 0 ? data_size / block_align : 0;
+    if (sample_format == ma_format_unknown || channels == 0 || sample_rate == 0 || block_align != channels * bits / 8 ||
+        count == 0 || count > UINT32_MAX || ((bits == 16 || bits == 32) && data_offset % (bits / 8) != 0))
+    {
+        munmap(mapping, size);
+        return -1;
+    }
+
+    // Playing reads ahead on its own, a seek asks for the kernel to catch up, see playback_seek.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    format->format = sample_format;
+    format->channels = (ma_uint32)channels;
+    format->sample_rate = sample_rate;
+    format->frame_bytes = (ma_uint32)block_align;
+    playback->mapping = mapping;
+    playback->mapping_size = size;
+    *frames = (unsigned char *)mapping + data_offset;
+    *frameCount = count;
+
+    TraceLog(LOG_INFO, "Mapped %llu frames of %s", (unsigned long long)count, path);
+    return 0;
+}
+
+void playback_seek(playback_t *playback, ma_uint64 frame)
+{
+    /*
+    From the render thread: the playback callback jumps to frame of a mapped file on its next
+    period, the end of the file at most. Decoded files can't seek.
+    */
+    buffer_store_t *buffer_store = playback->buffer_store;
+    if (playback->mapping == NULL)
+    {
+        TraceLog(LOG_WARNING, "Only WAV files that can be mapped can be sought through");
+        return;
+    }
+    if (frame > buffer_store->capacity)
+        frame = buffer_store->capacity;
+
+    // The callback would otherwise fault the pages in one by one, waiting on the disk each time.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = (size_t)(buffer_store->buf - (unsigned char *)playback->mapping) + (size_t)frame * buffer_store->format.frame_bytes;
+    size_t length = (size_t)(SEEK_READAHEAD_SECONDS * buffer_store->format.sample_rate) * buffer_store->format.frame_bytes;
+    start -= start % page;
+    if (start < playback->mapping_size)
+    {
+        if (length > playback->mapping_size - start)
+            length = playback->mapping_size - start;
+        madvise((unsigned char *)playback->mapping + start, length, MADV_WILLNEED);
+    }
+
+    atomic_store_explicit(&playback->seek, frame, memory_order_release);
+}
+
+int start_playback(playback_t *playback)
+{
+    /*
+    Starts decoding the rest of the file in the background and playing it. Returns 0 on success.
+    */
+    atomic_store(&playback->running, TRUE);
+    if (playback->mapping == NULL)
+    {
+        if (pthread_create(&playback->thread, NULL, playback_thread, playback) != 0)
+        {
+            TraceLog(LOG_ERROR, "Could not start the decoder thread");
+            return -1;
+        }
+        playback->started = TRUE;
+    }
+
+    if (ma_device_start(&playback->device) != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not start the playback device");
+        return -1;
+    }
+    return 0;
+}
+
+int playback_finished(playback_t *playback)
+{
+    /*
+    TRUE once the whole file was played and drawn. Never for a mapped file, it can still be
+    sought back into.
+    */
+    buffer_store_t *buffer_store = playback->buffer_store;
+    if (playback->mapping != NULL)
+        return FALSE;
+    ma_uint64 head = atomic_load_explicit(&buffer_store->head, memory_order_acquire);
+    return atomic_load(&playback->decoded) &&
+           atomic_load_explicit(&buffer_store->played, memory_order_acquire) == head &&
+           atomic_load_explicit(&buffer_store->tail, memory_order_relaxed) == head;
+}
+
+int playback_decode(playback_t *playback)
+{
+    /*
+    Decodes the file into the ring until the ring is full. Returns FALSE once the end of the
+    file went in.
+    */
+    buffer_store_t *buffer_store = playback->buffer_store;
+    ma_uint32 space;
+    while ((space = buffer_store_space(buffer_store)) > 0)
+    {
+        ma_uint64 read = 0;
+        ma_uint32 count = space < PLAY_CHUNK ? space : PLAY_CHUNK;
+        if (ma_decoder_read_pcm_frames(&playback->decoder, playback->frames, count, &read) != MA_SUCCESS || read == 0)
+            return FALSE;
+        buffer_store_write(buffer_store, playback->frames, (ma_uint32)read);
+        if (read < count)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+void *playback_thread(void *arg)
+{
+    /*
+    Keeps the ring full until the whole file is in it. Decoding never happens in the callback.
+    */
+    playback_t *playback = (playback_t *)arg;
+    struct timespec idle = {0, (long)(PLAY_IDLE_SECONDS * 1e9)};
+
+    while (atomic_load(&playback->running) && !atomic_load(&playback->decoded))
+    {
+        if (!playback_decode(playback))
+            atomic_store(&playback->decoded, TRUE);
+        else
+            nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+void playback_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+{
+    /*
+    Copies the next frames of the ring to the device and stamps the first of them with when it
+    will be heard. miniaudio hands us a silent buffer, so whatever the ring can't fill stays silent.
+    */
+    (void)pInput;
+    FORBID_ALLOCATIONS();
+    double now = monotonic_seconds();
+    playback_t *playback = (playback_t *)pDevice->pUserData;
+    buffer_store_t *buffer_store = playback->buffer_store;
+    ZONE_BEGIN(zone, "playback_callback");
+
+    // Only this thread moves `played`, so seeking happens here. The stamp of the jump tells
+    // the render thread to follow.
+    ma_uint64 seek = atomic_exchange_explicit(&playback->seek, PLAY_NO_SEEK, memory_order_acquire);
+    if (seek != PLAY_NO_SEEK)
+    {
+        atomic_store_explicit(&buffer_store->played, seek, memory_order_relaxed);
+        playback->seeked = TRUE;
+    }
+
+    ma_uint64 frame = atomic_load_explicit(&buffer_store->played, memory_order_relaxed);
+    ma_uint32 played = buffer_store_play(buffer_store, pOutput, frameCount);
+    if (played < frameCount && !atomic_load(&playback->decoded))
+        atomic_fetch_add_explicit(&playback->underruns, 1, memory_order_relaxed);
+    // The next stamp that makes it into the queue carries the jump, if this one doesn't.
+    if (played > 0 || playback->seeked)
+        if (buffer_store_stamp_frame(buffer_store, frame, now + playback->latency, playback->seeked))
+            playback->seeked = FALSE;
+    ZONE_END(zone);
+
+    ma_uint64 ns = (ma_uint64)((monotonic_seconds() - now) * 1e9);
+    atomic_fetch_add_explicit(&playback->callback_ns, ns, memory_order_relaxed);
+    ALLOW_ALLOCATIONS();
+}
+
+// Overview
+int init_overview(overview_t *overview, buffer_store_t *buffer_store, const trace_map_t *map, const char *path)
+{
+    /*
+    Allocates the pyramid for the mapped file in buffer_store and starts building it in the
+    background. map has to outlive the overview. Returns 0 on success, nothing needs to be
+    uninitialized otherwise.
+    */
+    memset(overview, 0, sizeof(*overview));
+    overview->buffer_store = buffer_store;
+    overview->map = map;
+    overview->block_frames = (ma_uint32)ceil(OVERVIEW_BLOCK_SECONDS * buffer_store->format.sample_rate);
+    overview->blocks = (int)((buffer_store->capacity + overview->block_frames - 1) / overview->block_frames);
+    overview->node_size = (size_t)map->count * OVERVIEW_BINS * OVERVIEW_BINS;
+    atomic_init(&overview->next_block, 0);
+    atomic_init(&overview->done_blocks, 0);
+    atomic_init(&overview->running, TRUE);
+    atomic_init(&overview->ready, FALSE);
+
+    // Every level has half the nodes of the one below, rounded up, until one covers everything.
+    size_t nodes = 0;
+    size_t count = (size_t)overview->blocks;
+    while (overview->levels < OVERVIEW_LEVELS)
+    {
+        overview->level_nodes[overview->levels++] = nodes;
+        nodes += count;
+        if (count == 1)
+            break;
+        count = (count + 1) / 2;
+    }
+
+    overview->nodes = calloc(nodes * overview->node_size, sizeof(float));
+    overview->sum = malloc(overview->node_size * sizeof(float));
+    overview->pixels = malloc((size_t)OVERVIEW_BINS * OVERVIEW_BINS * 4);
+    if (overview->nodes == NULL || overview->sum == NULL || overview->pixels == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not allocate %zu histograms for the overview", nodes);
+        free(overview->nodes);
+        free(overview->sum);
+        free(overview->pixels);
+        overview->nodes = NULL;
+        return -1;
+    }
+
+    // The cache is only good for this very file, binned into these traces.
+    struct stat st;
+    overview_header_t *header = &overview->header;
+    memcpy(header->magic, OVERVIEW_MAGIC, sizeof(header->magic));
+    if (stat(path, &st) == 0)
+    {
+        header->file_size = (ma_uint64)st.st_size;
+        header->file_mtime = (ma_int64)st.st_mtime;
+    }
+    header->block_frames = overview->block_frames;
+    header->blocks = (ma_uint32)overview->blocks;
+    header->bins = OVERVIEW_BINS;
+    header->traces = (ma_uint32)map->count;
+    for (int plane = 0; plane < map->planes; plane++)
+        header->channels[plane] = map->channels[plane];
+    for (int trace = 0; trace < map->count; trace++)
+        header->z_planes[trace] = map->z_planes[trace];
+    snprintf(overview->cache_path, sizeof(overview->cache_path), "%s.rxyo-overview", path);
+
+    if (pthread_create(&overview->thread, NULL, overview_thread, overview) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not start building the overview");
+        free(overview->nodes);
+        free(overview->sum);
+        free(overview->pixels);
+        overview->nodes = NULL;
+        return -1;
+    }
+    overview->started = TRUE;
+    return 0;
+}
+
+void uninit_overview(overview_t *overview)
+{
+    /*
+    Stops building the overview if it is not done yet and frees it. Before the file is unmapped.
+    */
+    if (overview->started)
+    {
+        atomic_store(&overview->running, FALSE);
+        pthread_join(overview->thread, NULL);
+        overview->started = FALSE;
+    }
+    for (int trace = 0; trace < MAX_TRACES; trace++)
+    {
+        if (overview->textures[trace].id != 0)
+            UnloadTexture(overview->textures[trace]);
+        overview->textures[trace].id = 0;
+    }
+    free(overview->nodes);
+    free(overview->sum);
+    free(overview->pixels);
+    overview->nodes = NULL;
+    overview->sum = NULL;
+    overview->pixels = NULL;
+    overview->seconds = 0.0;
+}
+
+void *overview_thread(void *arg)
+{
+    /*
+    Fills in level 0 from the cache, or bins it on every core and caches it, then builds the
+    levels above.
+    */
+    overview_t *overview = (overview_t *)arg;
+    double start = monotonic_seconds();
+
+    int cached = overview_load(overview) == 0;
+    if (!cached)
+    {
+        // This thread works on the blocks as well, the helpers just take some of them.
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        overview->worker_count = cores > 2 ? (int)cores - 2 : 0;
+        if (overview->worker_count > MAX_OVERVIEW_THREADS)
+            overview->worker_count = MAX_OVERVIEW_THREADS;
+        for (int i = 0; i < overview->worker_count; i++)
+            if (pthread_create(&overview->workers[i], NULL, overview_worker, overview) != 0)
+                overview->worker_count = i;
+        overview_worker(overview);
+        for (int i = 0; i < overview->worker_count; i++)
+            pthread_join(overview->workers[i], NULL);
+    }
+    if (!atomic_load(&overview->running))
+        return NULL;
+
+    overview_build_levels(overview);
+    if (!cached && overview_save(overview) != 0)
+        TraceLog(LOG_INFO, "Could not cache the overview in %s", overview->cache_path);
+
+    TraceLog(LOG_INFO, "Overview of %d blocks %s in %.0f ms", overview->blocks, cached ? "loaded" : "built",
+             (monotonic_seconds() - start) * 1000.0);
+    atomic_store_explicit(&overview->ready, TRUE, memory_order_release);
+    return NULL;
+}
+
+void *overview_worker(void *arg)
+{
+    /*
+    Bins blocks until there are none left. Every block is taken by exactly one worker.
+    */
+    overview_t *overview = (overview_t *)arg;
+    int block;
+    while (atomic_load_explicit(&overview->running, memory_order_relaxed) &&
+           (block = atomic_fetch_add(&overview->next_block, 1)) < overview->blocks)
+    {
+        overview_bin_block(overview, block);
+        atomic_fetch_add_explicit(&overview->done_blocks, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+void overview_bin_block(overview_t *overview, int block)
+{
+    /*
+    Bins the samples of one block into its histograms of level 0, converted from the mapping
+    a chunk at a time exactly like they are for drawing.
+    */
+    buffer_store_t *buffer_store = overview->buffer_store;
+    const trace_map_t *map = overview->map;
+    float *bins = overview_node(overview, 0, (size_t)block);
+
+    float chunk[MAX_PLANES][OVERVIEW_CHUNK];
+    float *planes[MAX_PLANES];
+    for (int plane = 0; plane < map->planes; plane++)
+        planes[plane] = chunk[plane];
+
+    ma_uint64 first = (ma_uint64)block * overview->block_frames;
+    ma_uint64 end = first + overview->block_frames;
+    if (end > buffer_store->capacity)
+        end = buffer_store->capacity;
+    for (ma_uint64 frame = first; frame < end; frame += OVERVIEW_CHUNK)
+    {
+        ma_uint32 count = end - frame < OVERVIEW_CHUNK ? (ma_uint32)(end - frame) : OVERVIEW_CHUNK;
+        convert_frames(&buffer_store->format, buffer_store->buf + (size_t)frame * buffer_store->format.frame_bytes, count, map, planes);
+
+        for (int trace = 0; trace < map->count; trace++)
+        {
+            const float *xs = planes[2 * trace];
+            const float *ys = planes[2 * trace + 1];
+            const float *zs = map->z_planes[trace] >= 0 ? planes[map->z_planes[trace]] : NULL;
+            float *histogram = bins + (size_t)trace * OVERVIEW_BINS * OVERVIEW_BINS;
+
+            // Same place and brightness as the beam, minus the interpolation between samples.
+            for (ma_uint32 i = 0; i < count; i++)
+            {
+                int bx = (int)(clamp((xs[i] + 1.0f) / 2.0f, 0.0f, 1.0f) * (OVERVIEW_BINS - 1) + 0.5f);
+                int by = (int)(clamp((ys[i] + 1.0f) / 2.0f, 0.0f, 1.0f) * (OVERVIEW_BINS - 1) + 0.5f);
+                histogram[by * OVERVIEW_BINS + bx] += zs != NULL ? clamp(zs[i], 0.0f, 1.0f) : 1.0f;
+            }
+        }
+    }
+}
+
+void overview_build_levels(overview_t *overview)
+{
+    /*
+    Sums every pair of nodes into the node above them, an odd one out is copied up alone.
+    */
+    for (int level = 1; level < overview->levels; level++)
+    {
+        size_t below = overview->level_nodes[level] - overview->level_nodes[level - 1];
+        size_t count = (below + 1) / 2;
+        for (size_t index = 0; index < count; index++)
+        {
+            float *node = overview_node(overview, level, index);
+            const float *left = overview_node(overview, level - 1, 2 * index);
+            memcpy(node, left, overview->node_size * sizeof(float));
+            if (2 * index + 1 < below)
+            {
+                const float *right = overview_node(overview, level - 1, 2 * index + 1);
+                for (size_t bin = 0; bin < overview->node_size; bin++)
+                    node[bin] += right[bin];
+            }
+        }
+    }
+}
+
+int overview_load(overview_t *overview)
+{
+    /*
+    Reads level 0 from the cache file if there is one for exactly this file and these traces.
+    Returns 0 on success.
+    */
+    FILE *file = fopen(overview->cache_path, "rb");
+    if (file == NULL)
+        return -1;
+
+    overview_header_t header;
+    size_t bins = (size_t)overview->blocks * overview->node_size;
+    int result = -1;
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(&header, &overview->header, sizeof(header)) == 0 &&
+        fread(overview->nodes, sizeof(float), bins, file) == bins)
+        result = 0;
+    fclose(file);
+    return result;
+}
+
+int overview_save(overview_t *overview)
+{
+    /*
+    Writes the header and level 0 to the cache file, the levels above are quick to build again.
+    Written elsewhere first, so no one ever reads half a cache. Returns 0 on success.
+    */
+    char temporary[PATH_MAX + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", overview->cache_path);
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+        return -1;
+
+    size_t bins = (size_t)overview->blocks * overview->node_size;
+    int written = fwrite(&overview->header, sizeof(overview->header), 1, file) == 1 &&
+                  fwrite(overview->nodes, sizeof(float), bins, file) == bins;
+    if (fclose(file) != 0 || !written || rename(temporary, overview->cache_path) != 0)
+    {
+        remove(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+float *overview_node(overview_t *overview, int level, size_t index)
+{
+    /*
+    The histograms of every trace for node index of level.
+    */
+    return overview->nodes + (overview->level_nodes[level] + index) * overview->node_size;
+}
+
+void overview_zoom(overview_t *overview, int out)
+{
+    /*
+    Doubles or halves how much of the file is shown at once, from every sample over
+    OVERVIEW_MIN_SECONDS up to the whole file.
+    */
+    buffer_store_t *buffer_store = overview->buffer_store;
+    double length = (double)buffer_store->capacity / buffer_store->format.sample_rate;
+    if (out)
+        overview->seconds = fmin(overview->seconds == 0.0 ? OVERVIEW_MIN_SECONDS : overview->seconds * 2.0, length);
+    else
+        overview->seconds = overview->seconds / 2.0 < OVERVIEW_MIN_SECONDS ? 0.0 : overview->seconds / 2.0;
+}
+
+void draw_overview(overview_t *overview, RenderTexture2D *xytexture, ma_uint64 frame, float frameTime, float exposure,
+                   int width, int height, Color background, Color foreground)
+{
+    /*
+    Draws overview->seconds of the file around frame into xytexture. It is as bright as the
+    trace would be on average over that time, without persistence: every sample deposits
+    1 / sampleRate of energy into its bin and the sum is spread over the frames it would take.
+    */
+    const trace_map_t *map = overview->map;
+    buffer_store_t *buffer_store = overview->buffer_store;
+
+    // Whole blocks around frame, as many as fit in the length shown.
+    int count = (int)ceil(overview->seconds * buffer_store->format.sample_rate / overview->block_frames);
+    if (count > overview->blocks)
+        count = overview->blocks;
+    if (count < 1)
+        count = 1;
+    int first = (int)(frame / overview->block_frames) - count / 2;
+    if (first > overview->blocks - count)
+        first = overview->blocks - count;
+    if (first < 0)
+        first = 0;
+
+    // At most two nodes of every level add up to the range, from the bottom up.
+    memset(overview->sum, 0, overview->node_size * sizeof(float));
+    size_t lo = (size_t)first, hi = (size_t)(first + count);
+    for (int level = 0; level < overview->levels && lo < hi; level++, lo /= 2, hi /= 2)
+    {
+        const float *nodes[2] = {NULL, NULL};
+        if (lo & 1)
+            nodes[0] = overview_node(overview, level, lo++);
+        if (hi & 1)
+            nodes[1] = overview_node(overview, level, --hi);
+        for (int n = 0; n < 2; n++)
+            if (nodes[n] != NULL)
+                for (size_t bin = 0; bin < overview->node_size; bin++)
+                    overview->sum[bin] += nodes[n][bin];
+    }
+
+    ma_uint64 end = (ma_uint64)(first + count) * overview->block_frames;
+    if (end > buffer_store->capacity)
+        end = buffer_store->capacity;
+    double frames = (double)(end - (ma_uint64)first * overview->block_frames);
+    float scale = (float)(width < height ? width : height);
+
+    // Overlaid traces share their bins, so they saturate together like the beam does.
+    int overlay = map->layout == LAYOUT_OVERLAY;
+    if (overlay)
+        for (int trace = 1; trace < map->count; trace++)
+            for (size_t bin = 0; bin < (size_t)OVERVIEW_BINS * OVERVIEW_BINS; bin++)
+                overview->sum[bin] += overview->sum[(size_t)trace * OVERVIEW_BINS * OVERVIEW_BINS + bin];
+
+    BeginTextureMode(*xytexture);
+    ClearBackground(background);
+    for (int trace = 0; trace < (overlay ? 1 : map->count); trace++)
+    {
+        // Energy per unit of normalized area, see beam_t, of one frame's share of the range.
+        Rectangle viewport = map->viewports[trace];
+        double area = (double)viewport.width * viewport.height / ((double)OVERVIEW_BINS * OVERVIEW_BINS * scale * scale);
+        float energy = (float)(frameTime / (frames * area));
+        const float *histogram = overview->sum + (size_t)trace * OVERVIEW_BINS * OVERVIEW_BINS;
+
+        // Tone mapped like display_fragment_shader.
+        for (int bin = 0; bin < OVERVIEW_BINS * OVERVIEW_BINS; bin++)
+        {
+            float brightness = 1.0f - expf(-exposure * energy * histogram[bin]);
+            unsigned char *pixel = overview->pixels + 4 * bin;
+            pixel[0] = (unsigned char)(background.r + (foreground.r - background.r) * brightness + 0.5f);
+            pixel[1] = (unsigned char)(background.g + (foreground.g - background.g) * brightness + 0.5f);
+            pixel[2] = (unsigned char)(background.b + (foreground.b - background.b) * brightness + 0.5f);
+            pixel[3] = (unsigned char)(background.a + (foreground.a - background.a) * brightness + 0.5f);
+        }
+
+        if (overview->textures[trace].id == 0)
+        {
+            Image image = {overview->pixels, OVERVIEW_BINS, OVERVIEW_BINS, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+            overview->textures[trace] = LoadTextureFromImage(image);
+            SetTextureFilter(overview->textures[trace], TEXTURE_FILTER_BILINEAR);
+        }
+        else
+            UpdateTexture(overview->textures[trace], overview->pixels);
+
+        // Row 0 holds the lowest y, which the trace draws at the top of its viewport as well.
+        DrawTexturePro(overview->textures[trace], (Rectangle){0, 0, OVERVIEW_BINS, OVERVIEW_BINS}, viewport,
+                       (Vector2){0, 0}, 0.0f, WHITE);
+    }
+    EndTextureMode();
+}
+
+// Network input
+int listen_network(opt_t *opt)
+{
+    /*
+    Draws what arrives over UDP at opt->net_config.address in a window until it is closed,
+    instead of capturing. The ring is fed by the receiver thread of net_t, everything after
+    that is the same as drawing a capture. Returns 0 on success.
+    */
+    if (init_buffer_store(&opt->buffer_store, ring_seconds(opt), trace_map_channels(&opt->traces)) != 0)
+        return -1;
+    if (init_net(&opt->net, &opt->buffer_store, &opt->net_config) != 0)
+    {
+        uninit_buffer_store(&opt->buffer_store);
+        return -1;
+    }
+    init_frame_clock(&opt->frame_clock, opt->buffer_store.format.sample_rate);
+
+    // A frame can take everything in the ring.
+    if (init_sample_window(&opt->window, opt->traces.count, opt->traces.planes, opt->buffer_store.capacity) != 0)
+    {
+        uninit_net(&opt->net);
+        uninit_buffer_store(&opt->buffer_store);
+        return -1;
+    }
+
+    if (opt->sync == SYNC_VSYNC)
+        SetConfigFlags(FLAG_VSYNC_HINT);
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    if (opt->headless)
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(opt->screen_width, opt->screen_height, "Simple XY");
+
+    int result = -1;
+    if (init_trace_batch(&opt->trace_batch) != 0 || init_render_targets(opt) != 0)
+        goto done;
+    if (init_trace_shader(&opt->trace_shader, opt->window.planes, opt->window.plane_size) != 0 && opt->backend == BACKEND_SHADER)
+    {
+        TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+        opt->backend = BACKEND_BATCHED;
+    }
+    if (init_stats(&opt->stats, opt->stats_path) != 0)
+        TraceLog(LOG_WARNING, "Could not open %s for the statistics", opt->stats_path);
+    if (opt->share_name != NULL && init_share(&opt->share, opt->share_name, opt->render_width, opt->render_height) != 0)
+        TraceLog(LOG_WARNING, "Not sharing the frames");
+    update_menu_text(opt);
+    SetTargetFPS(opt->sync == SYNC_FIXED ? opt->fps : 0);
+
+    if (init_analysis(&opt->analysis, &opt->buffer_store, &opt->traces, opt->analysis_shown) != 0)
+        TraceLog(LOG_WARNING, "No spectrum, goniometer and correlation");
+
+    if (start_net(&opt->net) != 0)
+        goto done;
+
+    while (!WindowShouldClose() && opt->should_exit != TRUE)
+    {
+        handle_keyboard(opt);
+
+        int timed = opt->stats.shown || opt->stats.csv != NULL;
+        double cpu_start = timed ? thread_cpu_seconds() : 0.0;
+        handle_draw(opt, &opt->buffer_store, &opt->xytexture);
+        if (timed)
+            opt->stats.draw_cpu += thread_cpu_seconds() - cpu_start;
+
+        stats_update(&opt->stats, &opt->buffer_store, atomic_load_explicit(&opt->net.callback_ns, memory_order_relaxed),
+                     atomic_load_explicit(&opt->net.dropped_periods, memory_order_relaxed), monotonic_seconds());
+    }
+    result = 0;
+
+done:
+    // Nothing may read from the ring any more once it is freed.
+    uninit_analysis(&opt->analysis);
+    uninit_net(&opt->net);
+    uninit_stats(&opt->stats);
+    uninit_share(&opt->share);
+    uninit_lod(&opt->lod);
+    unload_software(&opt->software);
+    unload_phosphor(&opt->phosphor);
+    unload_trace_shader(&opt->trace_shader);
+    unload_trace_batch(&opt->trace_batch);
+    UnloadRenderTexture(opt->xytexture);
+    CloseWindow();
+    unload_sample_window(&opt->window);
+    uninit_buffer_store(&opt->buffer_store);
+
+    return result;
+}
+
+int parse_net_format(net_config_t *config, const char *value)
+{
+    /*
+    Parses FORMAT:CHANNELS:RATE, where FORMAT is L16 or L24 for RTP and s16, s24, s32 or f32
+    for raw PCM. Returns 0 on success, config is left as it was otherwise.
+    */
+    char name[8];
+    int channels = 0, rate = 0;
+    if (sscanf(value, "%7[^:]:%d:%d", name, &channels, &rate) != 3 || channels < 1 || channels > RING_MAX_CHANNELS || rate <= 0)
+        return -1;
+
+    // L16 and L24 are the same samples as s16 and s24, only big-endian.
+    static const struct
+    {
+        const char *name;
+        int rtp;
+        ma_format format;
+    } formats[] = {
+        {"L16", TRUE, ma_format_s16},
+        {"L24", TRUE, ma_format_s24},
+        {"s16", FALSE, ma_format_s16},
+        {"s24", FALSE, ma_format_s24},
+        {"s32", FALSE, ma_format_s32},
+        {"f32", FALSE, ma_format_f32},
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+    {
+        if (strcmp(name, formats[i].name) == 0)
+        {
+            config->rtp = formats[i].rtp;
+            config->format.format = formats[i].format;
+            config->format.channels = (ma_uint32)channels;
+            config->format.sample_rate = (ma_uint32)rate;
+            config->format.frame_bytes = ma_get_bytes_per_frame(formats[i].format, (ma_uint32)channels);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int init_net(net_t *net, buffer_store_t *buffer_store, const net_config_t *config)
+{
+    /*
+    Opens the socket, joining the group if the address is a multicast one, and sets the ring
+    to the format of the stream. Nothing is received until start_net. Returns 0 on success,
+    nothing needs to be uninitialized otherwise.
+    */
+    memset(net, 0, sizeof(*net));
+    net->buffer_store = buffer_store;
+    net->config = *config;
+    net->socket = -1;
+    atomic_init(&net->running, FALSE);
+    atomic_init(&net->callback_ns, 0);
+    atomic_init(&net->dropped_periods, 0);
+    atomic_init(&net->packets, 0);
+    atomic_init(&net->lost, 0);
+    atomic_init(&net->late, 0);
+    atomic_init(&net->ignored, 0);
+
+    // PORT on its own listens on every interface.
+    char host[64] = "";
+    const char *port = strrchr(config->address, ':');
+    if (port != NULL)
+    {
+        size_t length = (size_t)(port - config->address);
+        if (length >= sizeof(host))
+            length = sizeof(host) - 1;
+        memcpy(host, config->address, length);
+        host[length] = '\0';
+        port++;
+    }
+    else
+        port = config->address;
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((unsigned short)atoi(port));
+    if (atoi(port) <= 0 || atoi(port) > 65535 || (host[0] != '\0' && inet_pton(AF_INET, host, &local.sin_addr) != 1))
+    {
+        TraceLog(LOG_ERROR, "Can not listen on %s, expected [ADDRESS:]PORT", config->address);
+        return -1;
+    }
+    int multicast = IN_MULTICAST(ntohl(local.sin_addr.s_addr));
+
+    // Any number of renderers on the same machine can listen to the same group.
+    int yes = 1;
+    int buffer = NET_SOCKET_BUFFER;
+    struct timeval timeout = {0, (suseconds_t)(NET_IDLE_SECONDS * 1e6)};
+    net->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (net->socket < 0 ||
+        setsockopt(net->socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) != 0 ||
+        setsockopt(net->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+        bind(net->socket, (struct sockaddr *)&local, sizeof(local)) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not listen on %s: %s", config->address, strerror(errno));
+        uninit_net(net);
+        return -1;
+    }
+    // The kernel may cap it lower, then bursts are dropped sooner.
+    setsockopt(net->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    if (multicast)
+    {
+        struct ip_mreq group;
+        group.imr_multiaddr = local.sin_addr;
+        group.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(net->socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) != 0)
+        {
+            TraceLog(LOG_ERROR, "Could not join %s: %s", host, strerror(errno));
+            uninit_net(net);
+            return -1;
+        }
+    }
+
+    // The ring holds the frames just as a raw packet has them, RTP payloads are swapped to
+    // little-endian on the way into the jitter buffer.
+    ring_format_t format = config->format;
+    net->packet = malloc((size_t)NET_BATCH * NET_PACKET_SIZE);
+    if (net->packet == NULL || buffer_store_set_format(buffer_store, format.format, format.channels, format.sample_rate) != 0)
+    {
+        uninit_net(net);
+        return -1;
+    }
+#if defined(NET_MMSG)
+    for (int i = 0; i < NET_BATCH; i++)
+    {
+        net->vectors[i].iov_base = net->packet + (size_t)i * NET_PACKET_SIZE;
+        net->vectors[i].iov_len = NET_PACKET_SIZE;
+        net->messages[i].msg_hdr.msg_iov = &net->vectors[i];
+        net->messages[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    // Room for the jitter and a whole batch of the largest packets on top of it, so a batch
+    // never has to push frames out before their time.
+    if (config->rtp)
+    {
+        net->jitter_frames = (ma_uint32)ceilf(config->jitter * format.sample_rate);
+        ma_uint32 frames = net->jitter_frames + NET_BATCH * (NET_PACKET_SIZE / format.frame_bytes);
+        net->capacity = 1;
+        while (net->capacity < frames)
+            net->capacity <<= 1;
+        net->frames = calloc(net->capacity, format.frame_bytes);
+        net->filled = calloc(net->capacity, 1);
+        if (net->frames == NULL || net->filled == NULL)
+        {
+            TraceLog(LOG_ERROR, "Could not allocate %u frames for the jitter buffer", net->capacity);
+            uninit_net(net);
+            return -1;
+        }
+    }
+
+    TraceLog(LOG_INFO, "Listening on %s%s for %s, %u channels at %u Hz", config->address, multicast ? " (multicast)" : "",
+             config->rtp ? "RTP" : "raw PCM", format.channels, format.sample_rate);
+    return 0;
+}
+
+void uninit_net(net_t *net)
+{
+    /*
+    Stops the receiver thread and closes the socket. Nothing writes to the ring after that.
+    */
+    if (net->started)
+    {
+        atomic_store(&net->running, FALSE);
+        pthread_join(net->thread, NULL);
+        net->started = FALSE;
+    }
+    if (net->socket >= 0)
+        close(net->socket);
+    net->socket = -1;
+    free(net->packet);
+    free(net->frames);
+    free(net->filled);
+    net->packet = NULL;
+    net->frames = NULL;
+    net->filled = NULL;
+}
+
+int start_net(net_t *net)
+{
+    /*
+    Starts receiving into the ring. Returns 0 on success.
+    */
+    atomic_store(&net->running, TRUE);
+    if (pthread_create(&net->thread, NULL, net_thread, net) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not start the network thread");
+        return -1;
+    }
+    net->started = TRUE;
+    return 0;
+}
+
+void *net_thread(void *arg)
+{
+    /*
+    Takes everything that is waiting on the socket at once, with one recvmmsg where there is
+    one, and passes the packets to the ring or the jitter buffer. Waits at most
+    NET_IDLE_SECONDS for the first one, so it notices when it has to stop.
+    */
+    net_t *net = (net_t *)arg;
+    while (atomic_load(&net->running))
+    {
+#if defined(NET_MMSG)
+        int count = recvmmsg(net->socket, net->messages, NET_BATCH, MSG_WAITFORONE, NULL);
+#else
+        ssize_t size = recv(net->socket, net->packet, NET_PACKET_SIZE, 0);
+        int count = size >= 0 ? 1 : -1;
+#endif
+        if (count <= 0)
+            continue;
+
+        FORBID_ALLOCATIONS();
+        double now = monotonic_seconds(); // As close to the arrival of the batch as we get
+        ZONE_BEGIN(zone, "net_receive");
+        for (int i = 0; i < count; i++)
+        {
+#if defined(NET_MMSG)
+            int size = (int)net->messages[i].msg_len;
+#endif
+            net_receive(net, net->packet + (size_t)i * NET_PACKET_SIZE, (int)size, now);
+        }
+        atomic_fetch_add_explicit(&net->packets, (ma_uint64)count, memory_order_relaxed);
+
+        // Everything that has waited out the jitter goes into the ring.
+        if (net->config.rtp && net->locked && net->newest - net->next > net->jitter_frames)
+            net_release(net, net->newest - net->jitter_frames, now);
+        else if (!net->config.rtp)
+            buffer_store_stamp(net->buffer_store, now);
+        ZONE_END(zone);
+
+        ma_uint64 ns = (ma_uint64)((monotonic_seconds() - now) * 1e9);
+        atomic_fetch_add_explicit(&net->callback_ns, ns, memory_order_relaxed);
+        ALLOW_ALLOCATIONS();
+    }
+    return NULL;
+}
+
+void net_receive(net_t *net, const unsigned char *packet, int size, double now)
+{
+    /*
+    Writes a raw packet to the ring, or puts the payload of an RTP packet into the jitter
+    buffer where its timestamp says, see net_t.
+    */
+    ma_uint32 frame_bytes = net->config.format.frame_bytes;
+    if (!net->config.rtp)
+    {
+        // A datagram cut short by NET_PACKET_SIZE still has its first frames.
+        if (size < (int)frame_bytes)
+        {
+            atomic_fetch_add_explicit(&net->ignored, 1, memory_order_relaxed);
+            return;
+        }
+        ma_uint32 count = (ma_uint32)size / frame_bytes;
+        if (buffer_store_write(net->buffer_store, packet, count) < count)
+            atomic_fetch_add_explicit(&net->dropped_periods, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Version 2, then the contributing sources, a header extension and padding may follow.
+    int header = 12;
+    if (size >= header && (packet[0] >> 6) == 2)
+    {
+        header += 4 * (packet[0] & 0x0f);
+        if ((packet[0] & 0x10) && size >= header + 4)
+            header += 4 + 4 * (int)read_be(packet + header + 2, 2);
+        if (packet[0] & 0x20)
+            size -= packet[size - 1];
+    }
+    else
+        size = 0;
+    if (size < header + (int)frame_bytes)
+    {
+        atomic_fetch_add_explicit(&net->ignored, 1, memory_order_relaxed);
+        return;
+    }
+    ma_uint32 timestamp = (ma_uint32)read_be(packet + 4, 4);
+    ma_uint32 ssrc = (ma_uint32)read_be(packet + 8, 4);
+
+    // Follows one source, another one only takes over once it has been quiet for a while.
+    if (!net->locked || (ssrc != net->ssrc && now - net->source_time > NET_RESYNC_SECONDS))
+        net_resync(net, ssrc, timestamp);
+    else if (ssrc != net->ssrc)
+    {
+        atomic_fetch_add_explicit(&net->ignored, 1, memory_order_relaxed);
+        return;
+    }
+    net->source_time = now;
+
+    // The timestamps wrap every 2^32 frames, a day at 48 kHz, they are taken as the nearest
+    // frame to the newest one that matches. A sender that restarted is followed right away.
+    ma_uint64 resync = (ma_uint64)(NET_RESYNC_SECONDS * net->config.format.sample_rate);
+    ma_uint64 start = net->newest + (ma_uint64)(ma_int64)(ma_int32)(timestamp - (ma_uint32)net->newest);
+    if (start + resync < net->next || start > net->newest + resync)
+    {
+        TraceLog(LOG_INFO, "RTP timestamps jumped, starting over");
+        net_resync(net, ssrc, timestamp);
+        start = net->next;
+    }
+    ma_uint32 count = (ma_uint32)(size - header) / frame_bytes;
+    ma_uint64 end = start + count;
+    if (end <= net->next)
+    {
+        atomic_fetch_add_explicit(&net->late, 1, memory_order_relaxed);
+        return;
+    }
+
+    // A packet too far ahead pushes the oldest frames out early, gaps and all.
+    if (end - net->next > net->capacity)
+        net_release(net, end - net->capacity, now);
+
+    // L16 and L24 are big-endian, the ring is little-endian.
+    ma_uint32 sample_bytes = ma_get_bytes_per_sample(net->config.format.format);
+    ma_uint32 samples = net->config.format.channels;
+    const unsigned char *payload = packet + header;
+    for (ma_uint64 frame = start < net->next ? net->next : start; frame < end; frame++)
+    {
+        ma_uint32 slot = (ma_uint32)(frame & (net->capacity - 1));
+        const unsigned char *in = payload + (size_t)(frame - start) * frame_bytes;
+        unsigned char *out = net->frames + (size_t)slot * frame_bytes;
+        for (ma_uint32 s = 0; s < samples; s++, in += sample_bytes, out += sample_bytes)
+            for (ma_uint32 b = 0; b < sample_bytes; b++)
+                out[b] = in[sample_bytes - 1 - b];
+        net->filled[slot] = TRUE;
+    }
+    if (end > net->newest)
+        net->newest = end;
+}
+
+void net_release(net_t *net, ma_uint64 until, double now)
+{
+    /*
+    Writes the frames of the jitter buffer before `until` to the ring in order, the ones no
+    packet brought as silence, and stamps them with `now`.
+    */
+    ma_uint32 frame_bytes = net->config.format.frame_bytes;
+    ma_uint64 lost = 0;
+    int dropped = FALSE;
+    while (net->next < until)
+    {
+        // Up to the end of the jitter buffer, then again from its start.
+        ma_uint32 slot = (ma_uint32)(net->next & (net->capacity - 1));
+        ma_uint32 count = net->capacity - slot;
+        if (until - net->next < count)
+            count = (ma_uint32)(until - net->next);
+
+        unsigned char *frames = net->frames + (size_t)slot * frame_bytes;
+        for (ma_uint32 i = 0; i < count; i++)
+        {
+            if (!net->filled[slot + i])
+            {
+                memset(frames + (size_t)i * frame_bytes, 0, frame_bytes);
+                lost++;
+            }
+        }
+        memset(net->filled + slot, FALSE, count);
+
+        if (buffer_store_write(net->buffer_store, frames, count) < count)
+            dropped = TRUE;
+        net->next += count;
+    }
+    buffer_store_stamp(net->buffer_store, now);
+
+    if (lost > 0)
+        atomic_fetch_add_explicit(&net->lost, lost, memory_order_relaxed);
+    if (dropped)
+        atomic_fetch_add_explicit(&net->dropped_periods, 1, memory_order_relaxed);
+}
+
+void net_resync(net_t *net, ma_uint32 ssrc, ma_uint32 timestamp)
+{
+    /*
+    Empties the jitter buffer and starts it over at `timestamp` of `ssrc`. The ring carries on
+    where it was, the frame clock starts over by itself once it sees the stamps jump.
+    */
+    memset(net->filled, FALSE, net->capacity);
+    net->locked = TRUE;
+    net->ssrc = ssrc;
+    // Far enough from 0 that timestamps before the first one don't wrap around.
+    net->next = ((ma_uint64)1 << 32) + timestamp;
+    net->newest = net->next;
+}
+
+// Frame sharing
+int init_share(share_t *share, const char *name, int width, int height)
+{
+    /*
+    Creates the shared memory segment /name for frames of up to width x height, replacing one
+    left behind by an earlier run. From then on SIGINT and SIGTERM ask the loop to stop, so the
+    segment is removed on the way out. Has to be called after InitWindow. Returns 0 on success.
+    */
+    memset(share, 0, sizeof(*share));
+    snprintf(share->path, sizeof(share->path), "%s%s", name[0] == '/' ? "" : "/", name);
+    if (share_open(share, (size_t)width * height * 4) != 0)
+        return -1;
+#if defined(ASYNC_READBACK)
+    glGenBuffers(SHARE_READBACKS, share->buffers);
+#endif
+    signal(SIGINT, share_stop);
+    signal(SIGTERM, share_stop);
+
+    TraceLog(LOG_INFO, "Sharing frames as %s", share->path);
+    return 0;
+}
+
+void uninit_share(share_t *share)
+{
+    /*
+    Drops the readbacks still in flight, tells the readers the segment is gone and removes it.
+    Has to be called while the GL context is still there.
+    */
+    if (share->header == NULL)
+        return;
+#if defined(ASYNC_READBACK)
+    for (int i = 0; i < SHARE_READBACKS; i++)
+        if (share->fences[i] != NULL)
+            glDeleteSync(share->fences[i]);
+    glDeleteBuffers(SHARE_READBACKS, share->buffers);
+#endif
+    share_close(share);
+    TraceLog(LOG_INFO, "Shared %llu frames, %llu skipped", (unsigned long long)share->published, (unsigned long long)share->skipped);
+}
+
+int share_open(share_t *share, size_t slotSize)
+{
+    /*
+    Creates the segment with SHARE_SLOTS slots of slotSize bytes and maps it. Readers map it
+    by the same name. Returns 0 on success.
+    */
+    shm_unlink(share->path);
+    int fd = shm_open(share->path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    size_t size = SHARE_HEADER_SIZE + SHARE_SLOTS * slotSize;
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not create %s: %s", share->path, strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(share->path);
+        }
+        return -1;
+    }
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        TraceLog(LOG_ERROR, "Could not map %s", share->path);
+        shm_unlink(share->path);
+        return -1;
+    }
+
+    // ftruncate zeroed it, only the header is left to fill in.
+    share_header_t *header = (share_header_t *)mapping;
+    memcpy(header->magic, SHARE_MAGIC, sizeof(header->magic));
+    header->slot_count = SHARE_SLOTS;
+    header->slot_size = (ma_uint32)slotSize;
+    header->pixels_offset = SHARE_HEADER_SIZE;
+    atomic_init(&header->closed, FALSE);
+    for (int i = 0; i < SHARE_SLOTS; i++)
+        atomic_init(&header->slots[i].frame, 0);
+    atomic_store_explicit(&header->frame, 0, memory_order_release);
+
+    share->header = header;
+    share->size = size;
+    share->slot_size = slotSize;
+    return 0;
+}
+
+void share_close(share_t *share)
+{
+    /*
+    Marks the segment closed for the readers, unmaps and removes it.
+    */
+    atomic_store_explicit(&share->header->closed, TRUE, memory_order_release);
+    munmap(share->header, share->size);
+    shm_unlink(share->path);
+    share->header = NULL;
+}
+
+void share_publish(share_t *share, const RenderTexture2D *xytexture, const unsigned char *pixels)
+{
+    /*
+    Hands the frame just drawn to the readers. The software backend has it in `pixels` already,
+    it is copied straight in. From xytexture it is read back into a pixel buffer with a fence
+    and only copied in once the fence has passed, a frame or two later, so the render thread
+    never waits for the GPU. When every readback is still in flight the frame is skipped.
+    */
+    if (share->header == NULL)
+        return;
+    ZONE_BEGIN(zone, "share_publish");
+    int width = xytexture->texture.width;
+    int height = xytexture->texture.height;
+    double time = monotonic_seconds();
+
+    share_collect(share);
+    if (pixels != NULL)
+    {
+        share_write(share, pixels, width, height, time);
+        ZONE_END(zone);
+        return;
+    }
+
+#if defined(ASYNC_READBACK)
+    if (share->pending == SHARE_READBACKS)
+    {
+        share->skipped++;
+        ZONE_END(zone);
+        return;
+    }
+    int r = (share->oldest + share->pending) % SHARE_READBACKS;
+    GLsizeiptr size = (GLsizeiptr)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, share->buffers[r]);
+    if (share->buffer_sizes[r] != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        share->buffer_sizes[r] = size;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, xytexture->id);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    share->fences[r] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    share->widths[r] = width;
+    share->heights[r] = height;
+    share->times[r] = time;
+    share->pending++;
+#else
+    // Without fences the read back has to wait for the GPU, and raylib allocates the pixels.
+    unsigned char *read = rlReadTexturePixels(xytexture->texture.id, width, height, xytexture->texture.format);
+    if (read != NULL)
+        share_write(share, read, width, height, time);
+    free(read);
+#endif
+    ZONE_END(zone);
+}
+
+void share_collect(share_t *share)
+{
+    /*
+    Copies the readbacks whose fences have passed to the segment, oldest first, without
+    waiting for any of them.
+    */
+#if defined(ASYNC_READBACK)
+    while (share->pending > 0)
+    {
+        int r = share->oldest;
+        if (glClientWaitSync(share->fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        glDeleteSync(share->fences[r]);
+        share->fences[r] = NULL;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, share->buffers[r]);
+        const unsigned char *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, share->buffer_sizes[r], GL_MAP_READ_BIT);
+        if (pixels != NULL)
+        {
+            share_write(share, pixels, share->widths[r], share->heights[r], share->times[r]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        share->oldest = (share->oldest + 1) % SHARE_READBACKS;
+        share->pending--;
+    }
+#else
+    (void)share;
+#endif
+}
+
+void share_write(share_t *share, const unsigned char *pixels, int width, int height, double time)
+{
+    /*
+    Copies a frame into the next slot and publishes it, see share_header_t. A frame bigger than
+    the slots moves to a new segment of the same name first, the readers see the old one closed.
+    */
+    size_t bytes = (size_t)width * height * 4;
+    if (bytes > share->slot_size)
+    {
+        ma_uint64 published = atomic_load_explicit(&share->header->frame, memory_order_relaxed);
+        share_close(share);
+        if (share_open(share, bytes) != 0)
+            return;
+        atomic_store_explicit(&share->header->frame, published, memory_order_relaxed);
+        TraceLog(LOG_INFO, "Sharing frames of %dx%d as %s", width, height, share->path);
+    }
+
+    // The slot reads as empty while it is written, readers check it again after copying.
+    share_header_t *header = share->header;
+    ma_uint64 frame = atomic_load_explicit(&header->frame, memory_order_relaxed) + 1;
+    share_slot_t *slot = &header->slots[(frame - 1) % SHARE_SLOTS];
+    atomic_store_explicit(&slot->frame, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((unsigned char *)header + header->pixels_offset + (size_t)((frame - 1) % SHARE_SLOTS) * share->slot_size, pixels, bytes);
+    slot->width = (ma_uint32)width;
+    slot->height = (ma_uint32)height;
+    slot->time = time;
+    atomic_store_explicit(&slot->frame, frame, memory_order_release);
+    atomic_store_explicit(&header->frame, frame, memory_order_release);
+    share->published++;
+}
+
+void share_stop(int signal)
+{
+    /*
+    SIGINT and SIGTERM handler while sharing, the loop stops on the next frame.
+    */
+    (void)signal;
+    stop_requested = TRUE;
+}
+
+// Benchmark
+int run_bench(opt_t *opt)
+{
+    /*
+    Feeds opt->bench at opt->bench_rate into the ring, as much as the capture would deliver
+    between two frames at opt->fps, and draws it with handle_draw into a hidden window as fast
+    as it goes. Prints one line of JSON with the frame, CPU and GPU times to stdout, so runs
+    can be collected into a file and compared:
+
+        ./rxyo -B noise -R 192000 -w 3840x2160 -b software >> bench.jsonl
+
+    Returns 0 on success.
+    */
+    // raylib logs to stdout, which is taken by the results.
+    SetTraceLogCallback(log_to_stderr);
+
+    ma_uint32 channels = trace_map_channels(&opt->traces);
+    ma_uint32 sample_rate = (ma_uint32)opt->bench_rate;
+    int frame_samples = (int)(sample_rate / opt->fps + 1);
+    int total = BENCH_WARMUP + opt->bench_frames;
+
+    float *frames = malloc((size_t)frame_samples * channels * sizeof(float));
+    double *times = malloc(3 * (size_t)opt->bench_frames * sizeof(double));
+    if (frames == NULL || times == NULL ||
+        init_buffer_store(&opt->buffer_store, ring_seconds(opt), channels) != 0)
+    {
+        free(times);
+        free(frames);
+        return -1;
+    }
+    if (buffer_store_set_format(&opt->buffer_store, ma_format_f32, channels, sample_rate) != 0 ||
+        init_sample_window(&opt->window, opt->traces.count, opt->traces.planes, opt->buffer_store.capacity) != 0)
+    {
+        uninit_buffer_store(&opt->buffer_store);
+        free(times);
+        free(frames);
+        return -1;
+    }
+    double *frame_times = times;
+    double *cpu_times = times + opt->bench_frames;
+    double *gpu_times = times + 2 * opt->bench_frames;
+
+    // Without timestamps the frame clock never locks, so every frame takes all there is.
+    init_frame_clock(&opt->frame_clock, sample_rate);
+    init_stats(&opt->stats, NULL);
+    opt->menu_shown = FALSE;
+
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(opt->screen_width, opt->screen_height, "Simple XY");
+
+    int result = -1;
+    if (init_trace_batch(&opt->trace_batch) != 0 || init_render_targets(opt) != 0)
+        goto done;
+    if (init_trace_shader(&opt->trace_shader, opt->window.planes, opt->window.plane_size) != 0 && opt->backend == BACKEND_SHADER)
+    {
+        TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+        opt->backend = BACKEND_BATCHED;
+    }
+    SetTargetFPS(0);
+
+    // Timer queries only measure the GPU, the CPU never waits for their results.
+    int gpu_timed = FALSE;
+#if defined(GPU_TIMERS)
+    GLuint queries[BENCH_QUERIES] = {0};
+    gpu_timed = rlGetVersion() >= RL_OPENGL_33;
+    if (gpu_timed)
+        glGenQueries(BENCH_QUERIES, queries);
+#endif
+
+    ma_uint64 position = 0;
+    ma_uint64 samples = 0;
+    double bench_start = 0.0;
+    for (int frame = 0; frame < total; frame++)
+    {
+        // Frames hold exactly 1/fps seconds of the signal, like in an offline render.
+        ma_uint64 end = (ma_uint64)(frame + 1) * sample_rate / opt->fps;
+        bench_signal(opt->bench, position, (ma_uint32)(end - position), channels, sample_rate, frames);
+        buffer_store_write(&opt->buffer_store, frames, (ma_uint32)(end - position));
+        position = end;
+
+        int measured = frame - BENCH_WARMUP;
+        if (measured == 0)
+            bench_start = monotonic_seconds();
+#if defined(GPU_TIMERS)
+        GLuint query = queries[frame % BENCH_QUERIES];
+        if (gpu_timed && frame >= BENCH_QUERIES && measured - BENCH_QUERIES >= 0)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            gpu_times[measured - BENCH_QUERIES] = elapsed / 1e6;
+        }
+        if (gpu_timed)
+            glBeginQuery(GL_TIME_ELAPSED, query);
+#endif
+
+        double start = monotonic_seconds();
+        double cpu_start = thread_cpu_seconds();
+        ma_uint64 tail = atomic_load_explicit(&opt->buffer_store.tail, memory_order_relaxed);
+        handle_draw(opt, &opt->buffer_store, &opt->xytexture);
+
+#if defined(GPU_TIMERS)
+        if (gpu_timed)
+            glEndQuery(GL_TIME_ELAPSED);
+#endif
+        if (measured >= 0)
+        {
+            frame_times[measured] = (monotonic_seconds() - start) * 1e3;
+            cpu_times[measured] = (thread_cpu_seconds() - cpu_start) * 1e3;
+            samples += atomic_load_explicit(&opt->buffer_store.tail, memory_order_relaxed) - tail;
+        }
+    }
+    double elapsed = monotonic_seconds() - bench_start;
+
+#if defined(GPU_TIMERS)
+    // The last queries are still in flight.
+    for (int measured = opt->bench_frames - BENCH_QUERIES; gpu_timed && measured < opt->bench_frames; measured++)
+    {
+        if (measured < 0)
+            continue;
+        GLuint64 gpu_elapsed = 0;
+        glGetQueryObjectui64v(queries[(measured + BENCH_WARMUP) % BENCH_QUERIES], GL_QUERY_RESULT, &gpu_elapsed);
+        gpu_times[measured] = gpu_elapsed / 1e6;
+    }
+    if (gpu_timed)
+        glDeleteQueries(BENCH_QUERIES, queries);
+#endif
+
+    const char *backends[BACKEND_COUNT] = {"shader", "batched", "software"};
+    printf("{\"backend\": \"%s\", \"signal\": \"%s\", \"sample_rate\": %u, \"width\": %d, \"height\": %d, "
+           "\"interpolation\": %d, \"traces\": %d, \"persistence\": %s, \"frames\": %d, \"samples_per_second\": %.0f",
+           backends[opt->backend], opt->bench == BENCH_NOISE ? "noise" : "lissajous", sample_rate,
+           opt->screen_width, opt->screen_height, opt->interpolation, opt->traces.count,
+           opt->persistence ? "true" : "false", opt->bench_frames, samples / elapsed);
+    if (opt->lod.enabled)
+        printf(", \"lod_ms\": %.1f", opt->lod.budget * 1000.0f);
+    else
+        printf(", \"lod_ms\": null");
+    printf(", \"trigger\": %s", opt->trigger.enabled ? "true" : "false");
+    printf(", \"scale\": %.4g", opt->resolution.current);
+    if (opt->resolution.dynamic)
+        printf(", \"resolution_ms\": %.1f", opt->resolution.budget * 1000.0f);
+    else
+        printf(", \"resolution_ms\": null");
+    print_bench_times("frame_ms", frame_times, opt->bench_frames);
+    print_bench_times("cpu_ms", cpu_times, opt->bench_frames);
+    if (gpu_timed)
+        print_bench_times("gpu_ms", gpu_times, opt->bench_frames);
+    else
+        printf(", \"gpu_ms\": null");
+    printf("}\n");
+    fflush(stdout);
+    result = 0;
+
+done:
+    uninit_lod(&opt->lod);
+    unload_software(&opt->software);
+    unload_phosphor(&opt->phosphor);
+    unload_trace_shader(&opt->trace_shader);
+    unload_trace_batch(&opt->trace_batch);
+    UnloadRenderTexture(opt->xytexture);
+    CloseWindow();
+    unload_sample_window(&opt->window);
+    uninit_buffer_store(&opt->buffer_store);
+    free(times);
+    free(frames);
+
+    return result;
+}
+
+void bench_signal(bench_signal_t signal, ma_uint64 first, ma_uint32 frameCount, ma_uint32 channels, ma_uint32 sampleRate, float *frames)
+{
+    /*
+    Frames first up to first + frameCount of the signal, interleaved. Both signals only depend
+    on the position, so every run draws exactly the same samples.
+    */
+    for (ma_uint32 i = 0; i < frameCount; i++)
+    {
+        ma_uint64 n = first + i;
+        for (ma_uint32 channel = 0; channel < channels; channel++)
+        {
+            float value;
+            if (signal == BENCH_NOISE)
+            {
+                // A hash of the position rather than a generator, nothing to keep between calls.
+                ma_uint64 h = (n * channels + channel + 1) * 0x9E3779B97F4A7C15ull;
+                h ^= h >> 31;
+                h *= 0xBF58476D1CE4E5B9ull;
+                h ^= h >> 29;
+                value = (float)((h >> 40) / 8388608.0 - 1.0);
+            }
+            else
+            {
+                double cycles = BENCH_FREQUENCY * (1.0 + 0.5 * channel) * n / sampleRate;
+                value = (float)(0.8 * sin(2.0 * M_PI * (cycles - floor(cycles))));
+            }
+            frames[i * channels + channel] = value;
+        }
+    }
+}
+
+void print_bench_times(const char *name, double *times, int count)
+{
+    /*
+    Prints the mean and the percentiles of times as a JSON member, sorts times.
+    */
+    double sum = 0.0;
+    for (int i = 0; i < count; i++)
+        sum += times[i];
+    qsort(times, count, sizeof(double), compare_doubles);
+
+    printf(", \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}", name,
+           sum / count, times[count / 2], times[count * 9 / 10], times[count * 99 / 100], times[count - 1]);
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Profiling
+#if defined(PROFILE_ZONES)
+static profiler_t profiler = {PTHREAD_MUTEX_INITIALIZER, NULL, 0};
+#endif
+
+int write_profile(const char *path)
+{
+    /*
+    Writes the zones every thread recorded, up to PROFILE_EVENTS per thread, to path in the
+    Trace Event Format that chrome://tracing and Perfetto open. Does nothing without a path.
+    Returns 0 on success.
+    */
+    if (path == NULL)
+        return 0;
+
+#if defined(PROFILE_ZONES)
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not open %s", path);
+        return -1;
+    }
+
+    pthread_mutex_lock(&profiler.lock);
+    zone_thread_t *threads = profiler.threads;
+    pthread_mutex_unlock(&profiler.lock);
+
+    // Threads are only ever added at the front, so the list can be walked without the lock.
+    fprintf(file, "{\"traceEvents\": [\n");
+    int first = TRUE;
+    for (zone_thread_t *thread = threads; thread != NULL; thread = thread->next)
+    {
+        ma_uint64 count = atomic_load_explicit(&thread->count, memory_order_acquire);
+        ma_uint64 start = count > PROFILE_EVENTS - PROFILE_MARGIN ? count - (PROFILE_EVENTS - PROFILE_MARGIN) : 0;
+        for (ma_uint64 i = start; i < count; i++)
+        {
+            const zone_event_t *event = &thread->events[i & (PROFILE_EVENTS - 1)];
+            fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"%s\", \"s\": \"t\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                    first ? "" : ",\n", event->name, event->duration > 0 ? "X" : "i",
+                    event->start / 1e3, event->duration / 1e3, (int)getpid(), thread->id);
+            first = FALSE;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    int result = ferror(file) ? -1 : 0;
+    fclose(file);
+    TraceLog(LOG_INFO, "Wrote the profile to %s", path);
+    return result;
+#else
+    TraceLog(LOG_WARNING, "Built without PROFILE_ZONES, %s is not written", path);
+    return -1;
+#endif
+}
+
+#if defined(PROFILE_ZONES)
+ma_uint64 zone_now(void)
+{
+    /*
+    Nanoseconds of the monotonic clock, the same one monotonic_seconds reads.
+    */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ma_uint64)ts.tv_sec * 1000000000ull + (ma_uint64)ts.tv_nsec;
+}
+
+void zone_record(const char *name, ma_uint64 start, ma_uint64 end)
+{
+    /*
+    Adds a zone to the ones of the calling thread, overwriting the oldest when they are full.
+    */
+    zone_thread_t *thread = zone_thread();
+    if (thread == NULL)
+        return;
+
+    ma_uint64 count = atomic_load_explicit(&thread->count, memory_order_relaxed);
+    zone_event_t *event = &thread->events[count & (PROFILE_EVENTS - 1)];
+    event->name = name;
+    event->start = start;
+    event->duration = end > start ? end - start : 0;
+    atomic_store_explicit(&thread->count, count + 1, memory_order_release);
+}
+
+zone_thread_t *zone_thread(void)
+{
+    /*
+    The zones of the calling thread, allocated on its first zone. NULL if that failed.
+    */
+    static _Thread_local zone_thread_t *local = NULL;
+    static _Thread_local int failed = FALSE;
+    if (local != NULL || failed)
+        return local;
+
+    ALLOW_ALLOCATIONS();
+    local = calloc(1, sizeof(zone_thread_t));
+    FORBID_ALLOCATIONS();
+    if (local == NULL)
+    {
+        failed = TRUE;
+        return NULL;
+    }
+    atomic_init(&local->count, 0);
+
+    pthread_mutex_lock(&profiler.lock);
+    local->id = profiler.next_id++;
+    local->next = profiler.threads;
+    profiler.threads = local;
+    pthread_mutex_unlock(&profiler.lock);
+
+    return local;
+}
+#endif
+
+// Statistics
+int init_stats(stats_t *stats, const char *path)
+{
+    /*
+    Starts the first window. With a path the rows are appended to that CSV file,
+    the header is only written to a new one. Returns 0 on success.
+    */
+    memset(stats, 0, sizeof(*stats));
+    stats->window_start = monotonic_seconds();
+    stats->samples_min = INT_MAX;
+
+    if (path == NULL)
+        return 0;
+
+    stats->csv = fopen(path, "a");
+    if (stats->csv == NULL)
+        return -1;
+
+    if (ftell(stats->csv) == 0)
+        fprintf(stats->csv, "time,fps,refresh_hz,frames_per_refresh,latency_ms,latency_max_ms,"
+                            "samples_per_frame,samples_min,samples_max,dropped_periods,dropped_frames,draw_cpu_ms,callback_cpu_ms\n");
+    return 0;
+}
+
+void uninit_stats(stats_t *stats)
+{
+    if (stats->csv != NULL)
+        fclose(stats->csv);
+    stats->csv = NULL;
+}
+
+void stats_presented(stats_t *stats, double now)
+{
+    /*
+    Called right after a buffer swap. Whatever was drawn into xytexture before it is on screen now,
+    or as soon as the display scans it out, which we can't see from here.
+    */
+    if (stats->pending_capture_time <= 0.0)
+        return;
+
+    double latency = now - stats->pending_capture_time;
+    stats->latency_sum += latency;
+    stats->latency_max = fmax(stats->latency_max, latency);
+    stats->latency_count++;
+    stats->pending_capture_time = 0.0;
+}
+
+void stats_drawn(stats_t *stats, int samples, int merged, double captureTime)
+{
+    /*
+    Called once per loop iteration with the number of frames drawn, how many of them were merged
+    into one and when the newest was captured, 0 if that is not known.
+    */
+    stats->frames++;
+    stats->samples += samples;
+    stats->samples_min = samples < stats->samples_min ? samples : stats->samples_min;
+    stats->samples_max = samples > stats->samples_max ? samples : stats->samples_max;
+    stats->merged_max = merged > stats->merged_max ? merged : stats->merged_max;
+    if (captureTime > 0.0)
+        stats->pending_capture_time = captureTime;
+}
+
+void stats_update(stats_t *stats, buffer_store_t *buffer_store, ma_uint64 callbackNs, ma_uint64 droppedPeriods, double now)
+{
+    /*
+    Closes the window once it is STATS_SECONDS long and starts the next one. callbackNs and
+    droppedPeriods are the totals so far of the audio callback feeding buffer_store.
+    */
+    double elapsed = now - stats->window_start;
+    if (elapsed < STATS_SECONDS || stats->frames == 0)
+        return;
+
+    ma_uint64 callback_ns = callbackNs;
+    ma_uint64 dropped = droppedPeriods;
+    ma_uint64 overruns = atomic_load_explicit(&buffer_store->overruns, memory_order_relaxed);
+
+    double fps = stats->frames / elapsed;
+    int refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+    double per_refresh = refresh > 0 ? fps / refresh : 0.0;
+    double latency = stats->latency_count > 0 ? stats->latency_sum / stats->latency_count : 0.0;
+    double samples = (double)stats->samples / stats->frames;
+    // Per second of wall time, i.e. thousandths of a core
+    double draw_ms = stats->draw_cpu * 1000.0 / elapsed;
+    double callback_ms = (double)(callback_ns - stats->callback_ns_start) / 1e6 / elapsed;
+    ma_uint64 dropped_periods = dropped - stats->dropped_start;
+    ma_uint64 dropped_frames = overruns - stats->overruns_start;
+
+    snprintf(stats->lines[0], MENU_LINE_SIZE, "%.1f fps, %.2f frames per refresh (%d Hz)", fps, per_refresh, refresh);
+    snprintf(stats->lines[1], MENU_LINE_SIZE, "Callback to swap: %.1f ms (max %.1f ms)", latency * 1000.0, stats->latency_max * 1000.0);
+    if (stats->merged_max > 1)
+        snprintf(stats->lines[2], MENU_LINE_SIZE, "Samples per frame: %.1f (%d-%d), up to %d merged", samples, stats->samples_min, stats->samples_max, stats->merged_max);
+    else
+        snprintf(stats->lines[2], MENU_LINE_SIZE, "Samples per frame: %.1f (%d-%d)", samples, stats->samples_min, stats->samples_max);
+    snprintf(stats->lines[3], MENU_LINE_SIZE, "Dropped periods: %llu (%llu frames, ring of %u)",
+             (unsigned long long)dropped_periods, (unsigned long long)dropped_frames, buffer_store->capacity);
+    snprintf(stats->lines[4], MENU_LINE_SIZE, "CPU in handle_draw: %.1f ms/s", draw_ms);
+    snprintf(stats->lines[5], MENU_LINE_SIZE, "Time in the audio callback: %.2f ms/s", callback_ms);
+
+    if (stats->csv != NULL)
+    {
+        fprintf(stats->csv, "%.3f,%.2f,%d,%.3f,%.3f,%.3f,%.1f,%d,%d,%llu,%llu,%.3f,%.3f\n",
+                now, fps, refresh, per_refresh, latency * 1000.0, stats->latency_max * 1000.0,
+                samples, stats->samples_min, stats->samples_max, (unsigned long long)dropped_periods,
+                (unsigned long long)dropped_frames, draw_ms, callback_ms);
+        fflush(stats->csv);
+    }
+
+    stats->window_start = now;
+    stats->frames = 0;
+    stats->samples = 0;
+    stats->samples_min = INT_MAX;
+    stats->samples_max = 0;
+    stats->merged_max = 0;
+    stats->latency_sum = 0.0;
+    stats->latency_max = 0.0;
+    stats->latency_count = 0;
+    stats->draw_cpu = 0.0;
+    stats->callback_ns_start = callback_ns;
+    stats->dropped_start = dropped;
+    stats->overruns_start = overruns;
+}
+
+void draw_stats(opt_t *opt)
+{
+    /*
+    Shows the last complete window in the bottom left corner.
+    */
+    int x = 10;
+    int y = opt->screen_height - 10 - STATS_LINES * 15;
+    if (opt->analysis_shown)
+        y -= ANALYSIS_PANEL + 10; // Above the analysis panels
+
+    for (int i = 0; i < STATS_LINES; i++)
+        DrawText(opt->stats.lines[i], x, y + i * 15, 10, FOREGROUND_COLOR);
+}
+
+// Capture devices
+int init_capture(capture_t *capture, ma_context *context, buffer_store_t *buffer_store, int native, ma_uint32 channels)
+{
+    /*
+    Opens and starts the default capture device in slot 0, then starts the thread that
+    handles switching devices. With native the frames are captured as the default device
+    delivers them, otherwise as float with the given channels at the rate of the ring. Returns
+    0 on success.
+    */
+    memset(capture, 0, sizeof(*capture));
+    capture->context = context;
+    capture->buffer_store = buffer_store;
+
+    capture->config = ma_device_config_init(ma_device_type_capture);
+    capture->config.capture.format = native ? ma_format_unknown : ma_format_f32; // ma_format_unknown uses the device's native format.
+    capture->config.capture.channels = native ? 0 : channels;                     // 0 uses the device's native channel count.
+    capture->config.sampleRate = native ? 0 : buffer_store->format.sample_rate;   // 0 uses the device's native sample rate.
+    capture->config.dataCallback = data_callback;   // This function will be called when miniaudio needs more data.
+    capture->config.pUserData = capture;            // Can be accessed from the device object (device.pUserData).
+
+    atomic_init(&capture->active, 0);
+    atomic_init(&capture->busy[0], FALSE);
+    atomic_init(&capture->busy[1], FALSE);
+    atomic_init(&capture->status, CAPTURE_RUNNING);
+
+    // NULL opens the default device
+    if (capture_open(capture, 0, NULL) != 0)
+        return -1;
+
+    if (native)
+    {
+        // Whatever it captured so far went in with the wrong format, stop it before changing that.
+        ma_device *device = &capture->devices[0];
+        ma_device_stop(device);
+
+        capture->config.capture.format = device->capture.format;
+        capture->config.capture.channels = device->capture.channels;
+        capture->config.sampleRate = device->sampleRate;
+
+        if (device->capture.channels < channels)
+            TraceLog(LOG_WARNING, "The device has %u channels, the traces use %u", device->capture.channels, channels);
+        if (device->capture.channels > RING_MAX_CHANNELS)
+        {
+            ma_device_uninit(device);
+            capture->initialized[0] = FALSE;
+            capture->config.capture.channels = channels;
+            if (capture_open(capture, 0, NULL) != 0)
+                return -1;
+            ma_device_stop(device);
+        }
+
+        // Every device opened from now on is converted to this format by miniaudio if it has to.
+        if (buffer_store_set_format(buffer_store, capture->config.capture.format,
+                                    capture->config.capture.channels, capture->config.sampleRate) != 0)
+        {
+            ma_device_uninit(device);
+            return -1;
+        }
+        if (ma_device_start(device) != MA_SUCCESS)
+        {
+            TraceLog(LOG_ERROR, "Could not start the capture device");
+            ma_device_uninit(device);
+            return -1;
+        }
+    }
+    TraceLog(LOG_INFO, "Capturing %s with %u channels at %u Hz", ma_get_format_name(buffer_store->format.format),
+             buffer_store->format.channels, buffer_store->format.sample_rate);
+
+    capture->running = TRUE;
+    pthread_mutex_init(&capture->lock, NULL);
+    pthread_cond_init(&capture->wake, NULL);
+    if (pthread_create(&capture->thread, NULL, capture_thread, capture) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not start the capture thread");
+        pthread_cond_destroy(&capture->wake);
+        pthread_mutex_destroy(&capture->lock);
+        ma_device_uninit(&capture->devices[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+void uninit_capture(capture_t *capture)
+{
+    pthread_mutex_lock(&capture->lock);
+    capture->running = FALSE;
+    pthread_cond_signal(&capture->wake);
+    pthread_mutex_unlock(&capture->lock);
+
+    // Waits for a switch in progress to finish before closing the devices.
+    pthread_join(capture->thread, NULL);
+    pthread_cond_destroy(&capture->wake);
+    pthread_mutex_destroy(&capture->lock);
+
+    for (int slot = 0; slot < 2; slot++)
+    {
+        if (capture->initialized[slot])
+            ma_device_uninit(&capture->devices[slot]);
+        capture->initialized[slot] = FALSE;
+    }
+}
+
+ma_uint32 capture_sample_rate(capture_t *capture)
+{
+    /*
+    Rate of the frames in the ring. Every device is opened with the same config,
+    so it doesn't change when switching.
+    */
+    return capture->config.sampleRate;
+}
+
+void capture_request_device(capture_t *capture, const ma_device_id *id)
+{
+    /*
+    Asks the capture thread to switch to the device with the given id and returns immediately.
+    If a switch is already pending, only the most recent request is kept.
+    */
+    pthread_mutex_lock(&capture->lock);
+    capture->pending_id = *id;
+    capture->pending = TRUE;
+    atomic_store(&capture->status, CAPTURE_SWITCHING);
+    pthread_cond_signal(&capture->wake);
+    pthread_mutex_unlock(&capture->lock);
+}
+
+int capture_open(capture_t *capture, int slot, const ma_device_id *id)
+{
+    /*
+    Opens and starts a device in the given slot. It only receives frames once capture_swap
+    makes it the active slot. Returns 0 on success.
+    */
+    ma_device_config config = capture->config;
+    if (id != NULL)
+    {
+        capture->device_ids[slot] = *id;
+        config.capture.pDeviceID = &capture->device_ids[slot];
+    }
+
+    ZONE_BEGIN(zone, "ma_device_init");
+    ma_result result = ma_device_init(capture->context, &config, &capture->devices[slot]);
+    ZONE_END(zone);
+    if (result != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not open the capture device");
+        return -1;
+    }
+    capture->initialized[slot] = TRUE;
+
+    // The device is sleeping by default so you'll need to start it manually.
+    if (ma_device_start(&capture->devices[slot]) != MA_SUCCESS)
+    {
+        TraceLog(LOG_ERROR, "Could not start the capture device");
+        ma_device_uninit(&capture->devices[slot]);
+        capture->initialized[slot] = FALSE;
+        return -1;
+    }
+
+    return 0;
+}
+
+void capture_swap(capture_t *capture, int slot)
+{
+    /*
+    Hands the ring over to the device in `slot`. The old device is shut out first and any period
+    it is in the middle of writing is allowed to finish, so there is never more than one writer.
+    */
+    int old = atomic_load(&capture->active);
+
+    atomic_store(&capture->active, -1);
+    while (atomic_load(&capture->busy[old]))
+        sched_yield();
+    atomic_store(&capture->active, slot);
+
+    ma_device_uninit(&capture->devices[old]);
+    capture->initialized[old] = FALSE;
+}
+
+void *capture_thread(void *arg)
+{
+    capture_t *capture = (capture_t *)arg;
+
+    pthread_mutex_lock(&capture->lock);
+    while (capture->running)
+    {
+        if (!capture->pending)
+        {
+            pthread_cond_wait(&capture->wake, &capture->lock);
+            continue;
+        }
+
+        ma_device_id id = capture->pending_id;
+        capture->pending = FALSE;
+        pthread_mutex_unlock(&capture->lock);
+
+        int slot = 1 - atomic_load(&capture->active);
+        int result = capture_open(capture, slot, &id);
+        if (result == 0)
+        {
+            capture_swap(capture, slot);
+            TraceLog(LOG_INFO, "Capturing from %s", capture->devices[slot].capture.name);
+        }
+
+        pthread_mutex_lock(&capture->lock);
+        // A newer request may have come in while we were opening this one.
+        if (!capture->pending)
+            atomic_store(&capture->status, result == 0 ? CAPTURE_RUNNING : CAPTURE_FAILED);
+    }
+    pthread_mutex_unlock(&capture->lock);
+
+    return NULL;
+}
+
+// Device enumeration
+int init_device_cache(device_cache_t *cache, ma_context *context)
+{
+    /*
+    Enumerates the devices once so the first frame already has a list, then starts the
+    background thread. Returns 0 on success.
+    */
+    memset(cache, 0, sizeof(*cache));
+    cache->context = context;
+
+    if (enumerate_devices(context, &cache->shared) != 0)
+        TraceLog(LOG_WARNING, "Could not enumerate capture devices");
+    cache->snapshot = cache->shared;
+    cache->running = TRUE;
+
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->wake, NULL);
+    if (pthread_create(&cache->thread, NULL, device_cache_thread, cache) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not start the device enumeration thread");
+        pthread_cond_destroy(&cache->wake);
+        pthread_mutex_destroy(&cache->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+void uninit_device_cache(device_cache_t *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    cache->running = FALSE;
+    pthread_cond_signal(&cache->wake);
+    pthread_mutex_unlock(&cache->lock);
+
+    pthread_join(cache->thread, NULL);
+    pthread_cond_destroy(&cache->wake);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+const device_list_t *device_cache_snapshot(device_cache_t *cache)
+{
+    /*
+    Returns the render thread's copy of the device list, picking up a newer list if the
+    background thread published one and isn't holding the lock right now.
+    */
+    if (pthread_mutex_trylock(&cache->lock) == 0)
+    {
+        if (cache->generation != cache->snapshot_generation)
+        {
+            cache->snapshot = cache->shared;
+            cache->snapshot_generation = cache->generation;
+        }
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    return &cache->snapshot;
+}
+
+void *device_cache_thread(void *arg)
+{
+    device_cache_t *cache = (device_cache_t *)arg;
+    static device_list_t list; // Too big for some thread stacks, only this thread uses it
+
+    pthread_mutex_lock(&cache->lock);
+    while (cache->running)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += DEVICE_REFRESH_SECONDS;
+        pthread_cond_timedwait(&cache->wake, &cache->lock, &deadline);
+        if (!cache->running)
+            break;
+
+        // Don't hold the lock while talking to the backend.
+        pthread_mutex_unlock(&cache->lock);
+        ZONE_BEGIN(zone, "enumerate_devices");
+        int result = enumerate_devices(cache->context, &list);
+        ZONE_END(zone);
+        pthread_mutex_lock(&cache->lock);
+
+        // Only bump the generation when something changed, the render thread copies on every bump.
+        if (result == 0 && memcmp(&list, &cache->shared, sizeof(list)) != 0)
+        {
+            cache->shared = list;
+            cache->generation++;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return NULL;
+}
+
+int enumerate_devices(ma_context *context, device_list_t *list)
+{
+    ma_device_info *pPlaybackInfos;
+    ma_uint32 playbackCount;
+    ma_device_info *pCaptureInfos;
+    ma_uint32 captureCount;
+
+    if (ma_context_get_devices(context, &pPlaybackInfos, &playbackCount, &pCaptureInfos, &captureCount) != MA_SUCCESS)
+        return -1;
+
+    // Zeroed so lists can be compared with memcmp
+    memset(list, 0, sizeof(*list));
+    list->count = captureCount < MAX_DEVICES ? captureCount : MAX_DEVICES;
+    for (ma_uint32 iDevice = 0; iDevice < list->count; iDevice += 1)
+    {
+        memcpy(&list->infos[iDevice], &pCaptureInfos[iDevice], sizeof(ma_device_info));
+        snprintf(list->lines[iDevice], DEVICE_LINE_SIZE, "%u - %s", iDevice, pCaptureInfos[iDevice].name);
+    }
+
+    return 0;
+}
+
+
+// Beam
+// Pasted into the vertex shaders: emit_beam places corner 0-5 of the quad around the piece
+// of the trace from a to b, leaving BEAM_RADIUS sigmas of room on every side for the profile.
+#define BEAM_VERTEX_COMMON                                                                                \
+    "uniform vec2 resolution;\n"                                                                          \
+    "uniform float sigma;\n"                                                                              \
+    "out vec2 fragPosition;\n"                                                                            \
+    "flat out vec2 fragA;\n"                                                                              \
+    "flat out vec2 fragB;\n"                                                                              \
+    "flat out float fragEnergy;\n"                                                                        \
+    "void emit_beam(vec2 a, vec2 b, int corner, float energy)\n"                                          \
+    "{\n"                                                                                                 \
+    "    vec2 d = b - a;\n"                                                                               \
+    "    vec2 u = length(d) > 0.0 ? d / length(d) : vec2(1.0, 0.0);\n"                                    \
+    "    vec2 n = vec2(-u.y, u.x);\n"                                                                     \
+    "    float r = " XSTRINGIFY(BEAM_RADIUS) " * sigma;\n"                                                \
+    "    vec2 p = (corner == 2 || corner == 3 || corner == 5) ? b + u * r : a - u * r;\n"                 \
+    "    p += (corner == 0 || corner == 2 || corner == 3) ? n * r : -n * r;\n"                            \
+    "    fragPosition = p;\n"                                                                             \
+    "    fragA = a;\n"                                                                                    \
+    "    fragB = b;\n"                                                                                    \
+    "    fragEnergy = energy;\n"                                                                          \
+    "    gl_Position = vec4(2.0 * p.x / resolution.x - 1.0, 1.0 - 2.0 * p.y / resolution.y, 0.0, 1.0);\n" \
+    "}\n"
+
+// Energy the piece from fragA to fragB leaves on this pixel: the Gaussian profile across the piece
+// times the profile integrated along it (hence the erf), which becomes a plain 2D Gaussian as the
+// piece shrinks to a point. Consecutive pieces add up to one continuous line.
+static const char *beam_fragment_shader =
+    "#version 330\n"
+    "in vec2 fragPosition;\n"
+    "flat in vec2 fragA;\n"
+    "flat in vec2 fragB;\n"
+    "flat in float fragEnergy;\n"
+    "uniform float sigma;\n"
+    "uniform float scale;\n"
+    "out vec4 finalColor;\n"
+    // Abramowitz and Stegun 7.1.26, good to 1.5e-7
+    "float erf_approx(float x)\n"
+    "{\n"
+    "    float t = 1.0 / (1.0 + 0.3275911 * abs(x));\n"
+    "    float y = 1.0 - t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429)))) * exp(-x * x);\n"
+    "    return sign(x) * y;\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 d = fragB - fragA;\n"
+    "    float len = length(d);\n"
+    "    vec2 u = len > 0.0 ? d / len : vec2(1.0, 0.0);\n"
+    "    vec2 q = fragPosition - fragA;\n"
+    "    float along = dot(q, u);\n"
+    "    float across = dot(q, vec2(-u.y, u.x));\n"
+    "    float peak = 0.3989422804 / sigma;\n" // 1 / (sqrt(2 pi) sigma)
+    "    float profile = peak * exp(-0.5 * across * across / (sigma * sigma));\n"
+    "    float spread = len > 1e-3 * sigma\n"
+    "        ? 0.5 * (erf_approx(along / (1.4142135624 * sigma)) - erf_approx((along - len) / (1.4142135624 * sigma))) / len\n"
+    "        : peak * exp(-0.5 * along * along / (sigma * sigma));\n"
+    // From per pixel to per unit of normalized area
+    "    finalColor = vec4(fragEnergy * profile * spread * scale * scale);\n"
+    "}\n";
+
+beam_t beam_for(int width, int height, ma_uint32 sampleRate)
+{
+    /*
+    Beam of the given resolution drawing samples captured at sampleRate.
+    */
+    beam_t beam;
+
+    beam.width = width;
+    beam.height = height;
+    beam.scale = (float)(width < height ? width : height);
+    beam.sigma = fmaxf(BEAM_SIGMA * beam.scale, MIN_BEAM_SIGMA);
+    beam.energy = 1.0f / (float)sampleRate;
+
+    return beam;
+}
+
+// Trace batching
+static const char *trace_vertex_shader =
+    "#version 330\n"
+    "in vec4 vertexPosition;\n" // Bound by raylib to attribute 0, carries trace_vertex_t.ax to .by
+    "in vec2 vertexTexCoord;\n" // Bound by raylib to attribute 1, carries trace_vertex_t.corner and .energy
+    BEAM_VERTEX_COMMON
+    "void main()\n"
+    "{\n"
+    "    emit_beam(vertexPosition.xy, vertexPosition.zw, int(vertexTexCoord.x), vertexTexCoord.y);\n"
+    "}\n";
+
+int init_trace_batch(trace_batch_t *batch)
+{
+    /*
+    Compiles the trace shader. Buffers are allocated lazily by trace_batch_reserve.
+    Has to be called after InitWindow since it needs a GL context. Returns 0 on success.
+    */
+    memset(batch, 0, sizeof(*batch));
+
+    batch->shader = LoadShaderFromMemory(trace_vertex_shader, beam_fragment_shader);
+    if (batch->shader.id == 0)
+    {
+        TraceLog(LOG_ERROR, "Could not compile the trace shader");
+        return -1;
+    }
+    batch->resolution_loc = GetShaderLocation(batch->shader, "resolution");
+    batch->sigma_loc = GetShaderLocation(batch->shader, "sigma");
+    batch->scale_loc = GetShaderLocation(batch->shader, "scale");
+
+    return 0;
+}
+
+void unload_trace_batch(trace_batch_t *batch)
+{
+    if (batch->vao != 0)
+    {
+        rlUnloadVertexBuffer(batch->vbo);
+        rlUnloadVertexArray(batch->vao);
+    }
+    UnloadShader(batch->shader);
+    MemFree(batch->vertices);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void trace_batch_reserve(trace_batch_t *batch, int vertexCount)
+{
+    /*
+    Makes sure vertexCount more vertices fit in the batch. Storage only ever grows, so
+    after the first few frames at a given sample rate this does nothing.
+    */
+    int needed = batch->count + vertexCount;
+    if (needed <= batch->capacity)
+        return;
+
+    int capacity = batch->capacity > 0 ? batch->capacity : 4096;
+    while (capacity < needed)
+        capacity *= 2;
+
+    trace_vertex_t *vertices = (trace_vertex_t *)MemAlloc(capacity * sizeof(trace_vertex_t));
+    if (batch->count > 0)
+        memcpy(vertices, batch->vertices, batch->count * sizeof(trace_vertex_t));
+    MemFree(batch->vertices);
+    batch->vertices = vertices;
+    batch->capacity = capacity;
+
+    // GL buffers can't be resized in place, so make a new one of the new size.
+    if (batch->vao != 0)
+    {
+        rlUnloadVertexBuffer(batch->vbo);
+        rlUnloadVertexArray(batch->vao);
+    }
+    batch->vao = rlLoadVertexArray();
+    rlEnableVertexArray(batch->vao);
+    batch->vbo = rlLoadVertexBuffer(NULL, capacity * sizeof(trace_vertex_t), true);
+    rlSetVertexAttribute(0, 4, RL_FLOAT, false, sizeof(trace_vertex_t), (void *)0);
+    rlEnableVertexAttribute(0);
+    rlSetVertexAttribute(1, 2, RL_FLOAT, false, sizeof(trace_vertex_t), (void *)(4 * sizeof(float)));
+    rlEnableVertexAttribute(1);
+    rlDisableVertexArray();
+}
+
+void trace_batch_push_line(trace_batch_t *batch, Vector2 a, Vector2 b, float energy)
+{
+    /*
+    Appends a straight piece of the trace from a to b that receives `energy`.
+    The caller has to trace_batch_reserve room for it first.
+    */
+    if (batch->count + TRACE_VERTICES_PER_QUAD > batch->capacity)
+        return;
+
+    trace_vertex_t *v = batch->vertices + batch->count;
+    for (int corner = 0; corner < TRACE_VERTICES_PER_QUAD; corner++)
+        v[corner] = (trace_vertex_t){a.x, a.y, b.x, b.y, (float)corner, energy};
+    batch->count += TRACE_VERTICES_PER_QUAD;
+}
+
+void trace_batch_push_bezier(trace_batch_t *batch, Vector2 start, Vector2 end, Vector2 startControl, Vector2 endControl, int divisions, float energy)
+{
+    /*
+    Same curve as raylib's DrawLineBezierCubic, split into `divisions` straight pieces
+    that share `energy` between them.
+    */
+    Vector2 previous = start;
+
+    for (int i = 1; i <= divisions; i++)
+    {
+        float t = (float)i / divisions;
+        float a = (1.0f - t) * (1.0f - t) * (1.0f - t);
+        float b = 3.0f * (1.0f - t) * (1.0f - t) * t;
+        float c = 3.0f * (1.0f - t) * t * t;
+        float d = t * t * t;
+
+        Vector2 current = {
+            a * start.x + b * startControl.x + c * endControl.x + d * end.x,
+            a * start.y + b * startControl.y + c * endControl.y + d * end.y};
+
+        trace_batch_push_line(batch, previous, current, energy / divisions);
+        previous = current;
+    }
+}
+
+void draw_trace_batch(trace_batch_t *batch, const beam_t *beam)
+{
+    /*
+    Uploads every vertex pushed since the last call and draws them with a single draw call
+    into whatever target is currently bound (e.g. inside BeginTextureMode).
+    */
+    if (batch->count == 0)
+        return;
+    ZONE_BEGIN(zone, "draw_trace_batch");
+
+    // Anything raylib still has queued (e.g. the background) has to land before the trace.
+    rlDrawRenderBatchActive();
+
+    float resolution[2] = {(float)beam->width, (float)beam->height};
+
+    rlEnableShader(batch->shader.id);
+    rlSetUniform(batch->resolution_loc, resolution, RL_SHADER_UNIFORM_VEC2, 1);
+    rlSetUniform(batch->sigma_loc, &beam->sigma, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(batch->scale_loc, &beam->scale, RL_SHADER_UNIFORM_FLOAT, 1);
+
+    rlEnableVertexArray(batch->vao);
+    rlUpdateVertexBuffer(batch->vbo, batch->vertices, batch->count * sizeof(trace_vertex_t), 0);
+    rlDrawVertexArray(0, batch->count);
+    rlDisableVertexArray();
+    rlDisableShader();
+
+    batch->count = 0;
+    ZONE_END(zone);
+}
+
+// Shader interpolation
+// Compiled with STREAMED defined to read the samples from a region of trace_shader_t.stream.
+static const char *interpolation_vertex_shader =
+    "#ifdef STREAMED\n"
+    "uniform samplerBuffer samples;\n" // R32F, one plane after the other, see sample_window_t
+    "uniform int base;\n"              // First sample of the region
+    "#else\n"
+    "uniform sampler2D samples;\n" // R32F, one plane on top of the other, see sample_window_t
+    "#endif\n"
+    "uniform int planeSize;\n"
+    "uniform int segments;\n" // Of every trace
+    "uniform vec4 viewports[" XSTRINGIFY(MAX_TRACES) "];\n" // x, y, width and height of every trace, see trace_map_t
+    "uniform int zPlanes[" XSTRINGIFY(MAX_TRACES) "];\n"    // -1 for traces without Z
+    "uniform int interpolation;\n"
+    "uniform float energy;\n" // Of every piece, i.e. of one sample divided by interpolation
+    BEAM_VERTEX_COMMON
+    "float sample_at(int j)\n"
+    "{\n"
+    "#ifdef STREAMED\n"
+    "    return texelFetch(samples, base + j).r;\n"
+    "#else\n"
+    "    return texelFetch(samples, ivec2(j % " XSTRINGIFY(SAMPLE_TEXTURE_WIDTH) ", j / " XSTRINGIFY(SAMPLE_TEXTURE_WIDTH) "), 0).r;\n"
+    "#endif\n"
+    "}\n"
+    "vec2 fetch(int trace, int i)\n"
+    "{\n"
+    "    int j = 2 * trace * planeSize + i;\n"
+    "    vec2 value = vec2(sample_at(j), sample_at(j + planeSize));\n"
+    "    return viewports[trace].xy + clamp((value + 1.0) / 2.0, 0.0, 1.0) * viewports[trace].zw;\n"
+    "}\n"
+    "float brightness(int trace, int i)\n"
+    "{\n"
+    "    return zPlanes[trace] < 0 ? 1.0 : clamp(sample_at(zPlanes[trace] * planeSize + i), 0.0, 1.0);\n"
+    "}\n"
+    // Uniform Catmull-Rom spline through p1 and p2
+    "vec2 catmull_rom(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float t)\n"
+    "{\n"
+    "    return 0.5 * (2.0 * p1 + (p2 - p0) * t + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * t * t + (3.0 * p1 - p0 - 3.0 * p2 + p3) * t * t * t);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    // Every piece is two triangles, every segment between two samples is `interpolation` pieces,
+    // the traces come one after the other.
+    "    int piece = gl_VertexID / " XSTRINGIFY(TRACE_VERTICES_PER_QUAD) ";\n"
+    "    int corner = gl_VertexID % " XSTRINGIFY(TRACE_VERTICES_PER_QUAD) ";\n"
+    "    int trace = piece / (segments * interpolation);\n"
+    "    piece = piece % (segments * interpolation);\n"
+    "    int segment = piece / interpolation + 1;\n"
+    "    piece = piece % interpolation;\n"
+    // Z goes linearly from one sample to the next, a blanked piece collapses off screen
+    // so it costs no fill at all.
+    "    float z = mix(brightness(trace, segment), brightness(trace, segment + 1), (float(piece) + 0.5) / float(interpolation));\n"
+    "    if (z <= 0.0)\n"
+    "    {\n"
+    "        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec2 p0 = fetch(trace, segment - 1);\n"
+    "    vec2 p1 = fetch(trace, segment);\n"
+    "    vec2 p2 = fetch(trace, segment + 1);\n"
+    "    vec2 p3 = fetch(trace, segment + 2);\n"
+    "    vec2 a = catmull_rom(p0, p1, p2, p3, float(piece) / float(interpolation));\n"
+    "    vec2 b = catmull_rom(p0, p1, p2, p3, float(piece + 1) / float(interpolation));\n"
+    "    emit_beam(a, b, corner, energy * z);\n"
+    "}\n";
+
+int init_trace_shader(trace_shader_t *trace, int planes, int planeSize)
+{
+    /*
+    Compiles the interpolation shader and allocates the sample texture or stream for sample
+    windows of planes planes of planeSize. Has to be called after InitWindow since it needs
+    a GL context. Returns 0 on success.
+    */
+    memset(trace, 0, sizeof(*trace));
+    trace->planes = planes;
+    trace->plane_size = planeSize;
+
+    if (rlGetVersion() < RL_OPENGL_33)
+    {
+        TraceLog(LOG_WARNING, "Interpolating on the GPU needs OpenGL 3.3");
+        return -1;
+    }
+
+    int streamed = init_sample_stream(trace) == 0;
+
+    // Same fragment stage as the batched path, so both backends look the same.
+    const char *header = streamed ? "#version 330\n#define STREAMED\n" : "#version 330\n";
+    char *source = malloc(strlen(header) + strlen(interpolation_vertex_shader) + 1);
+    if (source == NULL)
+    {
+        unload_trace_shader(trace);
+        return -1;
+    }
+    strcpy(source, header);
+    strcat(source, interpolation_vertex_shader);
+    trace->shader = LoadShaderFromMemory(source, beam_fragment_shader);
+    free(source);
+    if (trace->shader.id == 0)
+    {
+        TraceLog(LOG_ERROR, "Could not compile the interpolation shader");
+        unload_trace_shader(trace);
+        return -1;
+    }
+    trace->samples_loc = GetShaderLocation(trace->shader, "samples");
+    trace->base_loc = GetShaderLocation(trace->shader, "base");
+    trace->plane_size_loc = GetShaderLocation(trace->shader, "planeSize");
+    trace->segments_loc = GetShaderLocation(trace->shader, "segments");
+    trace->viewports_loc = GetShaderLocation(trace->shader, "viewports");
+    trace->z_planes_loc = GetShaderLocation(trace->shader, "zPlanes");
+    trace->interpolation_loc = GetShaderLocation(trace->shader, "interpolation");
+    trace->energy_loc = GetShaderLocation(trace->shader, "energy");
+    trace->resolution_loc = GetShaderLocation(trace->shader, "resolution");
+    trace->sigma_loc = GetShaderLocation(trace->shader, "sigma");
+    trace->scale_loc = GetShaderLocation(trace->shader, "scale");
+
+    if (!streamed)
+        trace->sample_texture = rlLoadTexture(NULL, SAMPLE_TEXTURE_WIDTH, planes * planeSize / SAMPLE_TEXTURE_WIDTH, RL_PIXELFORMAT_UNCOMPRESSED_R32, 1);
+    trace->vao = rlLoadVertexArray();
+    if ((!streamed && trace->sample_texture == 0) || trace->vao == 0)
+    {
+        TraceLog(LOG_ERROR, "Could not allocate the sample texture");
+        unload_trace_shader(trace);
+        return -1;
+    }
+
+    return 0;
+}
+
+void unload_trace_shader(trace_shader_t *trace)
+{
+#if defined(STREAM_SAMPLES)
+    for (int i = 0; i < STREAM_REGIONS; i++)
+    {
+        if (trace->fences[i] != NULL)
+            glDeleteSync(trace->fences[i]);
+    }
+    // Deleting the buffer unmaps it as well.
+    if (trace->stream_texture != 0)
+        glDeleteTextures(1, &trace->stream_texture);
+    if (trace->stream_buffer != 0)
+        glDeleteBuffers(1, &trace->stream_buffer);
+#endif
+    if (trace->vao != 0)
+        rlUnloadVertexArray(trace->vao);
+    if (trace->sample_texture != 0)
+        rlUnloadTexture(trace->sample_texture);
+    if (trace->shader.id != 0)
+        UnloadShader(trace->shader);
+    memset(trace, 0, sizeof(*trace));
+}
+
+void draw_trace_shader(trace_shader_t *trace, const sample_window_t *window, const trace_map_t *map, int interpolation, const beam_t *beam)
+{
+    /*
+    Uploads the samples of window and draws every segment that has both of its neighbours
+    in the window, i.e. all of them but the first and the last two, of every trace into
+    its viewport with one draw call.
+    */
+    int segments = window->count - WINDOW_HISTORY;
+    if (segments <= 0)
+        return;
+    ZONE_BEGIN(zone, "draw_trace_shader");
+
+    if (trace->stream != NULL)
+    {
+        // Normally the window already is in the current region, it only has to be copied
+        // there if it was filled before switching to this backend, or by a chain of rxyo.h.
+        float *region = trace_shader_stream(trace);
+        if (window->plane[0] != region)
+        {
+            for (int plane = 0; plane < trace->planes; plane++)
+                memcpy(region + plane * trace->plane_size, window->plane[plane], window->count * sizeof(float));
+        }
+    }
+    else
+    {
+        // Only upload the rows of each plane that hold samples.
+        int rows = (window->count + SAMPLE_TEXTURE_WIDTH - 1) / SAMPLE_TEXTURE_WIDTH;
+        for (int plane = 0; plane < trace->planes; plane++)
+            rlUpdateTexture(trace->sample_texture, 0, plane * trace->plane_size / SAMPLE_TEXTURE_WIDTH, SAMPLE_TEXTURE_WIDTH, rows, RL_PIXELFORMAT_UNCOMPRESSED_R32, window->plane[plane]);
+    }
+
+    rlDrawRenderBatchActive();
+
+    int base = trace->region * trace->planes * trace->plane_size;
+    int texture_slot = 0;
+    float energy = beam->energy / interpolation;
+    float resolution[2] = {(float)beam->width, (float)beam->height};
+
+    rlEnableShader(trace->shader.id);
+    rlSetUniform(trace->samples_loc, &texture_slot, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(trace->base_loc, &base, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(trace->plane_size_loc, &trace->plane_size, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(trace->segments_loc, &segments, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(trace->viewports_loc, map->viewports, RL_SHADER_UNIFORM_VEC4, map->count);
+    rlSetUniform(trace->z_planes_loc, map->z_planes, RL_SHADER_UNIFORM_INT, map->count);
+    rlSetUniform(trace->interpolation_loc, &interpolation, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(trace->energy_loc, &energy, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(trace->resolution_loc, resolution, RL_SHADER_UNIFORM_VEC2, 1);
+    rlSetUniform(trace->sigma_loc, &beam->sigma, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(trace->scale_loc, &beam->scale, RL_SHADER_UNIFORM_FLOAT, 1);
+
+    rlActiveTextureSlot(texture_slot);
+#if defined(STREAM_SAMPLES)
+    if (trace->stream != NULL)
+        glBindTexture(GL_TEXTURE_BUFFER, trace->stream_texture);
+    else
+#endif
+        rlEnableTexture(trace->sample_texture);
+    rlEnableVertexArray(trace->vao);
+    rlDrawVertexArray(0, map->count * segments * interpolation * TRACE_VERTICES_PER_QUAD);
+    rlDisableVertexArray();
+#if defined(STREAM_SAMPLES)
+    if (trace->stream != NULL)
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        // The region can be written again once the GPU is past this draw.
+        trace->fences[trace->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        trace->region = (trace->region + 1) % STREAM_REGIONS;
+    }
+    else
+#endif
+        rlDisableTexture();
+    rlDisableShader();
+    ZONE_END(zone);
+}
+
+int init_sample_stream(trace_shader_t *trace)
+{
+    /*
+    Creates the persistently mapped buffer of trace->stream and the buffer texture the shader
+    reads it through. Returns 0 on success, -1 if the GL can't do it and the samples have to be
+    uploaded instead.
+    */
+#if defined(STREAM_SAMPLES)
+    GLint major = 0, minor = 0, extensions = 0, max_texels = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    int supported = major > 4 || (major == 4 && minor >= 4);
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions && !supported; i++)
+        supported = strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0;
+
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    GLint region_size = trace->planes * trace->plane_size;
+    if (!supported || max_texels / STREAM_REGIONS < region_size)
+    {
+        TraceLog(LOG_INFO, "Persistently mapped buffers are not available, uploading the samples instead");
+        return -1;
+    }
+
+    // The sample window reads its last samples and the zeros it fills in back, so ask for
+    // the buffer to be kept in memory that is quick for the CPU to read as well.
+    GLsizeiptr size = (GLsizeiptr)STREAM_REGIONS * region_size * sizeof(float);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &trace->stream_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, trace->stream_buffer);
+    glBufferStorage(GL_TEXTURE_BUFFER, size, NULL, flags | GL_CLIENT_STORAGE_BIT);
+    trace->stream = glMapBufferRange(GL_TEXTURE_BUFFER, 0, size, flags);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    if (trace->stream == NULL)
+    {
+        TraceLog(LOG_WARNING, "Could not map the sample stream, uploading the samples instead");
+        glDeleteBuffers(1, &trace->stream_buffer);
+        trace->stream_buffer = 0;
+        return -1;
+    }
+
+    glGenTextures(1, &trace->stream_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, trace->stream_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, trace->stream_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    return 0;
+#else
+    (void)trace;
+    return -1;
+#endif
+}
+
+float *trace_shader_stream(trace_shader_t *trace)
+{
+    /*
+    The region of trace->stream the next window goes into, once the GPU is done drawing
+    what it held. Returns NULL if the samples are uploaded instead.
+    */
+    if (trace->stream == NULL)
+        return NULL;
+
+#if defined(STREAM_SAMPLES)
+    GLsync fence = trace->fences[trace->region];
+    if (fence != NULL)
+    {
+        // With STREAM_REGIONS regions this was drawn two frames ago, so it hardly ever waits.
+        ZONE_BEGIN(zone, "stream_fence");
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        ZONE_END(zone);
+        glDeleteSync(fence);
+        trace->fences[trace->region] = NULL;
+    }
+#endif
+
+    return trace->stream + trace->region * trace->planes * trace->plane_size;
+}
+
+// Software rasterizer
+int init_software(software_t *software, int width, int height, int threads)
+{
+    /*
+    Allocates the buffers and starts threads - 1 helper threads, the thread calling
+    draw_software is the last one. Needs no GL context. Returns 0 on success.
+    */
+    memset(software, 0, sizeof(*software));
+
+    software->width = width;
+    software->height = height;
+    software->tiles_x = (width + SOFTWARE_TILE - 1) / SOFTWARE_TILE;
+    software->tiles_y = (height + SOFTWARE_TILE - 1) / SOFTWARE_TILE;
+
+    int tiles = software->tiles_x * software->tiles_y;
+    software->energy = calloc((size_t)width * height, sizeof(float));
+    software->pixels = calloc((size_t)width * height, 4);
+    software->tile_start = calloc(tiles + 1, sizeof(int));
+    software->tile_cursor = calloc(tiles, sizeof(int));
+    if (software->energy == NULL || software->pixels == NULL ||
+        software->tile_start == NULL || software->tile_cursor == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not allocate the software rasterizer");
+        unload_software(software);
+        return -1;
+    }
+
+    pthread_mutex_init(&software->lock, NULL);
+    pthread_cond_init(&software->start, NULL);
+    pthread_cond_init(&software->done, NULL);
+    software->initialized = TRUE;
+
+    if (threads > SOFTWARE_MAX_THREADS + 1)
+        threads = SOFTWARE_MAX_THREADS + 1;
+    for (int i = 0; i < threads - 1; i++)
+    {
+        // Drawing just gets slower with fewer threads.
+        if (pthread_create(&software->threads[software->thread_count], NULL, software_thread, software) != 0)
+        {
+            TraceLog(LOG_WARNING, "Could not start more than %d software rasterizer threads", software->thread_count);
+            break;
+        }
+        software->thread_count++;
+    }
+
+    return 0;
+}
+
+int resize_software(software_t *software, int width, int height)
+{
+    /*
+    Reallocates the buffers for width x height between two frames, the helper threads keep
+    running. The energy starts out empty. Returns 0 on success, the old size is kept otherwise.
+    */
+    if (width == software->width && height == software->height)
+        return 0;
+
+    int tiles_x = (width + SOFTWARE_TILE - 1) / SOFTWARE_TILE;
+    int tiles_y = (height + SOFTWARE_TILE - 1) / SOFTWARE_TILE;
+    float *energy = calloc((size_t)width * height, sizeof(float));
+    unsigned char *pixels = calloc((size_t)width * height, 4);
+    int *tile_start = calloc(tiles_x * tiles_y + 1, sizeof(int));
+    int *tile_cursor = calloc(tiles_x * tiles_y, sizeof(int));
+    if (energy == NULL || pixels == NULL || tile_start == NULL || tile_cursor == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not allocate the software rasterizer for %dx%d", width, height);
+        free(tile_cursor);
+        free(tile_start);
+        free(pixels);
+        free(energy);
+        return -1;
+    }
+
+    free(software->tile_cursor);
+    free(software->tile_start);
+    free(software->pixels);
+    free(software->energy);
+    software->energy = energy;
+    software->pixels = pixels;
+    software->tile_start = tile_start;
+    software->tile_cursor = tile_cursor;
+    software->width = width;
+    software->height = height;
+    software->tiles_x = tiles_x;
+    software->tiles_y = tiles_y;
+    return 0;
+}
+
+void unload_software(software_t *software)
+{
+    if (software->initialized)
+    {
+        pthread_mutex_lock(&software->lock);
+        software->quit = TRUE;
+        pthread_cond_broadcast(&software->start);
+        pthread_mutex_unlock(&software->lock);
+
+        for (int i = 0; i < software->thread_count; i++)
+            pthread_join(software->threads[i], NULL);
+
+        pthread_cond_destroy(&software->done);
+        pthread_cond_destroy(&software->start);
+        pthread_mutex_destroy(&software->lock);
+    }
+    free(software->tile_pieces);
+    free(software->tile_cursor);
+    free(software->tile_start);
+    free(software->pieces);
+    free(software->pixels);
+    free(software->energy);
+    memset(software, 0, sizeof(*software));
+}
+
+void reset_software(software_t *software)
+{
+    /*
+    Clears the energy accumulated so far.
+    */
+    memset(software->energy, 0, (size_t)software->width * software->height * sizeof(float));
+}
+
+void software_push_piece(software_t *software, Vector2 a, Vector2 b, float energy)
+{
+    /*
+    Queues the piece of the trace from a to b for the next draw_software.
+    */
+    if (software->piece_count == software->piece_capacity)
+    {
+        int capacity = software->piece_capacity > 0 ? software->piece_capacity * 2 : 4096;
+        ALLOW_ALLOCATIONS();
+        software_piece_t *pieces = realloc(software->pieces, capacity * sizeof(software_piece_t));
+        FORBID_ALLOCATIONS();
+        if (pieces == NULL)
+            return;
+        software->pieces = pieces;
+        software->piece_capacity = capacity;
+    }
+    software->pieces[software->piece_count++] = (software_piece_t){a.x, a.y, b.x, b.y, energy};
+}
+
+int software_bin(software_t *software)
+{
+    /*
+    Sorts the queued pieces into the tiles their quads overlap, a piece that overlaps a few tiles
+    is drawn by each of them. Returns 0 on success.
+    */
+    int tiles = software->tiles_x * software->tiles_y;
+    float radius = BEAM_RADIUS * software->beam.sigma;
+
+    // First count the pieces of every tile, then make room for them and fill the bins in.
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 0)
+            memset(software->tile_cursor, 0, tiles * sizeof(int));
+
+        for (int i = 0; i < software->piece_count; i++)
+        {
+            const software_piece_t *piece = &software->pieces[i];
+            int tx0 = (int)clamp((fminf(piece->ax, piece->bx) - radius) / SOFTWARE_TILE, 0.0f, software->tiles_x - 1);
+            int tx1 = (int)clamp((fmaxf(piece->ax, piece->bx) + radius) / SOFTWARE_TILE, 0.0f, software->tiles_x - 1);
+            int ty0 = (int)clamp((fminf(piece->ay, piece->by) - radius) / SOFTWARE_TILE, 0.0f, software->tiles_y - 1);
+            int ty1 = (int)clamp((fmaxf(piece->ay, piece->by) + radius) / SOFTWARE_TILE, 0.0f, software->tiles_y - 1);
+
+            for (int ty = ty0; ty <= ty1; ty++)
+            {
+                for (int tx = tx0; tx <= tx1; tx++)
+                {
+                    int tile = ty * software->tiles_x + tx;
+                    if (pass == 1)
+                        software->tile_pieces[software->tile_cursor[tile]] = i;
+                    software->tile_cursor[tile]++;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            int total = 0;
+            for (int tile = 0; tile < tiles; tile++)
+            {
+                software->tile_start[tile] = total;
+                total += software->tile_cursor[tile];
+                software->tile_cursor[tile] = software->tile_start[tile];
+            }
+            software->tile_start[tiles] = total;
+
+            if (total > software->tile_piece_capacity)
+            {
+                ALLOW_ALLOCATIONS();
+                int *tile_pieces = realloc(software->tile_pieces, total * sizeof(int));
+                FORBID_ALLOCATIONS();
+                if (tile_pieces == NULL)
+                    return -1;
+                software->tile_pieces = tile_pieces;
+                software->tile_piece_capacity = total;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void draw_software(software_t *software, const sample_window_t *window, const trace_map_t *map, int interpolation,
+                   const beam_t *beam, float decay, float exposure, Color background, Color foreground)
+{
+    /*
+    Decays the energy by decay, draws the same pieces as draw_trace_shader on top and tone maps
+    the result into software->pixels, sharing the tiles between every thread.
+    */
+    float energy = beam->energy / interpolation;
+
+    software->beam = *beam;
+    software->decay = decay;
+    software->exposure = exposure;
+    software->background = background;
+    software->foreground = foreground;
+    software->piece_count = 0;
+
+    // Uniform Catmull-Rom spline through every segment that has both of its neighbours,
+    // exactly like interpolation_vertex_shader.
+    for (int trace = 0; trace < map->count; trace++)
+    {
+        const float *xs = window->plane[2 * trace];
+        const float *ys = window->plane[2 * trace + 1];
+        const float *zs = map->z_planes[trace] >= 0 ? window->plane[map->z_planes[trace]] : NULL;
+        Rectangle viewport = map->viewports[trace];
+
+        for (int segment = 1; segment < window->count - WINDOW_HISTORY + 1; segment++)
+        {
+            Vector2 p[4];
+            for (int j = 0; j < 4; j++)
+            {
+                p[j].x = viewport.x + clamp((xs[segment - 1 + j] + 1.0f) / 2.0f, 0.0f, 1.0f) * viewport.width;
+                p[j].y = viewport.y + clamp((ys[segment - 1 + j] + 1.0f) / 2.0f, 0.0f, 1.0f) * viewport.height;
+            }
+
+            Vector2 previous = p[1];
+            for (int piece = 1; piece <= interpolation; piece++)
+            {
+                float t = (float)piece / interpolation;
+                Vector2 current = {
+                    0.5f * (2.0f * p[1].x + (p[2].x - p[0].x) * t + (2.0f * p[0].x - 5.0f * p[1].x + 4.0f * p[2].x - p[3].x) * t * t + (3.0f * p[1].x - p[0].x - 3.0f * p[2].x + p[3].x) * t * t * t),
+                    0.5f * (2.0f * p[1].y + (p[2].y - p[0].y) * t + (2.0f * p[0].y - 5.0f * p[1].y + 4.0f * p[2].y - p[3].y) * t * t + (3.0f * p[1].y - p[0].y - 3.0f * p[2].y + p[3].y) * t * t * t)};
+
+                float z = 1.0f;
+                if (zs != NULL)
+                {
+                    float z1 = clamp(zs[segment], 0.0f, 1.0f);
+                    float z2 = clamp(zs[segment + 1], 0.0f, 1.0f);
+                    z = z1 + (z2 - z1) * ((piece - 0.5f) / interpolation);
+                }
+                if (z > 0.0f)
+                    software_push_piece(software, previous, current, energy * z);
+                previous = current;
+            }
+        }
+    }
+
+    // Without the bins only the decay and the tone mapping happen.
+    ZONE_BEGIN(bin_zone, "software_bin");
+    int binned = software_bin(software);
+    ZONE_END(bin_zone);
+    if (binned != 0)
+        memset(software->tile_start, 0, (software->tiles_x * software->tiles_y + 1) * sizeof(int));
+
+    atomic_store(&software->next_tile, 0);
+
+    pthread_mutex_lock(&software->lock);
+    software->busy = software->thread_count;
+    software->generation++;
+    pthread_cond_broadcast(&software->start);
+    pthread_mutex_unlock(&software->lock);
+
+    software_run(software);
+
+    pthread_mutex_lock(&software->lock);
+    while (software->busy > 0)
+        pthread_cond_wait(&software->done, &software->lock);
+    pthread_mutex_unlock(&software->lock);
+}
+
+void software_run(software_t *software)
+{
+    /*
+    Draws tiles until there are none left, called by every thread.
+    */
+    int tiles = software->tiles_x * software->tiles_y;
+    int tile;
+    ZONE_BEGIN(zone, "software_run");
+    while ((tile = atomic_fetch_add(&software->next_tile, 1)) < tiles)
+        software_tile(software, tile);
+    ZONE_END(zone);
+}
+
+void *software_thread(void *arg)
+{
+    /*
+    Helper thread of the software rasterizer, helps with every frame until unload_software.
+    */
+    software_t *software = arg;
+    int generation = 0;
+
+    pthread_mutex_lock(&software->lock);
+    for (;;)
+    {
+        while (software->generation == generation && !software->quit)
+            pthread_cond_wait(&software->start, &software->lock);
+        if (software->quit)
+            break;
+        generation = software->generation;
+        pthread_mutex_unlock(&software->lock);
+
+        FORBID_ALLOCATIONS();
+        software_run(software);
+        ALLOW_ALLOCATIONS();
+
+        pthread_mutex_lock(&software->lock);
+        if (--software->busy == 0)
+            pthread_cond_signal(&software->done);
+    }
+    pthread_mutex_unlock(&software->lock);
+
+    return NULL;
+}
+
+float software_erf(float x)
+{
+    /*
+    Same approximation as erf_approx in beam_fragment_shader.
+    */
+    float t = 1.0f / (1.0f + 0.3275911f * fabsf(x));
+    float y = 1.0f - t * (0.254829592f + t * (-0.284496736f + t * (1.421413741f + t * (-1.453152027f + t * 1.061405429f)))) * expf(-x * x);
+    return x < 0.0f ? -y : y;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+__m256 software_exp8(__m256 x)
+{
+    /*
+    e^x for x <= 0, the same range reduction and polynomial as Cephes' expf.
+    */
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504089f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(_mm256_mul_ps(p, r), r, _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    // 2^n straight into the exponent bits
+    __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+__m256 software_erf8(__m256 x)
+{
+    /*
+    software_erf on 8 values at once.
+    */
+    __m256 sign = _mm256_and_ps(x, _mm256_set1_ps(-0.0f));
+    __m256 a = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+    __m256 t = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(a, _mm256_set1_ps(0.3275911f), _mm256_set1_ps(1.0f)));
+
+    __m256 p = _mm256_set1_ps(1.061405429f);
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-1.453152027f));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(1.421413741f));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-0.284496736f));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(0.254829592f));
+    p = _mm256_mul_ps(p, t);
+
+    __m256 y = _mm256_fnmadd_ps(p, software_exp8(_mm256_mul_ps(_mm256_mul_ps(a, a), _mm256_set1_ps(-1.0f))), _mm256_set1_ps(1.0f));
+    return _mm256_or_ps(y, sign);
+}
+#endif
+
+void software_splat_span(float *row, int x0, int x1, float py, const software_splat_t *splat)
+{
+    /*
+    Adds the energy of splat to pixels x0 up to (excluding) x1 of the energy row at py, eight
+    pixels at a time with AVX2 and FMA.
+    */
+    float qy = py - splat->ay;
+    int x = x0;
+
+#if defined(__AVX2__) && defined(__FMA__)
+    const __m256 steps = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 ux = _mm256_set1_ps(splat->ux);
+    const __m256 uy = _mm256_set1_ps(splat->uy);
+    const __m256 falloff = _mm256_set1_ps(-splat->falloff);
+    const __m256 weight = _mm256_set1_ps(splat->weight);
+    const __m256 qy_ux = _mm256_set1_ps(qy * splat->ux);
+    const __m256 qy_uy = _mm256_set1_ps(qy * splat->uy);
+
+    for (; x + 8 <= x1; x += 8)
+    {
+        __m256 qx = _mm256_add_ps(_mm256_set1_ps((float)x - splat->ax), steps);
+        __m256 along = _mm256_fmadd_ps(qx, ux, qy_uy);
+        __m256 across = _mm256_fnmadd_ps(qx, uy, qy_ux);
+
+        __m256 value;
+        if (splat->line)
+        {
+            __m256 inv = _mm256_set1_ps(splat->inverse);
+            __m256 spread = _mm256_sub_ps(software_erf8(_mm256_mul_ps(along, inv)),
+                                          software_erf8(_mm256_mul_ps(_mm256_sub_ps(along, _mm256_set1_ps(splat->length)), inv)));
+            value = _mm256_mul_ps(software_exp8(_mm256_mul_ps(_mm256_mul_ps(across, across), falloff)), spread);
+        }
+        else
+        {
+            __m256 distance = _mm256_fmadd_ps(across, across, _mm256_mul_ps(along, along));
+            value = software_exp8(_mm256_mul_ps(distance, falloff));
+        }
+        _mm256_storeu_ps(row + x, _mm256_fmadd_ps(value, weight, _mm256_loadu_ps(row + x)));
+    }
+#endif
+
+    for (; x < x1; x++)
+    {
+        float qx = (float)x + 0.5f - splat->ax;
+        float along = qx * splat->ux + qy * splat->uy;
+        float across = qy * splat->ux - qx * splat->uy;
+
+        float value;
+        if (splat->line)
+            value = expf(-splat->falloff * across * across) *
+                    (software_erf(along * splat->inverse) - software_erf((along - splat->length) * splat->inverse));
+        else
+            value = expf(-splat->falloff * (across * across + along * along));
+        row[x] += value * splat->weight;
+    }
+}
+
+int software_span(const software_splat_t *splat, float py, float radius, int x0, int x1, int *start, int *end)
+{
+    /*
+    Narrows x0 up to x1 down to the pixels of the row at py whose centres are inside the quad
+    emit_beam would draw around the piece. Returns FALSE if there are none.
+    */
+    float qy = py - splat->ay;
+    float lo = -INFINITY, hi = INFINITY; // Range of x - ax
+
+    // -radius <= along <= length + radius, along = qx * ux + qy * uy
+    if (fabsf(splat->ux) > 1e-6f)
+    {
+        float a = (-radius - qy * splat->uy) / splat->ux;
+        float b = (splat->length + radius - qy * splat->uy) / splat->ux;
+        lo = fmaxf(lo, fminf(a, b));
+        hi = fminf(hi, fmaxf(a, b));
+    }
+    else if (fabsf(qy * splat->uy) > splat->length + radius)
+        return FALSE;
+
+    // -radius <= across <= radius, across = qy * ux - qx * uy
+    if (fabsf(splat->uy) > 1e-6f)
+    {
+        float a = (qy * splat->ux - radius) / splat->uy;
+        float b = (qy * splat->ux + radius) / splat->uy;
+        lo = fmaxf(lo, fminf(a, b));
+        hi = fminf(hi, fmaxf(a, b));
+    }
+    else if (fabsf(qy * splat->ux) > radius)
+        return FALSE;
+
+    // Pixel x is centred at x + 0.5
+    float first = ceilf(splat->ax + lo - 0.5f);
+    float last = floorf(splat->ax + hi - 0.5f);
+    *start = first > (float)x0 ? (int)first : x0;
+    *end = last < (float)(x1 - 1) ? (int)last + 1 : x1;
+    return *start < *end;
+}
+
+void software_tile(software_t *software, int tile)
+{
+    /*
+    Decays, draws and tone maps one tile. Every tile only ever touches its own pixels,
+    so any number of them can be drawn at the same time.
+    */
+    const beam_t *beam = &software->beam;
+    int x0 = (tile % software->tiles_x) * SOFTWARE_TILE;
+    int y0 = (tile / software->tiles_x) * SOFTWARE_TILE;
+    int x1 = x0 + SOFTWARE_TILE < software->width ? x0 + SOFTWARE_TILE : software->width;
+    int y1 = y0 + SOFTWARE_TILE < software->height ? y0 + SOFTWARE_TILE : software->height;
+
+    for (int y = y0; y < y1; y++)
+    {
+        float *row = software->energy + (size_t)y * software->width;
+        for (int x = x0; x < x1; x++)
+            row[x] *= software->decay;
+    }
+
+    float radius = BEAM_RADIUS * beam->sigma;
+    float peak = 0.3989422804f / beam->sigma; // 1 / (sqrt(2 pi) sigma)
+
+    for (int i = software->tile_start[tile]; i < software->tile_start[tile + 1]; i++)
+    {
+        const software_piece_t *piece = &software->pieces[software->tile_pieces[i]];
+
+        // Everything per piece that beam_fragment_shader works out per pixel
+        software_splat_t splat;
+        float dx = piece->bx - piece->ax, dy = piece->by - piece->ay;
+        splat.ax = piece->ax;
+        splat.ay = piece->ay;
+        splat.length = sqrtf(dx * dx + dy * dy);
+        splat.ux = splat.length > 0.0f ? dx / splat.length : 1.0f;
+        splat.uy = splat.length > 0.0f ? dy / splat.length : 0.0f;
+        splat.falloff = 0.5f / (beam->sigma * beam->sigma);
+        splat.inverse = 1.0f / (1.4142135624f * beam->sigma);
+        splat.line = splat.length > 1e-3f * beam->sigma;
+        splat.weight = piece->energy * beam->scale * beam->scale * peak *
+                       (splat.line ? 0.5f / splat.length : peak);
+
+        float top = fminf(piece->ay, piece->by) - radius;
+        float bottom = fmaxf(piece->ay, piece->by) + radius;
+        int row_start = (int)fmaxf(ceilf(top - 0.5f), (float)y0);
+        int row_end = (int)fminf(floorf(bottom - 0.5f) + 1.0f, (float)y1);
+
+        for (int y = row_start; y < row_end; y++)
+        {
+            int start, end;
+            if (software_span(&splat, (float)y + 0.5f, radius, x0, x1, &start, &end))
+                software_splat_span(software->energy + (size_t)y * software->width, start, end, (float)y + 0.5f, &splat);
+        }
+    }
+
+    // Same as display_fragment_shader. The top row of pixels is the bottom row of energy,
+    // like in xytexture.
+    float background[4] = {software->background.r, software->background.g, software->background.b, software->background.a};
+    float foreground[4] = {software->foreground.r, software->foreground.g, software->foreground.b, software->foreground.a};
+
+    for (int y = y0; y < y1; y++)
+    {
+        const float *row = software->energy + (size_t)y * software->width;
+        unsigned char *pixel = software->pixels + ((size_t)(software->height - 1 - y) * software->width + x0) * 4;
+
+        for (int x = x0; x < x1; x++, pixel += 4)
+        {
+            float brightness = 1.0f - expf(-software->exposure * row[x]);
+            for (int c = 0; c < 4; c++)
+                pixel[c] = (unsigned char)(background[c] + (foreground[c] - background[c]) * brightness + 0.5f);
+        }
+    }
+}
+
+// Phosphor
+static const char *decay_fragment_shader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform float decay;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    finalColor = vec4(texture(texture0, fragTexCoord).r * decay);\n"
+    "}\n";
+
+static const char *display_fragment_shader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform float exposure;\n"
+    "uniform vec4 background;\n"
+    "uniform vec4 foreground;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    // Saturates smoothly like a real phosphor instead of clipping
+    "    float brightness = 1.0 - exp(-exposure * texture(texture0, fragTexCoord).r);\n"
+    "    finalColor = mix(background, foreground, brightness);\n"
+    "}\n";
+
+int init_phosphor(phosphor_t *phosphor, int width, int height)
+{
+    /*
+    Allocates the accumulation targets and compiles the decay and display shaders.
+    Has to be called after InitWindow since it needs a GL context. Returns 0 on success.
+    */
+    memset(phosphor, 0, sizeof(*phosphor));
+
+    // NULL uses raylib's default vertex shader
+    phosphor->decay_shader = LoadShaderFromMemory(NULL, decay_fragment_shader);
+    phosphor->display_shader = LoadShaderFromMemory(NULL, display_fragment_shader);
+    if (phosphor->decay_shader.id == 0 || phosphor->display_shader.id == 0)
+    {
+        TraceLog(LOG_ERROR, "Could not compile the phosphor shaders");
+        unload_phosphor(phosphor);
+        return -1;
+    }
+    phosphor->decay_loc = GetShaderLocation(phosphor->decay_shader, "decay");
+    phosphor->exposure_loc = GetShaderLocation(phosphor->display_shader, "exposure");
+    phosphor->background_loc = GetShaderLocation(phosphor->display_shader, "background");
+    phosphor->foreground_loc = GetShaderLocation(phosphor->display_shader, "foreground");
+
+    for (int i = 0; i < 2; i++)
+    {
+        phosphor->accumulation[i] = load_float_render_texture(width, height);
+        if (phosphor->accumulation[i].id == 0)
+        {
+            unload_phosphor(phosphor);
+            return -1;
+        }
+
+    }
+
+    // Starts out with no energy anywhere.
+    reset_phosphor(phosphor);
+
+    return 0;
+}
+
+void reset_phosphor(phosphor_t *phosphor)
+{
+    /*
+    Clears the energy accumulated so far.
+    */
+    for (int i = 0; i < 2; i++)
+    {
+        BeginTextureMode(phosphor->accumulation[i]);
+        ClearBackground(BLANK);
+        EndTextureMode();
+    }
+}
+
+int resize_phosphor(phosphor_t *phosphor, int width, int height)
+{
+    /*
+    Reallocates the accumulation targets for width x height, the shaders are kept. The energy
+    starts out empty. Returns 0 on success, the old size is kept otherwise.
+    */
+    if (phosphor->accumulation[0].texture.width == width && phosphor->accumulation[0].texture.height == height)
+        return 0;
+
+    RenderTexture2D accumulation[2];
+    for (int i = 0; i < 2; i++)
+    {
+        accumulation[i] = load_float_render_texture(width, height);
+        if (accumulation[i].id == 0)
+        {
+            if (i > 0)
+            {
+                rlUnloadTexture(accumulation[0].texture.id);
+                rlUnloadFramebuffer(accumulation[0].id);
+            }
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        rlUnloadTexture(phosphor->accumulation[i].texture.id);
+        rlUnloadFramebuffer(phosphor->accumulation[i].id);
+        phosphor->accumulation[i] = accumulation[i];
+    }
+    phosphor->current = 0;
+    reset_phosphor(phosphor);
+    return 0;
+}
+
+void unload_phosphor(phosphor_t *phosphor)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (phosphor->accumulation[i].id != 0)
+        {
+            rlUnloadTexture(phosphor->accumulation[i].texture.id);
+            rlUnloadFramebuffer(phosphor->accumulation[i].id);
+        }
+    }
+    if (phosphor->decay_shader.id != 0)
+        UnloadShader(phosphor->decay_shader);
+    if (phosphor->display_shader.id != 0)
+        UnloadShader(phosphor->display_shader);
+    memset(phosphor, 0, sizeof(*phosphor));
+}
+
+RenderTexture2D load_float_render_texture(int width, int height)
+{
+    /*
+    Same as LoadRenderTexture, but with a single 32 bit float channel so energy can
+    build up past 1.0 without clipping. Returns a target with id 0 on failure.
+    */
+    RenderTexture2D target = {0};
+
+    target.id = rlLoadFramebuffer(width, height);
+    if (target.id == 0)
+        return target;
+
+    rlEnableFramebuffer(target.id);
+    target.texture.id = rlLoadTexture(NULL, width, height, RL_PIXELFORMAT_UNCOMPRESSED_R32, 1);
+    target.texture.width = width;
+    target.texture.height = height;
+    target.texture.format = PIXELFORMAT_UNCOMPRESSED_R32;
+    target.texture.mipmaps = 1;
+    rlFramebufferAttach(target.id, target.texture.id, RL_ATTACHMENT_COLOR_CHANNEL0, RL_ATTACHMENT_TEXTURE2D, 0);
+
+    if (!rlFramebufferComplete(target.id))
+    {
+        TraceLog(LOG_ERROR, "Float render targets are not supported");
+        rlUnloadTexture(target.texture.id);
+        rlUnloadFramebuffer(target.id);
+        target = (RenderTexture2D){0};
+    }
+    rlDisableFramebuffer();
+
+    return target;
+}
+
+void begin_phosphor(phosphor_t *phosphor, float decay)
+{
+    /*
+    Starts accumulating a new frame: switches to the other target, fills it with the previous
+    frame scaled by decay, and leaves additive blending on so the trace can be drawn on top.
+    */
+    RenderTexture2D *previous = &phosphor->accumulation[phosphor->current];
+    phosphor->current = 1 - phosphor->current;
+
+    ZONE_BEGIN(zone, "BeginTextureMode");
+    BeginTextureMode(phosphor->accumulation[phosphor->current]);
+    ClearBackground(BLANK);
+    BeginBlendMode(BLEND_ADD_COLORS);
+
+    if (decay > 0.0f)
+    {
+        SetShaderValue(phosphor->decay_shader, phosphor->decay_loc, &decay, SHADER_UNIFORM_FLOAT);
+        BeginShaderMode(phosphor->decay_shader);
+        // Render textures are upside down, hence the negative height.
+        DrawTextureRec(previous->texture,
+                       (Rectangle){0, 0, previous->texture.width, -previous->texture.height},
+                       (Vector2){0, 0}, WHITE);
+        EndShaderMode();
+    }
+    ZONE_END(zone);
+}
+
+void end_phosphor(phosphor_t *phosphor, RenderTexture2D *xytexture, float exposure, Color background, Color foreground)
+{
+    /*
+    Finishes the frame started by begin_phosphor and tone maps its energy to colors into xytexture.
+    */
+    RenderTexture2D *current = &phosphor->accumulation[phosphor->current];
+
+    ZONE_BEGIN(zone, "EndTextureMode");
+    EndBlendMode();
+    EndTextureMode();
+
+    Vector4 background_color = ColorNormalize(background);
+    Vector4 foreground_color = ColorNormalize(foreground);
+    SetShaderValue(phosphor->display_shader, phosphor->exposure_loc, &exposure, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(phosphor->display_shader, phosphor->background_loc, &background_color, SHADER_UNIFORM_VEC4);
+    SetShaderValue(phosphor->display_shader, phosphor->foreground_loc, &foreground_color, SHADER_UNIFORM_VEC4);
+
+    BeginTextureMode(*xytexture);
+    BeginShaderMode(phosphor->display_shader);
+    DrawTextureRec(current->texture,
+                   (Rectangle){0, 0, current->texture.width, -current->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+    ZONE_END(zone);
+}
+
+// Sample window
+int init_sample_window(sample_window_t *window, int traces, int planes, int capacity)
+{
+    /*
+    Allocates an empty window of `planes` planes for `traces` traces that takes up to capacity
+    samples on every frame. Returns 0 on success.
+    */
+    memset(window, 0, sizeof(*window));
+
+    int size = capacity + WINDOW_HISTORY;
+    window->traces = traces;
+    window->planes = planes;
+    window->plane_size = (size + SAMPLE_TEXTURE_WIDTH - 1) / SAMPLE_TEXTURE_WIDTH * SAMPLE_TEXTURE_WIDTH;
+    window->capacity = capacity;
+    window->merged = 1;
+    window->repeats = 1.0f;
+    window->storage = calloc((size_t)planes * window->plane_size, sizeof(float));
+    if (window->storage == NULL)
+    {
+        TraceLog(LOG_ERROR, "Could not allocate the sample window");
+        return -1;
+    }
+
+    return 0;
+}
+
+void unload_sample_window(sample_window_t *window)
+{
+    free(window->storage);
+    memset(window, 0, sizeof(*window));
+}
+
+void begin_sample_window(sample_window_t *window, float *planes)
+{
+    /*
+    Moves the window to `planes`, window->planes planes of plane_size samples, or to its
+    own storage if NULL. Keeps the last WINDOW_HISTORY samples of the previous window at the
+    front, the new samples go right after them.
+    */
+    int history = window->count < WINDOW_HISTORY ? window->count : WINDOW_HISTORY;
+    for (int index = 0; index < window->planes; index++)
+    {
+        float *base = planes != NULL ? planes : window->storage;
+        float *plane = base + index * window->plane_size;
+        if (history > 0)
+            memmove(plane, window->plane[index] + window->count - history, history * sizeof(float));
+        // Before the very first frame, start from the centre.
+        for (int i = history; i < WINDOW_HISTORY; i++)
+            plane[i] = 0.0f;
+        window->plane[index] = plane;
+    }
+    window->count = WINDOW_HISTORY;
+    window->merged = 1;
+    window->repeats = 1.0f;
+}
+
+void end_sample_window(sample_window_t *window, int frameCount)
+{
+    /*
+    Takes in the frameCount samples written after the history. Frames where both channels of a
+    trace are exactly 0 keep its previous position so digital silence doesn't pull it to the centre.
+    */
+    for (int trace = 0; trace < window->traces; trace++)
+    {
+        float *xs = window->plane[2 * trace];
+        float *ys = window->plane[2 * trace + 1];
+        for (int j = WINDOW_HISTORY; j < WINDOW_HISTORY + frameCount; j++)
+        {
+            if (xs[j] == 0.0f && ys[j] == 0.0f)
+            {
+                xs[j] = xs[j - 1];
+                ys[j] = ys[j - 1];
+            }
+        }
+    }
+
+    window->count = WINDOW_HISTORY + frameCount;
+}
+
+// Resolution
+void init_resolution(resolution_t *resolution)
+{
+    /*
+    Draws at the size of the window until told otherwise, with the default budget for when
+    dynamic resolution is turned on.
+    */
+    memset(resolution, 0, sizeof(*resolution));
+    resolution->scale = 1.0f;
+    resolution->current = 1.0f;
+    resolution->budget = DEFAULT_RESOLUTION_BUDGET;
+}
+
+void render_size(const opt_t *opt, float scale, int *width, int *height)
+{
+    /*
+    Size of the render targets at scale times the window, at least a pixel.
+    */
+    *width = (int)fmaxf(roundf(opt->screen_width * scale), 1.0f);
+    *height = (int)fmaxf(roundf(opt->screen_height * scale), 1.0f);
+}
+
+int init_render_targets(opt_t *opt)
+{
+    /*
+    Allocates xytexture, the phosphor targets and the software rasterizer at the render
+    resolution. Has to be called after InitWindow. Returns 0 on success, nothing needs to be
+    unloaded otherwise.
+    */
+    opt->xytexture = LoadRenderTexture(opt->render_width, opt->render_height);
+    SetTextureFilter(opt->xytexture.texture, TEXTURE_FILTER_BILINEAR);
+    if (init_phosphor(&opt->phosphor, opt->render_width, opt->render_height) != 0)
+    {
+        UnloadRenderTexture(opt->xytexture);
+        opt->xytexture = (RenderTexture2D){0};
+        return -1;
+    }
+    if (init_software(&opt->software, opt->render_width, opt->render_height, (int)sysconf(_SC_NPROCESSORS_ONLN)) != 0)
+    {
+        unload_phosphor(&opt->phosphor);
+        UnloadRenderTexture(opt->xytexture);
+        opt->xytexture = (RenderTexture2D){0};
+        return -1;
+    }
+    return 0;
+}
+
+int resize_render_targets(opt_t *opt, float scale)
+{
+    /*
+    Reallocates the render targets for scale times the window as it is now and lays the traces
+    out on them, between two frames. The glow starts over. Returns 0 on success, the old
+    targets are kept otherwise.
+    */
+    int width, height;
+    render_size(opt, scale, &width, &height);
+    if (width != opt->render_width || height != opt->render_height)
+    {
+        if (resize_software(&opt->software, width, height) != 0 ||
+            resize_phosphor(&opt->phosphor, width, height) != 0)
+        {
+            resize_software(&opt->software, opt->render_width, opt->render_height);
+            TraceLog(LOG_WARNING, "Could not draw at %dx%d, staying at %dx%d", width, height, opt->render_width, opt->render_height);
+            return -1;
+        }
+        UnloadRenderTexture(opt->xytexture);
+        opt->xytexture = LoadRenderTexture(width, height);
+        SetTextureFilter(opt->xytexture.texture, TEXTURE_FILTER_BILINEAR);
+        opt->render_width = width;
+        opt->render_height = height;
+        layout_traces(&opt->traces, width, height);
+        TraceLog(LOG_INFO, "Drawing at %dx%d", width, height);
+    }
+    opt->resolution.current = scale;
+    return 0;
+}
+
+float resolution_update(resolution_t *resolution, double seconds)
+{
+    /*
+    Takes the newest time render_trace took into account and returns the scale to draw the
+    next frame at, see resolution_t.
+    */
+    if (!resolution->dynamic)
+        return resolution->current;
+
+    // The frames still in flight were drawn at the previous scale.
+    resolution->held++;
+    if (resolution->held > LOD_QUERIES && seconds > 0.0)
+        resolution->cost = resolution->cost > 0.0 ? resolution->cost + RESOLUTION_GAIN * (seconds - resolution->cost) : seconds;
+    if (resolution->held < RESOLUTION_HOLD || resolution->cost <= 0.0)
+        return resolution->current;
+
+    // Down as far as it takes to fit the budget, up only as far as still fits with room to spare.
+    float current = resolution->current;
+    float scale = current;
+    int saving = resolution->before <= 0.0 || resolution->cost < (1.0 - RESOLUTION_MIN_SAVING) * resolution->before;
+    if (resolution->cost > resolution->budget && saving)
+        scale = floorf(current * sqrtf((float)(resolution->budget / resolution->cost)) / RESOLUTION_STEP) * RESOLUTION_STEP;
+    else
+    {
+        float up = floorf(current * sqrtf((float)(RESOLUTION_HEADROOM * resolution->budget / resolution->cost)) / RESOLUTION_STEP) * RESOLUTION_STEP;
+        if (up > current)
+            scale = up;
+    }
+    scale = clamp(scale, fminf(MIN_RESOLUTION_SCALE, resolution->scale), resolution->scale);
+
+    if (scale != current)
+    {
+        resolution->before = scale < current ? resolution->cost : 0.0;
+        resolution->held = 0;
+        resolution->cost = 0.0;
+    }
+    return scale;
+}
+
+// Trigger
+void init_trigger(trigger_t *trigger)
+{
+    /*
+    Trigger that is off and has seen nothing yet.
+    */
+    memset(trigger, 0, sizeof(*trigger));
+    init_fft(&trigger->fft, 2 * TRIGGER_SIZE);
+}
+
+double trigger_update(trigger_t *trigger, const sample_window_t *window, int frameCount)
+{
+    /*
+    Adds the frameCount new samples of the first trace of window to the recent ones and
+    returns their period in samples, or 0 if they don't repeat.
+    */
+    int count = frameCount < TRIGGER_SIZE ? frameCount : TRIGGER_SIZE;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        float *recent = trigger->recent[axis];
+        memmove(recent, recent + count, (TRIGGER_SIZE - count) * sizeof(float));
+        memcpy(recent + TRIGGER_SIZE - count, window->plane[axis] + WINDOW_HISTORY + frameCount - count, count * sizeof(float));
+    }
+    trigger->filled = trigger->filled + count < TRIGGER_SIZE ? trigger->filled + count : TRIGGER_SIZE;
+    if (trigger->filled < TRIGGER_SIZE)
+        return 0.0;
+
+    // Without the offset, which would correlate with itself at every lag.
+    double mean[2] = {0.0, 0.0};
+    for (int axis = 0; axis < 2; axis++)
+    {
+        for (int i = 0; i < TRIGGER_SIZE; i++)
+            mean[axis] += trigger->recent[axis][i];
+        mean[axis] /= TRIGGER_SIZE;
+    }
+    for (int i = 0; i < TRIGGER_SIZE; i++)
+    {
+        trigger->re[i] = trigger->recent[0][i] - (float)mean[0];
+        trigger->im[i] = trigger->recent[1][i] - (float)mean[1];
+    }
+    memset(trigger->re + TRIGGER_SIZE, 0, TRIGGER_SIZE * sizeof(float));
+    memset(trigger->im + TRIGGER_SIZE, 0, TRIGGER_SIZE * sizeof(float));
+
+    fft_transform(&trigger->fft, trigger->re, trigger->im, FALSE);
+    for (int k = 0; k < 2 * TRIGGER_SIZE; k++)
+    {
+        trigger->re[k] = trigger->re[k] * trigger->re[k] + trigger->im[k] * trigger->im[k];
+        trigger->im[k] = 0.0f;
+    }
+    fft_transform(&trigger->fft, trigger->re, trigger->im, TRUE);
+
+    // Fewer samples overlap at longer lags, so every lag is the mean over them.
+    float *correlation = trigger->re;
+    for (int lag = 0; lag <= TRIGGER_SIZE / 2 + 1; lag++)
+        correlation[lag] /= (float)(TRIGGER_SIZE - lag);
+    float energy = correlation[0];
+    if (energy <= 1e-8f)
+        return 0.0;
+
+    // Past the lobe around 0 every peak is a candidate.
+    int start = 1;
+    while (start < TRIGGER_SIZE / 2 && correlation[start + 1] < correlation[start])
+        start++;
+    if (start < TRIGGER_MIN_PERIOD)
+        start = TRIGGER_MIN_PERIOD;
+    int best = start;
+    for (int lag = start; lag <= TRIGGER_SIZE / 2; lag++)
+        if (correlation[lag] > correlation[best])
+            best = lag;
+    if (correlation[best] < TRIGGER_MIN_CORRELATION * energy)
+        return 0.0;
+
+    // Every multiple of the period correlates about as well, the first one is the period.
+    int lag = start;
+    while (lag < best && !(correlation[lag] >= TRIGGER_PEAK_RATIO * correlation[best] &&
+                           correlation[lag] >= correlation[lag - 1] && correlation[lag] >= correlation[lag + 1]))
+        lag++;
+
+    // Between samples, from the parabola through the peak and its neighbours.
+    double left = correlation[lag - 1], peak = correlation[lag], right = correlation[lag + 1];
+    double curvature = left - 2.0 * peak + right;
+    double offset = curvature < 0.0 ? 0.5 * (left - right) / curvature : 0.0;
+    return lag + clamp((float)offset, -0.5f, 0.5f);
+}
+
+int trigger_fold(trigger_t *trigger, sample_window_t *window, int frameCount)
+{
+    /*
+    Averages the whole periods among the frameCount new samples of window into one period that
+    ends where they do, in place, and returns its length. The history becomes the end of the
+    period, so the figure is drawn closed. Returns frameCount and leaves window alone while the
+    trigger is off, nothing repeats or the frame holds less than one period.
+    */
+    if (!trigger->enabled || frameCount == 0)
+        return frameCount;
+    trigger->period = trigger_update(trigger, window, frameCount);
+    double period = trigger->period;
+    if (period < TRIGGER_MIN_PERIOD || frameCount < period)
+        return frameCount;
+
+    int periods = (int)(frameCount / period);
+    int length = (int)period;
+    int end = WINDOW_HISTORY + frameCount;
+    double start = end - periods * period;
+
+    // Sample j of the cycle is the mean of sample j of every period, between samples where the
+    // period isn't whole. It can't be written in place since the periods are read all along it.
+    for (int plane = 0; plane < window->planes; plane++)
+    {
+        const float *samples = window->plane[plane];
+        float *cycle = trigger->cycle[plane];
+        for (int j = 0; j < length; j++)
+        {
+            float sum = 0.0f;
+            for (int p = 0; p < periods; p++)
+            {
+                double t = start + j + p * period;
+                int i = (int)t;
+                float fraction = (float)(t - i);
+                int next = i + 1 < end ? i + 1 : end - 1;
+                sum += samples[i] + (samples[next] - samples[i]) * fraction;
+            }
+            cycle[j] = sum / periods;
+        }
+    }
+    for (int plane = 0; plane < window->planes; plane++)
+    {
+        float *samples = window->plane[plane];
+        const float *cycle = trigger->cycle[plane];
+        memcpy(samples + WINDOW_HISTORY, cycle, length * sizeof(float));
+        for (int i = 0; i < WINDOW_HISTORY; i++)
+            samples[i] = cycle[(length - WINDOW_HISTORY + i % length + length) % length];
+    }
+
+    window->count = WINDOW_HISTORY + length;
+    window->repeats = (float)frameCount / length;
+    return length;
+}
+
+// FFT
+void init_fft(fft_t *fft, int size)
+{
+    /*
+    Plans the transforms of size complex values, a power of two up to FFT_MAX_SIZE.
+    */
+    int bits = 0;
+    while ((1 << bits) < size)
+        bits++;
+    fft->size = size;
+    for (int i = 0; i < size; i++)
+    {
+        int j = 0;
+        for (int bit = 0; bit < bits; bit++)
+            if (i & (1 << bit))
+                j |= 1 << (bits - 1 - bit);
+        fft->reverse[i] = j;
+    }
+    for (int half = 1; half < size; half *= 2)
+    {
+        for (int k = 0; k < half; k++)
+        {
+            fft->twiddle_re[half - 1 + k] = (float)cos(M_PI * k / half);
+            fft->twiddle_im[half - 1 + k] = (float)-sin(M_PI * k / half);
+        }
+    }
+}
+
+void fft_transform(const fft_t *fft, float *re, float *im, int inverse)
+{
+    /*
+    In place transform of fft->size complex values, unscaled both ways.
+    */
+    int n = fft->size;
+    for (int i = 0; i < n; i++)
+    {
+        int j = fft->reverse[i];
+        if (i < j)
+        {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    float sign = inverse ? -1.0f : 1.0f;
+    for (int half = 1; half < n; half *= 2)
+    {
+        const float *twiddle_re = fft->twiddle_re + half - 1;
+        const float *twiddle_im = fft->twiddle_im + half - 1;
+        for (int i = 0; i < n; i += 2 * half)
+        {
+            float *ar = re + i, *ai = im + i;
+            float *br = ar + half, *bi = ai + half;
+            int k = 0;
+
+#if defined(__AVX2__) && defined(__FMA__)
+            const __m256 vsign8 = _mm256_set1_ps(sign);
+            for (; k + 8 <= half; k += 8)
+            {
+                __m256 wr = _mm256_loadu_ps(twiddle_re + k);
+                __m256 wi = _mm256_mul_ps(_mm256_loadu_ps(twiddle_im + k), vsign8);
+                __m256 xr = _mm256_loadu_ps(br + k), xi = _mm256_loadu_ps(bi + k);
+                __m256 tr = _mm256_fmsub_ps(xr, wr, _mm256_mul_ps(xi, wi));
+                __m256 ti = _mm256_fmadd_ps(xr, wi, _mm256_mul_ps(xi, wr));
+                __m256 yr = _mm256_loadu_ps(ar + k), yi = _mm256_loadu_ps(ai + k);
+                _mm256_storeu_ps(br + k, _mm256_sub_ps(yr, tr));
+                _mm256_storeu_ps(bi + k, _mm256_sub_ps(yi, ti));
+                _mm256_storeu_ps(ar + k, _mm256_add_ps(yr, tr));
+                _mm256_storeu_ps(ai + k, _mm256_add_ps(yi, ti));
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128 vsign = _mm_set1_ps(sign);
+            for (; k + 4 <= half; k += 4)
+            {
+                __m128 wr = _mm_loadu_ps(twiddle_re + k);
+                __m128 wi = _mm_mul_ps(_mm_loadu_ps(twiddle_im + k), vsign);
+                __m128 xr = _mm_loadu_ps(br + k), xi = _mm_loadu_ps(bi + k);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+                __m128 yr = _mm_loadu_ps(ar + k), yi = _mm_loadu_ps(ai + k);
+                _mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+                _mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+                _mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+                _mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+            }
+#elif defined(__ARM_NEON)
+            for (; k + 4 <= half; k += 4)
+            {
+                float32x4_t wr = vld1q_f32(twiddle_re + k);
+                float32x4_t wi = vmulq_n_f32(vld1q_f32(twiddle_im + k), sign);
+                float32x4_t xr = vld1q_f32(br + k), xi = vld1q_f32(bi + k);
+                float32x4_t tr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+                float32x4_t ti = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+                float32x4_t yr = vld1q_f32(ar + k), yi = vld1q_f32(ai + k);
+                vst1q_f32(br + k, vsubq_f32(yr, tr));
+                vst1q_f32(bi + k, vsubq_f32(yi, ti));
+                vst1q_f32(ar + k, vaddq_f32(yr, tr));
+                vst1q_f32(ai + k, vaddq_f32(yi, ti));
+            }
+#endif
+
+            for (; k < half; k++)
+            {
+                float wr = twiddle_re[k];
+                float wi = sign * twiddle_im[k];
+                float tr = br[k] * wr - bi[k] * wi;
+                float ti = br[k] * wi + bi[k] * wr;
+                br[k] = ar[k] - tr;
+                bi[k] = ai[k] - ti;
+                ar[k] += tr;
+                ai[k] += ti;
+            }
+        }
+    }
+}
+
+// Analysis
+int init_analysis(analysis_t *analysis, buffer_store_t *buffer_store, const trace_map_t *traces, int enabled)
+{
+    /*
+    Plans the spectrum of the first trace for the rate of the ring and starts the thread, which
+    analyses while enabled is set. Returns 0 on success, nothing needs to be uninitialized otherwise.
+    */
+    memset(analysis, 0, sizeof(*analysis));
+    analysis->buffer_store = buffer_store;
+    analysis->map = *traces;
+    analysis->map.count = 1;
+    analysis->map.planes = 2;
+    atomic_init(&analysis->enabled, enabled);
+    atomic_init(&analysis->running, TRUE);
+
+    init_fft(&analysis->fft, ANALYSIS_SIZE);
+    double sum = 0.0;
+    for (int i = 0; i < ANALYSIS_SIZE; i++)
+    {
+        analysis->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / ANALYSIS_SIZE));
+        sum += analysis->window[i];
+    }
+    analysis->scale = (float)(1.0 / (sum * sum));
+
+    // Bands narrower than a bin, at the bottom, take the bin they are in.
+    double rate = buffer_store->format.sample_rate;
+    double bin = rate / ANALYSIS_SIZE;
+    analysis->max_frequency = fmin(ANALYSIS_MAX_FREQUENCY, rate / 2.0);
+    double ratio = analysis->max_frequency / ANALYSIS_MIN_FREQUENCY;
+    for (int band = 0; band < ANALYSIS_BANDS; band++)
+    {
+        double low = ANALYSIS_MIN_FREQUENCY * pow(ratio, (double)band / ANALYSIS_BANDS);
+        double high = ANALYSIS_MIN_FREQUENCY * pow(ratio, (double)(band + 1) / ANALYSIS_BANDS);
+        int first = (int)ceil(low / bin);
+        int last = (int)ceil(high / bin) - 1;
+        if (last < first)
+            first = last = (int)round(sqrt(low * high) / bin);
+        analysis->first_bin[band] = first < 1 ? 1 : first > ANALYSIS_SIZE / 2 - 1 ? ANALYSIS_SIZE / 2 - 1 : first;
+        analysis->last_bin[band] = last < analysis->first_bin[band] ? analysis->first_bin[band] : last > ANALYSIS_SIZE / 2 - 1 ? ANALYSIS_SIZE / 2 - 1 : last;
+        analysis->levels[band] = ANALYSIS_FLOOR_DB;
+    }
+    for (int slot = 0; slot < 3; slot++)
+        for (int band = 0; band < ANALYSIS_BANDS; band++)
+            analysis->slots[slot].bands[band] = ANALYSIS_FLOOR_DB;
+    analysis->back = 0;
+    atomic_init(&analysis->middle, 1);
+    analysis->front = 2;
+
+    if (pthread_create(&analysis->thread, NULL, analysis_thread, analysis) != 0)
+    {
+        TraceLog(LOG_ERROR, "Could not start the analysis thread");
+        return -1;
+    }
+    analysis->started = TRUE;
+    return 0;
+}
+
+void uninit_analysis(analysis_t *analysis)
+{
+    if (!analysis->started)
+        return;
+    atomic_store(&analysis->running, FALSE);
+    pthread_join(analysis->thread, NULL);
+    analysis->started = FALSE;
+}
+
+void *analysis_thread(void *arg)
+{
+    analysis_t *analysis = (analysis_t *)arg;
+    struct timespec idle = {0, (long)(ANALYSIS_IDLE_SECONDS * 1e9)};
+
+    while (atomic_load(&analysis->running))
+    {
+        nanosleep(&idle, NULL);
+        if (!atomic_load_explicit(&analysis->enabled, memory_order_relaxed))
+            continue;
+        FORBID_ALLOCATIONS();
+        ZONE_BEGIN(zone, "analysis_update");
+        analysis_update(analysis);
+        ZONE_END(zone);
+        ALLOW_ALLOCATIONS();
+    }
+    return NULL;
+}
+
+int analysis_update(analysis_t *analysis)
+{
+    /*
+    Analyses the frames before the tail if it moved since last time and publishes the results.
+    Returns TRUE if it did. Before the ring holds ANALYSIS_SIZE frames, or when it is too small
+    to peek at that many, the spectrum starts with silence.
+    */
+    buffer_store_t *buffer_store = analysis->buffer_store;
+    ma_uint64 end = atomic_load_explicit(&buffer_store->tail, memory_order_acquire);
+    if (end == analysis->end)
+        return FALSE;
+    analysis->end = end;
+
+    ma_uint32 count = end < ANALYSIS_SIZE ? (ma_uint32)end : ANALYSIS_SIZE;
+    if (count > buffer_store->capacity / 2)
+        count = buffer_store->capacity / 2;
+    ma_uint32 silent = ANALYSIS_SIZE - count;
+    memset(analysis->x, 0, silent * sizeof(float));
+    memset(analysis->y, 0, silent * sizeof(float));
+    float *planes[2] = {analysis->x + silent, analysis->y + silent};
+    if (!buffer_store_peek(buffer_store, &analysis->map, planes, end, count))
+        return FALSE;
+
+    analysis_result_t *result = &analysis->slots[analysis->back];
+    const float *x = analysis->x, *y = analysis->y;
+
+    double xy = 0.0, xx = 0.0, yy = 0.0;
+    for (int i = 0; i < ANALYSIS_SIZE; i++)
+    {
+        xy += x[i] * y[i];
+        xx += x[i] * x[i];
+        yy += y[i] * y[i];
+    }
+    result->correlation = xx > 0.0 && yy > 0.0 ? (float)(xy / sqrt(xx * yy)) : 0.0f;
+
+    for (int i = 0; i < ANALYSIS_POINTS; i++)
+    {
+        int j = ANALYSIS_SIZE - ANALYSIS_POINTS + i;
+        result->mid[i] = 0.5f * (x[j] + y[j]);
+        result->side[i] = 0.5f * (x[j] - y[j]);
+    }
+
+    // Both channels from one transform of x + iy: |X(k)|^2 + |Y(k)|^2 = (|Z(k)|^2 + |Z(N - k)|^2) / 2.
+    for (int i = 0; i < ANALYSIS_SIZE; i++)
+    {
+        analysis->re[i] = x[i] * analysis->window[i];
+        analysis->im[i] = y[i] * analysis->window[i];
+    }
+    fft_transform(&analysis->fft, analysis->re, analysis->im, FALSE);
+
+    // The mean of |X|^2 and |Y|^2 relative to a full scale sine, (sum of window / 2)^2.
+    double now = monotonic_seconds();
+    float fall = analysis->time > 0.0 ? (float)(now - analysis->time) * ANALYSIS_FALL_DB : 0.0f;
+    analysis->time = now;
+    const float *re = analysis->re, *im = analysis->im;
+    for (int band = 0; band < ANALYSIS_BANDS; band++)
+    {
+        float peak = 0.0f;
+        for (int k = analysis->first_bin[band]; k <= analysis->last_bin[band]; k++)
+        {
+            float power = re[k] * re[k] + im[k] * im[k] +
+                          re[ANALYSIS_SIZE - k] * re[ANALYSIS_SIZE - k] + im[ANALYSIS_SIZE - k] * im[ANALYSIS_SIZE - k];
+            peak = power > peak ? power : peak;
+        }
+        float level = 10.0f * log10f(peak * analysis->scale + 1e-12f);
+        float fallen = analysis->levels[band] - fall;
+        level = level > fallen ? level : fallen;
+        analysis->levels[band] = level > ANALYSIS_FLOOR_DB ? level : ANALYSIS_FLOOR_DB;
+    }
+    memcpy(result->bands, analysis->levels, sizeof(result->bands));
+
+    analysis->back = atomic_exchange(&analysis->middle, analysis->back | ANALYSIS_FRESH) & ~ANALYSIS_FRESH;
+    return TRUE;
+}
+
+const analysis_result_t *analysis_latest(analysis_t *analysis)
+{
+    /*
+    Render thread side, the newest results published. Never waits for the analysis thread.
+    */
+    if (atomic_load(&analysis->middle) & ANALYSIS_FRESH)
+        analysis->front = atomic_exchange(&analysis->middle, analysis->front) & ~ANALYSIS_FRESH;
+    return &analysis->slots[analysis->front];
+}
+
+void draw_analysis(analysis_t *analysis, int screen_width, int screen_height)
+{
+    /*
+    Draws the spectrum, the correlation meter and the goniometer along the bottom of the screen,
+    over a faded background so the trace behind them doesn't get in the way.
+    */
+    const analysis_result_t *result = analysis_latest(analysis);
+    Color background = Fade(BACKGROUND_COLOR, 0.8f);
+    int size = ANALYSIS_PANEL;
+    int y = screen_height - 10 - size;
+    int goniometer_x = screen_width - 10 - size;
+    int meter_x = goniometer_x - 10 - ANALYSIS_METER;
+    int spectrum_width = meter_x - 20;
+
+    // Spectrum, one bar per band from the floor up, with the decades marked beneath.
+    if (spectrum_width >= ANALYSIS_BANDS)
+    {
+        DrawRectangle(10, y, spectrum_width, size, background);
+        float width = (float)spectrum_width / ANALYSIS_BANDS;
+        for (int band = 0; band < ANALYSIS_BANDS; band++)
+        {
+            float height = (result->bands[band] - ANALYSIS_FLOOR_DB) / -ANALYSIS_FLOOR_DB * size;
+            DrawRectangleRec((Rectangle){10 + band * width, y + size - height, width > 2.0f ? width - 1.0f : width, height}, FOREGROUND_COLOR);
+        }
+        double ratio = log(analysis->max_frequency / ANALYSIS_MIN_FREQUENCY);
+        for (double frequency = 100.0; frequency < analysis->max_frequency; frequency *= 10.0)
+        {
+            int x = 10 + (int)(spectrum_width * log(frequency / ANALYSIS_MIN_FREQUENCY) / ratio);
+            DrawLine(x, y, x, y + 4, FOREGROUND_COLOR);
+            DrawText(frequency < 1000.0 ? "100" : frequency < 10000.0 ? "1k" : "10k", x + 2, y + 2, 10, FOREGROUND_COLOR);
+        }
+        DrawRectangleLines(10, y, spectrum_width, size, FOREGROUND_COLOR);
+    }
+
+    // Correlation, a bar from the middle up towards +1 or down towards -1.
+    int middle = y + size / 2;
+    int height = (int)(clamp(result->correlation, -1.0f, 1.0f) * (size / 2));
+    DrawRectangle(meter_x, y, ANALYSIS_METER, size, background);
+    DrawRectangle(meter_x, height > 0 ? middle - height : middle, ANALYSIS_METER, height > 0 ? height : -height, FOREGROUND_COLOR);
+    DrawLine(meter_x - 2, middle, meter_x + ANALYSIS_METER + 2, middle, FOREGROUND_COLOR);
+    DrawRectangleLines(meter_x, y, ANALYSIS_METER, size, FOREGROUND_COLOR);
+
+    // Goniometer, mid up and side across, with the axes of x and y as diagonals.
+    float half = size / 2.0f;
+    Vector2 center = {goniometer_x + half, y + half};
+    DrawRectangle(goniometer_x, y, size, size, background);
+    DrawLine(goniometer_x + size / 2, y, goniometer_x + size / 2, y + size, Fade(FOREGROUND_COLOR, 0.3f));
+    DrawLine(goniometer_x, y, goniometer_x + size, y + size, Fade(FOREGROUND_COLOR, 0.3f));
+    DrawLine(goniometer_x + size, y, goniometer_x, y + size, Fade(FOREGROUND_COLOR, 0.3f));
+    for (int i = 0; i < ANALYSIS_POINTS; i++)
+        DrawPixelV((Vector2){center.x + clamp(result->side[i], -1.0f, 1.0f) * half,
+                             center.y - clamp(result->mid[i], -1.0f, 1.0f) * half}, FOREGROUND_COLOR);
+    DrawRectangleLines(goniometer_x, y, size, size, FOREGROUND_COLOR);
+}
+
+// Level of detail
+void init_lod(lod_t *lod)
+{
+    /*
+    Level of detail that is off, with the default budget for when it is turned on.
+    Makes no GL calls, the timer queries are made on the first frame.
+    */
+    memset(lod, 0, sizeof(*lod));
+    lod->budget = DEFAULT_LOD_BUDGET;
+    lod->factor = 1;
+#if defined(GPU_TIMERS)
+    lod->gpu_timed = -1;
+#endif
+}
+
+void uninit_lod(lod_t *lod)
+{
+    /*
+    Deletes the timer queries, call it while the GL context is still there.
+    */
+#if defined(GPU_TIMERS)
+    if (lod->gpu_timed > 0)
+        glDeleteQueries(2 * LOD_QUERIES, lod->queries);
+    lod->gpu_timed = -1;
+#endif
+    (void)lod;
+}
+
+int lod_decimate(lod_t *lod, sample_window_t *window, const trace_map_t *map, int frameCount)
+{
+    /*
+    Merges every lod->factor of the frameCount new samples of window into one, in place, and
+    returns how many are left. Each run keeps the position of its last sample and the average of
+    its Z, window->merged tells render_trace to give it the energy of the whole run. A run that is
+    not finished at the end of the window is carried over into the next one, so no energy is
+    lost between frames. Also measures how long runs may get for lod_end.
+    */
+    int factor = lod->enabled ? lod->factor : 1;
+    int end = WINDOW_HISTORY + frameCount;
+    int run = lod->run;
+
+    // How far the sample halfway through runs of `probe` samples is from the segment between
+    // their ends. On a smooth curve that grows with the square of the length of the runs.
+    if (lod->enabled && frameCount > 0)
+    {
+        int probe = factor > 1 ? factor : 2;
+        double squares = 0.0;
+        int count = 0;
+        for (int trace = 0; trace < window->traces; trace++)
+        {
+            const float *xs = window->plane[2 * trace];
+            const float *ys = window->plane[2 * trace + 1];
+            float sx = map->viewports[trace].width / 2.0f;
+            float sy = map->viewports[trace].height / 2.0f;
+            for (int j = WINDOW_HISTORY - 1 + probe; j < end; j += probe, count++)
             {
-                opt->menu_shown = TRUE;
+                int a = j - probe, m = j - probe / 2;
+                float dx = (xs[j] - xs[a]) * sx, dy = (ys[j] - ys[a]) * sy;
+                float mx = (xs[m] - xs[a]) * sx, my = (ys[m] - ys[a]) * sy;
+                float chord = sqrtf(dx * dx + dy * dy);
+                float distance = chord > 1e-3f ? fabsf(dx * my - dy * mx) / chord : sqrtf(mx * mx + my * my);
+                squares += distance * distance;
             }
         }
-        else if (48 <= key_pressed  && key_pressed <= 57) // 0->9 numerical keys
-        {
+        double deviation = count > 0 ? sqrt(squares / count) : 0.0;
+        lod->widest = deviation > 0.0 ? probe * sqrt(LOD_TOLERANCE / deviation) : 0.0;
+    }
 
-            ma_device_info *pPlaybackInfos;
-            ma_uint32 playbackCount;
-            ma_device_info *pCaptureInfos;
-            ma_uint32 captureCount;
-            ma_device_uninit(&opt->device);
-            if (ma_context_get_devices(&opt->context, &pPlaybackInfos, &playbackCount, &pCaptureInfos, &captureCount) != MA_SUCCESS)
-            {
-                opt->error_code = 1;
-                opt->should_exit = TRUE;
-                return;
-            }
-            // Convert a key press to a number between 0 and 9
-            int device_idx = key_pressed - 48;
+    // The sample that finishes the run carried over, the next ones are factor apart.
+    int first = WINDOW_HISTORY + (factor - 1 - run > 0 ? factor - 1 - run : 0);
+    int kept = first < end ? (end - 1 - first) / factor + 1 : 0;
+    // Where the next unfinished run starts.
+    int rest = kept > 0 ? first + (kept - 1) * factor + 1 : WINDOW_HISTORY;
 
-            if (device_idx < captureCount)
+    if (factor > 1 || run > 0)
+    {
+        // Every run is read before its sample is written, which is never behind it.
+        for (int plane = 0; plane < 2 * window->traces; plane++)
+        {
+            float *samples = window->plane[plane];
+            for (int i = 0; i < kept; i++)
+                samples[WINDOW_HISTORY + i] = samples[first + i * factor];
+        }
+        for (int plane = 2 * window->traces; plane < window->planes; plane++)
+        {
+            float *samples = window->plane[plane];
+            int start = WINDOW_HISTORY;
+            for (int i = 0; i < kept; i++)
             {
-                opt->config.capture.pDeviceID = &pCaptureInfos[device_idx].id;
-                if (ma_device_init(NULL, &opt->config, &opt->device) != MA_SUCCESS)
-                {
-                    opt->error_code = -1;
-                    opt->should_exit = TRUE;
-                    return;
-                }
-                ma_device_start(&opt->device);
+                int last = first + i * factor;
+                float sum = i == 0 ? lod->carry[plane] : 0.0f;
+                for (int j = start; j <= last; j++)
+                    sum += samples[j];
+                samples[WINDOW_HISTORY + i] = sum / (last - start + 1 + (i == 0 ? run : 0));
+                start = last + 1;
             }
+
+            float sum = kept > 0 ? 0.0f : lod->carry[plane];
+            for (int j = rest; j < end; j++)
+                sum += samples[j];
+            lod->carry[plane] = sum;
         }
+        lod->run = end - rest + (kept > 0 ? 0 : run);
+        window->count = WINDOW_HISTORY + kept;
+        window->merged = factor;
     }
+
+    return kept;
 }
 
-void handle_draw(opt_t *opt, buffer_store_t *buffer_store, RenderTexture2D *xytexture)
+void lod_begin(lod_t *lod)
 {
+    /*
+    Starts timing the frame about to be drawn.
+    */
+    if (!lod->enabled && !lod->timed)
+        return;
 
-    BeginDrawing();
-    ClearBackground(BACKGROUND_COLOR);
+    int slot = (int)(lod->frame % LOD_QUERIES);
+    // Normally read long ago, only waits if the GPU is LOD_QUERIES frames behind.
+    if (lod->frames[slot].pending)
+        lod_collect(lod, slot, TRUE);
 
-    // We update  xytexture on the bottom of this function
-    DrawTextureEx(xytexture->texture, (Vector2){0, 0}, 0.0, 1.0, WHITE);
+#if defined(GPU_TIMERS)
+    if (lod->gpu_timed < 0)
+    {
+        lod->gpu_timed = rlGetVersion() >= RL_OPENGL_33;
+        if (lod->gpu_timed)
+            glGenQueries(2 * LOD_QUERIES, lod->queries);
+    }
+    // Timestamps rather than GL_TIME_ELAPSED, which --bench has running around the whole frame.
+    if (lod->gpu_timed)
+        glQueryCounter(lod->queries[2 * slot], GL_TIMESTAMP);
+#endif
+    lod->start = monotonic_seconds();
+}
 
-    // UI has to be drawn last since we overlay it over the xy curve
-    if (opt->menu_shown == TRUE)
+void lod_end(lod_t *lod, int frameCount, int drawn)
+{
+    /*
+    Finishes timing the frame that drew `drawn` of its frameCount samples and picks how many
+    to merge on the next one, assuming it brings as many.
+    */
+    if (!lod->enabled && !lod->timed)
     {
-        draw_menu(opt);
+        lod->target = 0.0;
+        lod->factor = 1;
+        return;
     }
 
-    EndDrawing();
+    int slot = (int)(lod->frame % LOD_QUERIES);
+    lod_frame_t *frame = &lod->frames[slot];
+    frame->drawn = drawn;
+    frame->merged = lod->factor;
+    frame->cpu = monotonic_seconds() - lod->start;
+    frame->pending = TRUE;
+#if defined(GPU_TIMERS)
+    if (lod->gpu_timed)
+        glQueryCounter(lod->queries[2 * slot + 1], GL_TIMESTAMP);
+#endif
+    lod->frame++;
 
-    // When this function is called do the following:
-    // -> Set buffer_store->ptr to point to the other buffer
-    //    so the audio callback doesn't accidentally overwrite
-    //    the buffer we want to draw from.
-    // -> Draw the contents of buffer_store->buf to the screen as xy coordinates.
+    // Oldest first, up to the first one the GPU is still working on.
+    for (int i = 0; i < LOD_QUERIES; i++)
+    {
+        int oldest = (int)((lod->frame + i) % LOD_QUERIES);
+        if (lod->frames[oldest].pending && !lod_collect(lod, oldest, FALSE))
+            break;
+    }
+    if (!lod->enabled)
+    {
+        lod->target = 0.0;
+        lod->factor = 1;
+        return;
+    }
+
+    int factor = 1;
+    if (lod->target > 0.0 && frameCount > lod->target)
+        factor = (int)ceil(frameCount / lod->target);
+    // Never merge so much that the trace changes shape, whatever the budget says.
+    int widest = lod->widest > 0.0 ? (int)fmax(floor(fmin(lod->widest, INT_MAX)), 1.0) : factor;
+    lod->factor = factor < widest ? factor : widest;
+}
 
-    // Save the buffer we are going to read from
-    float *buffer = opt->buffer_store.buf[opt->buffer_store.ptr];
+int lod_collect(lod_t *lod, int slot, int wait)
+{
+    /*
+    Takes the time of a frame that was drawn into account once the GPU is done with it, or
+    right away when wait is TRUE. Returns TRUE if it was.
+    */
+    lod_frame_t *frame = &lod->frames[slot];
+    double gpu = 0.0;
+#if defined(GPU_TIMERS)
+    if (lod->gpu_timed > 0)
+    {
+        GLint available = GL_TRUE;
+        if (!wait)
+            glGetQueryObjectiv(lod->queries[2 * slot + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return FALSE;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(lod->queries[2 * slot], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(lod->queries[2 * slot + 1], GL_QUERY_RESULT, &end);
+        gpu = end > begin ? (end - begin) / 1e9 : 0.0;
+    }
+#else
+    (void)wait;
+#endif
+    frame->pending = FALSE;
 
-    // Number of frames written to the buffer thus far (samples written / 2)
-    int frameCount = opt->buffer_store.idx / 2;
+    // The CPU and the GPU work at the same time, whichever took longer sets the pace.
+    double seconds = fmax(frame->cpu, gpu);
+    if (seconds > 0.0)
+        lod->seconds = seconds;
+    if (!lod->enabled || frame->drawn <= 0 || seconds <= 0.0)
+        return TRUE;
 
+    if (frame->merged > 1 || seconds > lod->budget)
+    {
+        // Drawing time grows with the samples drawn, aim for the ones that fill the budget.
+        double estimate = frame->drawn * lod->budget / seconds;
+        lod->target = lod->target > 0.0 ? lod->target + LOD_GAIN * (estimate - lod->target) : estimate;
+    }
+    else if (frame->drawn >= lod->target)
+    {
+        // Everything fit, stop merging until the budget is exceeded again.
+        lod->target = 0.0;
+    }
+    return TRUE;
+}
 
-    // Move buffer store pointer to the next buffer, will circle back to the buffer.
-    opt->buffer_store.ptr = (opt->buffer_store.ptr + 1) % 2;
-    opt->buffer_store.idx = 0;
+// Library
+void rxyo_default_config(rxyo_config_t *config)
+{
+    /*
+    The defaults of the program: 800x800, interpolated on the GPU, no persistence, stereo at
+    48000 Hz drawn against each other.
+    */
+    memset(config, 0, sizeof(*config));
+    config->width = DEFAULT_SCREEN_WIDTH;
+    config->height = DEFAULT_SCREEN_HEIGHT;
+    config->backend = RXYO_BACKEND_SHADER;
+    config->interpolation = DEFAULT_INTERPOLATION;
+    config->half_life = 0.0f;
+    config->exposure = DEFAULT_EXPOSURE;
+    config->channels = 2;
+    config->sample_rate = 48000;
+    config->seconds = DEFAULT_CAPACITY;
+    config->traces = NULL;
+    config->trigger = FALSE;
+}
 
-    // Draw the points on buffer.
-    BeginTextureMode(*xytexture);
+rxyo_ring_t *rxyo_ring_create(const rxyo_config_t *config)
+{
+    /*
+    The ring main captures into, of float frames with as many channels as the caller has.
+    */
+    if (config->channels < 1 || config->channels > RING_MAX_CHANNELS || config->sample_rate == 0 || config->seconds <= 0.0f)
+    {
+        TraceLog(LOG_ERROR, "Invalid ring configuration");
+        return NULL;
+    }
+    rxyo_ring_t *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL)
+        return NULL;
+    if (init_buffer_store(&ring->buffer_store, config->seconds, config->channels) != 0 ||
+        buffer_store_set_format(&ring->buffer_store, ma_format_f32, config->channels, config->sample_rate) != 0)
+    {
+        uninit_buffer_store(&ring->buffer_store);
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
 
-    int x0 = 0, x1 = 0, x2 = 0, x3 = 0; // x positions at times n, n-1, and n-2
-    int y0 = 0, y1 = 0, y2 = 0, y3 = 0; // y positions at times n, n-1, and n-2
+void rxyo_ring_destroy(rxyo_ring_t *ring)
+{
+    /*
+    Nothing may push to the ring any more, close its source first.
+    */
+    if (ring == NULL)
+        return;
+    uninit_buffer_store(&ring->buffer_store);
+    free(ring);
+}
+
+unsigned int rxyo_ring_push(rxyo_ring_t *ring, const float *frames, unsigned int frameCount)
+{
+    /*
+    The audio callback of the program does the same, stamps aside: the caller decides
+    when to draw, not a frame clock.
+    */
+    return buffer_store_write(&ring->buffer_store, frames, frameCount);
+}
+
+rxyo_source_t *rxyo_ring_open_capture(rxyo_ring_t *ring)
+{
+    /*
+    Opens a miniaudio context of its own and captures from its default device, see capture_t.
+    */
+    rxyo_source_t *source = calloc(1, sizeof(*source));
+    if (source == NULL)
+        return NULL;
+    if (ma_context_init(NULL, 0, NULL, &source->context) != MA_SUCCESS)
+    {
+        free(source);
+        return NULL;
+    }
+    buffer_store_t *buffer_store = &ring->buffer_store;
+    if (init_capture(&source->capture, &source->context, buffer_store, FALSE, buffer_store->format.channels) != 0)
+    {
+        ma_context_uninit(&source->context);
+        free(source);
+        return NULL;
+    }
+    return source;
+}
+
+void rxyo_close_capture(rxyo_source_t *source)
+{
+    if (source == NULL)
+        return;
+    uninit_capture(&source->capture);
+    ma_context_uninit(&source->context);
+    free(source);
+}
+
+rxyo_chain_t *rxyo_chain_create(const rxyo_config_t *config)
+{
+    /*
+    A sample window that takes config->seconds at config->sample_rate at a time, with the trigger
+    and the level of detail of main. The traces are laid out on config->width x config->height,
+    which is what the level of detail measures pixels on.
+    */
+    if (config->width <= 0 || config->height <= 0 || config->sample_rate == 0 || config->seconds <= 0.0f)
+    {
+        TraceLog(LOG_ERROR, "Invalid chain configuration");
+        return NULL;
+    }
+    rxyo_chain_t *chain = calloc(1, sizeof(*chain));
+    if (chain == NULL)
+        return NULL;
 
-    // "Refresh" the texture by painting BACKGROUND_COLOR over it. Only do that when
-    // there are more than 0 frames to paint pixels/lines on. If we don't check for
-    // frameCount, `handle_draw` will not paint anything at this frame and this will
-    // look like "flickering" (try disabling the if statement below and see what happens)
-    if (frameCount > 0)
-        DrawRectangle(
-            0,
-            0,
-            opt->screen_width,
-            opt->screen_height,
-            BACKGROUND_COLOR);
+    init_trace_map(&chain->traces);
+    if (config->traces != NULL && parse_trace_map(&chain->traces, config->traces) != 0)
+    {
+        TraceLog(LOG_ERROR, "Invalid traces %s", config->traces);
+        free(chain);
+        return NULL;
+    }
+    layout_traces(&chain->traces, config->width, config->height);
+    init_lod(&chain->lod);
+    init_trigger(&chain->trigger);
+    chain->trigger.enabled = config->trigger != 0;
+    chain->sample_rate = config->sample_rate;
 
-    for (int i = 0; i < frameCount; i++)
+    int capacity = (int)ceilf(config->seconds * config->sample_rate);
+    if (init_sample_window(&chain->window, chain->traces.count, chain->traces.planes, capacity > 0 ? capacity : 1) != 0)
     {
-        x3 = x2;
-        y3 = y2;
+        free(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+void rxyo_chain_destroy(rxyo_chain_t *chain)
+{
+    if (chain == NULL)
+        return;
+    uninit_lod(&chain->lod);
+    unload_sample_window(&chain->window);
+    free(chain);
+}
+
+int rxyo_chain_process(rxyo_chain_t *chain, rxyo_ring_t *ring)
+{
+    /*
+    The first half of handle_draw: converts the new frames of the ring into the sample window
+    and folds them with the trigger. The window stays in the chain's own storage, since any
+    number of renderers may draw it.
+    */
+    sample_window_t *window = &chain->window;
+    begin_sample_window(window, NULL);
+    float *planes[MAX_PLANES];
+    for (int plane = 0; plane < window->planes; plane++)
+        planes[plane] = window->plane[plane] + WINDOW_HISTORY;
+    int frameCount = (int)buffer_store_read(&ring->buffer_store, &chain->traces, planes, window->capacity);
+    end_sample_window(window, frameCount);
+    int drawn = trigger_fold(&chain->trigger, window, frameCount);
+    if (window->repeats > 1.0f)
+        chain->lod.run = 0;
+    chain->drawn = lod_decimate(&chain->lod, window, &chain->traces, drawn);
+    chain->sample_rate = ring->buffer_store.format.sample_rate;
+    chain->generation++;
+    return frameCount;
+}
 
-        x2 = x1;
-        y2 = y1;
+rxyo_renderer_t *rxyo_renderer_create(const rxyo_config_t *config, const rxyo_chain_t *chain)
+{
+    /*
+    Sets up what main sets up for drawing, except for the window: the GL backends draw with
+    whatever context is current. Only what the backend draws with, so many renderers don't
+    start a rasterizer thread per core each.
+    */
+    if (config->width <= 0 || config->height <= 0)
+    {
+        TraceLog(LOG_ERROR, "Invalid renderer configuration");
+        return NULL;
+    }
+    rxyo_renderer_t *renderer = calloc(1, sizeof(*renderer));
+    if (renderer == NULL)
+        return NULL;
 
-        x1 = x0;
-        y1 = y0;
+    opt_t *opt = &renderer->opt;
+    opt->screen_width = opt->render_width = config->width;
+    opt->screen_height = opt->render_height = config->height;
+    opt->backend = config->backend == RXYO_BACKEND_SOFTWARE  ? BACKEND_SOFTWARE
+                   : config->backend == RXYO_BACKEND_BATCHED ? BACKEND_BATCHED
+                                                             : BACKEND_SHADER;
+    opt->interpolation = config->interpolation >= 1 && config->interpolation <= MAX_INTERPOLATION ? config->interpolation : DEFAULT_INTERPOLATION;
+    opt->persistence = config->half_life > 0.0f;
+    opt->half_life = opt->persistence ? config->half_life : DEFAULT_HALF_LIFE;
+    opt->exposure = config->exposure > 0.0f ? config->exposure : DEFAULT_EXPOSURE;
+    opt->traces = chain->traces;
+    layout_traces(&opt->traces, opt->render_width, opt->render_height);
+    renderer->plane_size = chain->window.plane_size;
 
-        if (buffer[2 * i] > 0.0 || buffer[2 * i + 1] > 0.0 ||
-            buffer[2 * i] < 0.0 || buffer[2 * i + 1] < 0.0)
+    int result = 0;
+    if (opt->backend == BACKEND_SOFTWARE)
+        result = init_software(&opt->software, opt->render_width, opt->render_height, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    else
+    {
+        opt->xytexture = LoadRenderTexture(opt->render_width, opt->render_height);
+        result = opt->xytexture.id == 0 || init_trace_batch(&opt->trace_batch) != 0 ||
+                 init_phosphor(&opt->phosphor, opt->render_width, opt->render_height) != 0;
+        if (result == 0 && init_trace_shader(&opt->trace_shader, chain->window.planes, chain->window.plane_size) != 0 &&
+            opt->backend == BACKEND_SHADER)
         {
-            x0 = (int)((buffer[2 * i] + 1.0) / 2.0 * (double)opt->screen_width);
-            y0 = (int)((buffer[2 * i + 1] + 1.0) / 2.0 * (double)opt->screen_height);
+            TraceLog(LOG_WARNING, "Falling back to interpolating on the CPU");
+            opt->backend = BACKEND_BATCHED;
         }
+    }
+    if (result != 0)
+    {
+        rxyo_renderer_destroy(renderer);
+        return NULL;
+    }
+    return renderer;
+}
+
+void rxyo_renderer_destroy(rxyo_renderer_t *renderer)
+{
+    if (renderer == NULL)
+        return;
+    opt_t *opt = &renderer->opt;
+    if (opt->backend == BACKEND_SOFTWARE)
+        unload_software(&opt->software);
+    else
+    {
+        unload_phosphor(&opt->phosphor);
+        unload_trace_shader(&opt->trace_shader);
+        unload_trace_batch(&opt->trace_batch);
+        if (opt->xytexture.id != 0)
+            UnloadRenderTexture(opt->xytexture);
+    }
+    free(renderer);
+}
+
+int rxyo_renderer_render(rxyo_renderer_t *renderer, const rxyo_chain_t *chain, RenderTexture2D *target, float frameTime)
+{
+    /*
+    The second half of handle_draw, into target instead of the screen. The phosphor targets
+    are the size of the renderer, so target has to be as well.
+    */
+    opt_t *opt = &renderer->opt;
+    if (target != NULL && (target->texture.width != opt->render_width || target->texture.height != opt->render_height))
+    {
+        TraceLog(LOG_ERROR, "The target is %dx%d, the renderer %dx%d", target->texture.width, target->texture.height,
+                 opt->render_width, opt->render_height);
+        return -1;
+    }
+    if (chain->traces.count != opt->traces.count || chain->traces.planes != opt->traces.planes ||
+        chain->window.plane_size != renderer->plane_size)
+    {
+        TraceLog(LOG_ERROR, "The chain has other traces than the renderer was made for");
+        return -1;
+    }
 
-        x0 = clamp(x0, 0, opt->screen_width);
-        y0 = clamp(y0, 0, opt->screen_height);
+    // Every backend draws the whole window, so a window this renderer drew already is only
+    // the history of the next one. Drawn again, the glow would get brighter the more often
+    // it is rendered.
+    sample_window_t window = chain->window;
+    int frameCount = chain->drawn;
+    if (renderer->chain == chain && renderer->generation == chain->generation)
+    {
+        if (window.count > WINDOW_HISTORY)
+            window.count = WINDOW_HISTORY;
+        frameCount = 0;
+    }
+    renderer->chain = chain;
+    renderer->generation = chain->generation;
 
-        // TODO: Creatively check intensity and color
-        float len = length(x1, y1, x0, y0) / length(0, 0, opt->screen_width, opt->screen_height);
-        float intensity = 1.0f / len / len;//- clamp(opt->buffer_store.ptr,0,1);
-        Color color = (Color){FOREGROUND_COLOR.r, FOREGROUND_COLOR.g * intensity,  FOREGROUND_COLOR.b * intensity, (int)255.0 * intensity};
-        // TraceLog(LOG_DEBUG, "len: %d", len);
-        float thickness = fminf(opt->screen_width, opt->screen_height) / min(opt->screen_height, opt->screen_width);
+    RenderTexture2D *texture = target != NULL ? target : opt->backend == BACKEND_SOFTWARE ? NULL : &opt->xytexture;
+    render_trace(opt, &window, texture, frameCount, chain->sample_rate, frameTime);
+    return 0;
+}
 
-    DrawLineBezierCubic((Vector2){x3, y3}, (Vector2){x0, y0}, (Vector2){x1, y1}, (Vector2){x2, y2}, thickness, color);    }
+int rxyo_renderer_render_pixels(rxyo_renderer_t *renderer, const rxyo_chain_t *chain, unsigned char *rgba, float frameTime)
+{
+    opt_t *opt = &renderer->opt;
+    if (rxyo_renderer_render(renderer, chain, NULL, frameTime) != 0)
+        return -1;
+    size_t bytes = (size_t)opt->render_width * opt->render_height * 4;
+    if (opt->backend == BACKEND_SOFTWARE)
+    {
+        memcpy(rgba, opt->software.pixels, bytes);
+        return 0;
+    }
+#if defined(DIRECT_READBACK)
+    // Straight from the target into rgba, raylib draws into it with the top row first.
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, opt->xytexture.id);
+    glReadPixels(0, 0, opt->render_width, opt->render_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return 0;
+#else
+    unsigned char *pixels = rlReadTexturePixels(opt->xytexture.texture.id, opt->render_width, opt->render_height, opt->xytexture.texture.format);
+    if (pixels == NULL)
+        return -1;
+    memcpy(rgba, pixels, bytes);
+    MemFree(pixels);
+    return 0;
+#endif
+}
 
-    EndTextureMode();
+Texture2D rxyo_renderer_texture(const rxyo_renderer_t *renderer)
+{
+    return renderer->opt.xytexture.texture;
 }
 
-// User interface
-void draw_menu(opt_t *opt)
+rxyo_scope_t *rxyo_create(const rxyo_config_t *config)
 {
-    int x = (10 * opt->screen_width) / 100;
-    int y = (10 * opt->screen_height) / 100;
-    int w = (80 * opt->screen_width) / 100;
-    int last_text_y = 0;
+    /*
+    One of each part, made from the same configuration.
+    */
+    rxyo_scope_t *scope = calloc(1, sizeof(*scope));
+    if (scope == NULL)
+        return NULL;
+    scope->ring = rxyo_ring_create(config);
+    scope->chain = scope->ring != NULL ? rxyo_chain_create(config) : NULL;
+    scope->renderer = scope->chain != NULL ? rxyo_renderer_create(config, scope->chain) : NULL;
+    if (scope->renderer == NULL)
+    {
+        rxyo_destroy(scope);
+        return NULL;
+    }
+    return scope;
+}
+
+void rxyo_destroy(rxyo_scope_t *scope)
+{
+    /*
+    Nothing may push to the scope any more, close its source first.
+    */
+    if (scope == NULL)
+        return;
+    rxyo_renderer_destroy(scope->renderer);
+    rxyo_chain_destroy(scope->chain);
+    rxyo_ring_destroy(scope->ring);
+    free(scope);
+}
 
-    char inp[256];
+unsigned int rxyo_push(rxyo_scope_t *scope, const float *frames, unsigned int frameCount)
+{
+    return rxyo_ring_push(scope->ring, frames, frameCount);
+}
 
+rxyo_source_t *rxyo_open_capture(rxyo_scope_t *scope)
+{
+    return rxyo_ring_open_capture(scope->ring);
+}
 
-    DrawText("Shortcuts (Press m to toggle)", x + 10, y + 10, 10, FOREGROUND_COLOR);
-    DrawLine(x, y + 30, x + w, y + 30, FOREGROUND_COLOR);
-    DrawText("Select input", x + 10, y + 40, 10, FOREGROUND_COLOR);
-    DrawLine(x + 10, y + 55, x + w - 10, y + 55, FOREGROUND_COLOR);
+int rxyo_process(rxyo_scope_t *scope)
+{
+    return rxyo_chain_process(scope->chain, scope->ring);
+}
 
-    ma_device_info *pPlaybackInfos;
-    ma_uint32 playbackCount;
-    ma_device_info *pCaptureInfos;
-    ma_uint32 captureCount;
+int rxyo_render(rxyo_scope_t *scope, RenderTexture2D *target, float frameTime)
+{
+    return rxyo_renderer_render(scope->renderer, scope->chain, target, frameTime);
+}
 
-    if (ma_context_get_devices(&opt->context, &pPlaybackInfos, &playbackCount, &pCaptureInfos, &captureCount) != MA_SUCCESS)
-    {
-        opt->should_exit = TRUE;
+int rxyo_render_pixels(rxyo_scope_t *scope, unsigned char *rgba, float frameTime)
+{
+    return rxyo_renderer_render_pixels(scope->renderer, scope->chain, rgba, frameTime);
+}
+
+Texture2D rxyo_texture(const rxyo_scope_t *scope)
+{
+    return rxyo_renderer_texture(scope->renderer);
+}
+
+rxyo_ring_t *rxyo_scope_ring(rxyo_scope_t *scope)
+{
+    return scope->ring;
+}
+
+rxyo_chain_t *rxyo_scope_chain(rxyo_scope_t *scope)
+{
+    return scope->chain;
+}
+
+rxyo_renderer_t *rxyo_scope_renderer(rxyo_scope_t *scope)
+{
+    return scope->renderer;
+}
+
+// Allocation checks
+#if defined(CHECK_ALLOCATIONS)
+void resolve_allocator(void)
+{
+    /*
+    Looks up the allocator these functions stand in front of. dlsym allocates itself, from
+    bootstrap_heap while it is looking.
+    */
+    resolving_allocator = TRUE;
+    next_malloc = (void *(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    next_calloc = (void *(*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+    next_realloc = (void *(*)(void *, size_t))dlsym(RTLD_NEXT, "realloc");
+    next_free = (void (*)(void *))dlsym(RTLD_NEXT, "free");
+    next_posix_memalign = (int (*)(void **, size_t, size_t))dlsym(RTLD_NEXT, "posix_memalign");
+    next_aligned_alloc = (void *(*)(size_t, size_t))dlsym(RTLD_NEXT, "aligned_alloc");
+    resolving_allocator = FALSE;
+    if (next_malloc == NULL || next_calloc == NULL || next_realloc == NULL || next_free == NULL ||
+        next_posix_memalign == NULL || next_aligned_alloc == NULL)
+        abort();
+}
+
+void *bootstrap_allocate(size_t size)
+{
+    /*
+    Zeroed memory for dlsym while the allocator is resolved, it is never freed.
+    */
+    size = (size + 15) & ~(size_t)15;
+    if (size > sizeof(bootstrap_heap) - bootstrap_used)
+        return NULL;
+    void *p = bootstrap_heap + bootstrap_used;
+    bootstrap_used += size;
+    return p;
+}
+
+int is_bootstrap_allocation(const void *ptr)
+{
+    return (const unsigned char *)ptr >= bootstrap_heap && (const unsigned char *)ptr < bootstrap_heap + sizeof(bootstrap_heap);
+}
+
+void check_allocation(const char *function, size_t size, void *caller)
+{
+    /*
+    Aborts, after saying what was called from where, when the heap is used where it is
+    forbidden. Whatever allocated it, this file, raylib, the GL driver or libc, a debugger
+    or addr2line on caller tells.
+    */
+    if (allocation_guard <= 0)
         return;
+    allocation_guard = 0; // Aborting may allocate
+    char message[160];
+    int length = snprintf(message, sizeof(message), "%s of %zu bytes from %p where there must be none, see FORBID_ALLOCATIONS\n",
+                          function, size, caller);
+    if (write(STDERR_FILENO, message, length) < 0)
+        abort();
+    abort();
+}
+
+void *malloc(size_t size)
+{
+    if (next_malloc == NULL)
+    {
+        if (resolving_allocator)
+            return bootstrap_allocate(size);
+        resolve_allocator();
     }
+    check_allocation("malloc", size, __builtin_return_address(0));
+    return next_malloc(size);
+}
 
-    for (ma_uint32 iDevice = 0; iDevice < captureCount; iDevice += 1)
+void *calloc(size_t count, size_t size)
+{
+    if (next_calloc == NULL)
     {
-        sprintf(inp, "%d - %s\n", iDevice, pCaptureInfos[iDevice].name);
-        DrawText(inp, x + 10, y + 65 + iDevice * 15, 9, FOREGROUND_COLOR);
-        last_text_y = y + 65 + iDevice * 15;
+        if (resolving_allocator)
+            return count == 0 || size <= SIZE_MAX / count ? bootstrap_allocate(count * size) : NULL;
+        resolve_allocator();
     }
+    check_allocation("calloc", count * size, __builtin_return_address(0));
+    return next_calloc(count, size);
+}
 
-    DrawLine(x + 10, last_text_y + 20, x + w - 10, last_text_y + 20, FOREGROUND_COLOR);
-    DrawText("Esc - Exit", x + 10, last_text_y + 25, 10, FOREGROUND_COLOR);
+void *realloc(void *ptr, size_t size)
+{
+    if (next_realloc == NULL)
+    {
+        // What dlsym allocated is moved up the bootstrap heap, it ends where the new one starts.
+        if (resolving_allocator)
+        {
+            unsigned char *moved = bootstrap_allocate(size);
+            if (moved != NULL && ptr != NULL)
+            {
+                size_t old = (size_t)(moved - (unsigned char *)ptr);
+                memcpy(moved, ptr, size < old ? size : old);
+            }
+            return moved;
+        }
+        resolve_allocator();
+    }
+    check_allocation("realloc", size, __builtin_return_address(0));
+    if (!is_bootstrap_allocation(ptr))
+        return next_realloc(ptr, size);
 
-    int h = last_text_y + 40 - y;
+    // The size of a bootstrap allocation isn't kept, it is copied as far as the heap goes.
+    void *moved = next_malloc(size);
+    size_t left = bootstrap_heap + sizeof(bootstrap_heap) - (unsigned char *)ptr;
+    if (moved != NULL)
+        memcpy(moved, ptr, size < left ? size : left);
+    return moved;
+}
 
-    /* Draw a rectangle from 0.1->0.9 of screen */
-    DrawRectangleLines(x, y, w, h, FOREGROUND_COLOR);
+void free(void *ptr)
+{
+    if (ptr == NULL || is_bootstrap_allocation(ptr))
+        return;
+    if (next_free == NULL)
+        resolve_allocator();
+    check_allocation("free", 0, __builtin_return_address(0));
+    next_free(ptr);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (next_posix_memalign == NULL)
+    {
+        if (resolving_allocator)
+            return alignment <= 16 && (*ptr = bootstrap_allocate(size)) != NULL ? 0 : ENOMEM;
+        resolve_allocator();
+    }
+    check_allocation("posix_memalign", size, __builtin_return_address(0));
+    return next_posix_memalign(ptr, alignment, size);
 }
 
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (next_aligned_alloc == NULL)
+    {
+        if (resolving_allocator)
+            return alignment <= 16 ? bootstrap_allocate(size) : NULL;
+        resolve_allocator();
+    }
+    check_allocation("aligned_alloc", size, __builtin_return_address(0));
+    return next_aligned_alloc(alignment, size);
+}
+#endif
 
 // Utility functions
+double monotonic_seconds(void)
+{
+    /*
+    Seconds on a clock shared by the audio callback and the render thread.
+    */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double thread_cpu_seconds(void)
+{
+    /*
+    CPU time of the calling thread.
+    */
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
 float clamp(float x, const float min_x, const float max_x)
 {
     /*
@@ -381,12 +8634,24 @@ float clamp(float x, const float min_x, const float max_x)
         return x;
 }
 
-int min(int x, int y)
+ma_uint64 read_le(const unsigned char *bytes, int size)
 {
-    return x > y ? x : y;
+    /*
+    Reads a little-endian unsigned integer of size bytes, as in file headers.
+    */
+    ma_uint64 value = 0;
+    for (int i = size - 1; i >= 0; i--)
+        value = (value << 8) | bytes[i];
+    return value;
 }
 
-float length(float x0, float y0, float x1, float y1)
+ma_uint64 read_be(const unsigned char *bytes, int size)
 {
-  return sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+    /*
+    Reads a big-endian unsigned integer of size bytes, as in packet headers.
+    */
+    ma_uint64 value = 0;
+    for (int i = 0; i < size; i++)
+        value = (value << 8) | bytes[i];
+    return value;
 }
\ No newline at end of file
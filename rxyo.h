@@ -0,0 +1,157 @@
+/*
+RXYO as a library, see README.md
+
+Build rxyo.c without its main() and link it into your own program:
+
+    cc -c -DRXYO_LIBRARY -o rxyo.o rxyo.c
+
+A scope is made of three parts that can also be used on their own: an rxyo_ring_t the samples
+are pushed into, an rxyo_chain_t that takes them out of a ring through the trigger and the level
+of detail, and an rxyo_renderer_t that draws what a chain took. Any number of them can run in one
+process and share one GL context. rxyo_scope_t is one of each wired together:
+
+    rxyo_config_t config;
+    rxyo_default_config(&config);
+    rxyo_scope_t *scope = rxyo_create(&config);  // After InitWindow, unless config.backend is software
+
+    // On any one thread, e.g. the audio callback of your application
+    rxyo_push(scope, frames, frameCount);
+
+    // On the thread with the GL context, once per frame
+    rxyo_process(scope);
+    rxyo_render(scope, NULL, GetFrameTime());
+    DrawTexture(rxyo_texture(scope), 0, 0, WHITE);
+
+    rxyo_destroy(scope);
+
+The same with the parts, here one ring drawn by two renderers, say one in a window and one into
+a smaller preview:
+
+    rxyo_ring_t *ring = rxyo_ring_create(&config);
+    rxyo_chain_t *chain = rxyo_chain_create(&config);
+    rxyo_renderer_t *renderer = rxyo_renderer_create(&config, chain);
+    rxyo_renderer_t *preview = rxyo_renderer_create(&preview_config, chain);
+
+    rxyo_ring_push(ring, frames, frameCount);
+
+    rxyo_chain_process(chain, ring);
+    rxyo_renderer_render(renderer, chain, NULL, GetFrameTime());
+    rxyo_renderer_render(preview, chain, NULL, GetFrameTime());
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef RXYO_H
+#define RXYO_H
+
+#include "raylib.h"
+
+typedef enum
+{
+    RXYO_BACKEND_SHADER,   // Interpolated in a vertex shader
+    RXYO_BACKEND_BATCHED,  // Interpolated on the CPU, drawn in one batch
+    RXYO_BACKEND_SOFTWARE, // Everything on the CPU, needs no GL context
+} rxyo_backend_t;
+
+// How a scope draws, see rxyo_default_config for the defaults. Every part only looks at the
+// fields it needs, as noted.
+typedef struct
+{
+    int width; // Pixels of the picture, and of any target it is rendered into (chain, renderer)
+    int height;
+    rxyo_backend_t backend;   // (renderer)
+    int interpolation;        // Pieces every segment between two samples is split into (renderer)
+    float half_life;          // Seconds for the phosphor glow to fade to half, 0 redraws every frame (renderer)
+    float exposure;           // Brightness of the beam (renderer)
+    unsigned int channels;    // Of the interleaved float frames pushed (ring)
+    unsigned int sample_rate; // Of the frames pushed (ring, chain)
+    float seconds;            // Audio the ring holds, it has to cover the time between two calls to process (ring, chain)
+    const char *traces;       // Channels drawn against each other as with --traces, NULL for "0:1" (chain)
+    int trigger;              // Non-zero to lock repeating figures as with --trigger (chain)
+} rxyo_config_t;
+
+// Interleaved float frames pushed from one thread and taken by one chain.
+typedef struct rxyo_ring rxyo_ring_t;
+
+// The processing: the frames taken from a ring at a time, folded by the trigger and merged by
+// the level of detail. Needs no GL context.
+typedef struct rxyo_chain rxyo_chain_t;
+
+// The backend and the phosphor glow that draw what a chain took.
+typedef struct rxyo_renderer rxyo_renderer_t;
+
+// One ring, chain and renderer.
+typedef struct rxyo_scope rxyo_scope_t;
+
+// A capture device feeding a ring instead of pushing to it.
+typedef struct rxyo_source rxyo_source_t;
+
+void rxyo_default_config(rxyo_config_t *config);
+
+// Ring functions. Returns NULL on failure.
+rxyo_ring_t *rxyo_ring_create(const rxyo_config_t *config);
+void rxyo_ring_destroy(rxyo_ring_t *ring);
+
+// Producer side, from one thread at a time. Appends frameCount interleaved float frames and
+// returns how many fit, the rest are dropped until the chain catches up.
+unsigned int rxyo_ring_push(rxyo_ring_t *ring, const float *frames, unsigned int frameCount);
+
+// Opens the default capture device at the rate of the ring and feeds it, nothing may be pushed
+// meanwhile. Returns NULL on failure.
+rxyo_source_t *rxyo_ring_open_capture(rxyo_ring_t *ring);
+void rxyo_close_capture(rxyo_source_t *source);
+
+// Chain functions. Returns NULL on failure.
+rxyo_chain_t *rxyo_chain_create(const rxyo_config_t *config);
+void rxyo_chain_destroy(rxyo_chain_t *chain);
+
+// Consumer side of ring, takes everything pushed since the last call and runs it through the
+// trigger, in place of whatever the chain took before. Returns the number of frames taken.
+int rxyo_chain_process(rxyo_chain_t *chain, rxyo_ring_t *ring);
+
+// Renderer functions. Returns NULL on failure. Needs the GL context current unless the backend
+// is software. It draws any chain with the same traces as chain, laid out on its own size.
+rxyo_renderer_t *rxyo_renderer_create(const rxyo_config_t *config, const rxyo_chain_t *chain);
+void rxyo_renderer_destroy(rxyo_renderer_t *renderer);
+
+// Draws the frames chain took last into target, a render texture of the size of the renderer,
+// or into the texture of the renderer itself when target is NULL. frameTime is how long the
+// previous picture was shown, the glow fades out over it. Frames this renderer drew already are
+// not drawn again, so rendering more often than processing only fades the glow. Rendering less
+// often skips what was taken in between. Returns 0 on success.
+int rxyo_renderer_render(rxyo_renderer_t *renderer, const rxyo_chain_t *chain, RenderTexture2D *target, float frameTime);
+
+// Same as rxyo_renderer_render into the renderer itself, then copies the picture to rgba, width x
+// height pixels of 8 bit RGBA with the top row first. The GL backends wait for the GPU to read it.
+int rxyo_renderer_render_pixels(rxyo_renderer_t *renderer, const rxyo_chain_t *chain, unsigned char *rgba, float frameTime);
+
+// What the renderer drew last, an empty texture for the software backend.
+Texture2D rxyo_renderer_texture(const rxyo_renderer_t *renderer);
+
+// Scope functions, the same as the ones of its parts. Returns NULL on failure. Needs the GL
+// context current unless the backend is software.
+rxyo_scope_t *rxyo_create(const rxyo_config_t *config);
+void rxyo_destroy(rxyo_scope_t *scope);
+
+unsigned int rxyo_push(rxyo_scope_t *scope, const float *frames, unsigned int frameCount);
+rxyo_source_t *rxyo_open_capture(rxyo_scope_t *scope);
+int rxyo_process(rxyo_scope_t *scope);
+int rxyo_render(rxyo_scope_t *scope, RenderTexture2D *target, float frameTime);
+int rxyo_render_pixels(rxyo_scope_t *scope, unsigned char *rgba, float frameTime);
+Texture2D rxyo_texture(const rxyo_scope_t *scope);
+
+// The parts of a scope, e.g. to draw its chain with another renderer as well.
+rxyo_ring_t *rxyo_scope_ring(rxyo_scope_t *scope);
+rxyo_chain_t *rxyo_scope_chain(rxyo_scope_t *scope);
+rxyo_renderer_t *rxyo_scope_renderer(rxyo_scope_t *scope);
+
+#endif